@@ -10,16 +10,40 @@
 #include <student/drawModel.hpp>
 #include <examples/modelMethod.hpp>
 
+#include <sstream>
+
 namespace modelMethod{
 
 /**
  * @brief Constructor
  */
 Method::Method(MethodConstructionData const*){
-  modelData.load(ProgramContext::get().args.modelFile);
+  modelData.load(ProgramContext::get().args.modelFile,ProgramContext::get().args.modelCache);
   model = modelData.getModel();
+  auto const info = ProgramContext::get().args.modelInfo;
+  if(info)
+    std::cerr << "model: " << modelData.getTimings() << std::endl;
+  if(ProgramContext::get().args.optimizeMeshes){
+    optimizedMeshes = OptimizedMeshes(model);
+    optimizedMeshes.attach(model);
+    if(info)
+      std::cerr << optimizedMeshes << std::endl;
+  }
+  if(ProgramContext::get().args.modelLods){
+    meshLods = MeshLods(model);
+    meshLods.attach(model);
+    if(info)
+      std::cerr << meshLods;
+  }
 
-  prepareModel(mem,commandBuffer,model);
+  prepareModel(mem,commandBuffer,model,instances);
+  if(ProgramContext::get().args.depthPrepass){
+    auto const opaque = setDepthPrepass(commandBuffer,model,instances,true);
+    if(info)
+      std::cerr << "model: opaque instances: " << opaque << "/" << instances.size() << std::endl;
+  }
+  if(ProgramContext::get().args.occlusionCulling || ProgramContext::get().args.staleOcclusion)
+    occlusionCulling = OcclusionCulling(model);
 }
 
 
@@ -36,9 +60,33 @@ void Method::onDraw(Frame&frame,SceneParam const&sceneParam){
   mem.uniforms[0].m4 = sceneParam.proj * sceneParam.view;
   mem.uniforms[1].v3 = sceneParam.light;
   mem.uniforms[2].v3 = sceneParam.camera;
+
+  culledInstances = cullModel(commandBuffer,model,instances,sceneParam.proj*sceneParam.view);
+
+  if(ProgramContext::get().args.occlusionCulling || ProgramContext::get().args.staleOcclusion){
+    occludedInstances = occlusionCulling.cull(commandBuffer,instances,sceneParam.proj*sceneParam.view,ProgramContext::get().args.staleOcclusion);
+    occluders         = occlusionCulling.nofOccluders;
+  }
+
+  if(ProgramContext::get().args.modelLods)
+    meshLods.select(commandBuffer,model,instances,sceneParam.view,sceneParam.proj,frame.height);
+
   gpu_execute(mem,commandBuffer);
 }
 
+/**
+ * @brief This function returns number of culled and occluded instances of the last frame.
+ *
+ * @return statistics for window title
+ */
+std::string Method::getStatistics()const{
+  std::stringstream ss;
+  ss << "culled " << culledInstances << "/" << instances.size();
+  if(ProgramContext::get().args.occlusionCulling || ProgramContext::get().args.staleOcclusion)
+    ss << ", occluded " << occludedInstances << "/" << instances.size() << " (" << occluders << " occluders)";
+  return ss.str();
+}
+
 EntryPoint main = [](){registerMethod<Method>("izg13 model loader");};
 
 }
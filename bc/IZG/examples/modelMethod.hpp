@@ -1,7 +1,12 @@
 #pragma once
 
+#include <atomic>
+
 #include <framework/method.hpp>
 #include <framework/model.hpp>
+#include <framework/meshOptimizer.hpp>
+#include <framework/occlusionCulling.hpp>
+#include <student/drawModel.hpp>
 
 namespace modelMethod{
 
@@ -16,10 +21,18 @@ class Method: public ::Method{
      */
     virtual ~Method(){};
     virtual void onDraw(Frame&frame,SceneParam const&sceneParam) override;
-    ModelData     modelData;
-    Model         model;
-    CommandBuffer commandBuffer;
-    GPUMemory     mem;
+    virtual std::string getStatistics()const override;
+    ModelData       modelData;
+    Model           model;
+    OptimizedMeshes optimizedMeshes;
+    MeshLods        meshLods;
+    OcclusionCulling occlusionCulling;
+    CommandBuffer   commandBuffer;
+    GPUMemory       mem;
+    std::vector<MeshInstance>instances;///< flattened model, culled every frame
+    std::atomic<uint32_t>culledInstances = 0;///< number of instances culled in last frame, read by main thread
+    std::atomic<uint32_t>occludedInstances = 0;///< number of instances occluded in last frame, read by main thread
+    std::atomic<uint32_t>occluders         = 0;///< number of occluders rendered in last frame, read by main thread
 };
 
 }
@@ -9,6 +9,11 @@
 #include <framework/programContext.hpp>
 #include <framework/bunny.hpp>
 
+#include <algorithm>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+
 namespace phongMethod{
 
 /**
@@ -19,8 +24,13 @@ class Method: public ::Method{
     Method(MethodConstructionData const*);
     virtual ~Method();
     virtual void onDraw(Frame&frame,SceneParam const&sceneParam) override;
+    void prepareDeferredShading();
     CommandBuffer commandBuffer;
     GPUMemory mem;
+    bool      deferred  = false;///< bunny is rendered using deferred shading
+    uint32_t  nofLights = 1    ;///< number of lights of deferred shading
+    std::vector<uint32_t >normals  ;///< g-buffer normals of deferred shading
+    std::vector<glm::vec3>positions;///< g-buffer positions of deferred shading
 };
 
 
@@ -123,6 +133,9 @@ Method::Method(MethodConstructionData const*){
 
   pushClearCommand(commandBuffer,glm::vec4(.5,.5,.5,1));
   pushDrawCommand (commandBuffer,sizeof(bunnyIndices)/sizeof(VertexIndex),0,vao);
+
+  if(ProgramContext::get().args.deferredShading)
+    prepareDeferredShading();
 }
 
 
@@ -140,12 +153,114 @@ void Method::onDraw(Frame&frame,SceneParam const&sceneParam){
   mem.uniforms[1].m4 = sceneParam.proj  ;
   mem.uniforms[2].v3 = sceneParam.light ;
   mem.uniforms[3].v3 = sceneParam.camera;
+
+  if(deferred){
+    normals  .resize(getNofPixels(frame));
+    positions.resize(getNofPixels(frame));
+    mem.framebuffer.normal   = normals  .data();
+    mem.framebuffer.position = positions.data();
+    mem.uniforms[5].v3 = sceneParam.light;
+  }
   
   gpu_execute(mem,commandBuffer);
 }
 
 //! [PhongMethod]
 
+/**
+ * @brief This function represents fragment shader of geometry pass of deferred phong method.
+ * It writes material color, normal and position into g-buffer.
+ *
+ * @param outFragment output fragment
+ * @param inFragment input fragment
+ * @param uniforms uniform variables
+ */
+void gbufferFragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&){
+  auto const& vpos  = inFragment.attributes[0].v3;
+  auto const  vvnor = glm::normalize(inFragment.attributes[1].v3);
+
+  float t = vvnor[1];
+  if(t<0.f)t=0.f;
+  t*=t;
+
+  float const nofStripes = 10;
+  float factor = 1.f / nofStripes * 2.f;
+
+  auto xs = static_cast<float>(glm::mod(vpos.x+glm::sin(vpos.y*10.f)*.1f,factor)/factor > 0.5);
+
+  auto materialDiffuseColor = glm::mix(glm::mix(glm::vec3(0.f,.5f,0.f),glm::vec3(1.f,1.f,0.f),xs),glm::vec3(1.f),t);
+
+  outFragment.gl_FragColor    = glm::vec4(materialDiffuseColor,1.f);
+  outFragment.gl_FragNormal   = vvnor;
+  outFragment.gl_FragPosition = vpos;
+}
+
+/**
+ * @brief This function represents lighting shader of deferred phong method.
+ * It is executed once per pixel of g-buffer and sums diffuse and specular light of all lights.
+ * uniforms[4].u1 contains number of lights, uniforms[5+2*i].v3 position and uniforms[6+2*i].v3 color of light i.
+ *
+ * @param outFragment output fragment
+ * @param inFragment albedo, normal and position from g-buffer
+ * @param uniforms uniform variables
+ */
+void lightingShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&si){
+  auto const& cameraPosition       = si.uniforms[3].v3;
+  auto const& materialDiffuseColor = glm::vec3(inFragment.attributes[0].v4);
+  auto const& vvnor                = inFragment.attributes[1].v3;
+  auto const& vpos                 = inFragment.attributes[2].v3;
+  auto const  nofLights            = si.uniforms[4].u1;
+  float const shininess            = 40.f;
+
+  auto const v = glm::normalize(cameraPosition-vpos);
+  auto const r = -glm::reflect(v,vvnor);
+
+  auto color = glm::vec3(0.f);
+  for(uint32_t i=0;i<nofLights;++i){
+    auto const& light      = si.uniforms[5+2*i].v3;
+    auto const& lightColor = si.uniforms[6+2*i].v3;
+    auto l = glm::normalize(light-vpos);
+    float diffuseFactor = glm::dot(l,vvnor);
+    if(diffuseFactor < 0.f)diffuseFactor = 0.f;
+    float specularFactor = glm::dot(r,l);
+    if(specularFactor < 0.f)specularFactor = 0.f;
+    specularFactor = powf(specularFactor,shininess);
+    color += lightColor*(materialDiffuseColor*diffuseFactor+specularFactor);
+  }
+
+  outFragment.gl_FragColor = glm::vec4(glm::min(color,glm::vec3(1.f)),1.f);
+}
+
+/**
+ * @brief This function switches phong method to deferred shading.
+ * Program 1 writes g-buffer, program 2 lights it.
+ * Light 0 is the scene light, other lights are colored and they are placed around the bunny.
+ */
+void Method::prepareDeferredShading(){
+  deferred  = true;
+  nofLights = std::min(std::max(ProgramContext::get().args.nofLights,1u),(GPUMemory::maxUniforms-5)/2);
+
+  mem.programs[1] = mem.programs[0];
+  mem.programs[1].fragmentShader = gbufferFragmentShader;
+  mem.programs[1].gbufferOutput  = true;
+  mem.programs[2].fragmentShader = lightingShader;
+
+  mem.uniforms[4].u1 = nofLights;
+  mem.uniforms[6].v3 = glm::vec3(1.f);
+  for(uint32_t i=1;i<nofLights;++i){
+    auto const angle = glm::two_pi<float>()*i/(nofLights-1);
+    auto const hue   = glm::vec3(glm::cos(angle),glm::cos(angle-glm::two_pi<float>()/3.f),glm::cos(angle+glm::two_pi<float>()/3.f))*.5f+.5f;
+    mem.uniforms[5+2*i].v3 = glm::vec3(glm::cos(angle)*20.f,10.f,glm::sin(angle)*20.f);
+    mem.uniforms[6+2*i].v3 = hue/(float)nofLights;
+  }
+
+  auto vao = commandBuffer.commands[1].data.drawCommand.vao;
+  commandBuffer.nofCommands = 0;
+  pushClearCommand   (commandBuffer,glm::vec4(.5,.5,.5,1));
+  pushDrawCommand    (commandBuffer,sizeof(bunnyIndices)/sizeof(VertexIndex),1,vao,false,BlendMode::NONE);
+  pushLightingCommand(commandBuffer,2);
+}
+
 /**
  * @brief Destructor of phong method.
  */
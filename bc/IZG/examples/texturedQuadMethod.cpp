@@ -55,7 +55,7 @@ void vertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface co
  */
 void fragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&si){
   auto uv = inFragment.attributes[0].v2;
-  outFragment.gl_FragColor = read_texture(si.textures[0],uv);
+  outFragment.gl_FragColor = read_textureGrad(si.textures[0],uv,glm::vec2(inFragment.dFdx[0]),glm::vec2(inFragment.dFdy[0]));
 }
 
 /**
@@ -63,11 +63,13 @@ void fragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderIn
  */
 Method::Method(MethodConstructionData const*){
   tex = loadTexture(ProgramContext::get().args.imageFile);
+  tex.prepare();
 
   mem.textures[0] = tex.getTexture();
   mem.programs[0].vertexShader   = vertexShader  ; 
   mem.programs[0].fragmentShader = fragmentShader;
   mem.programs[0].vs2fs[0]       = AttributeType::VEC2;//tex coords
+  mem.programs[0].derivatives    = true;//texture level of detail
 
   pushClearCommand(commandBuffer,glm::vec4(0,0,0,1));
   pushDrawCommand (commandBuffer,6);
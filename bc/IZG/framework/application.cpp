@@ -6,8 +6,18 @@
  */
 
 #include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
 #include <framework/application.hpp>
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 
 
 void defaultSceneParameters(
@@ -37,12 +47,21 @@ Application::Application(int32_t width,int32_t height):Window(width,height,"izgP
   setCallback      (SDL_KEYDOWN            ,[&](SDL_Event const&event){keyDown    (event);});
   defaultSceneParameters(orbitCamera,perspectiveCamera,light,width,height);
   timer.reset();
+  statisticsTimer.reset();
+  renderThread = std::thread([&](){renderLoop();});
 }
 
 /**
  * @brief Destructor
  */
-Application::~Application(){}
+Application::~Application(){
+  {
+    std::lock_guard<std::mutex>lock(renderMutex);
+    renderThreadExit = true;
+  }
+  renderCondition.notify_all();
+  renderThread.join();
+}
 
     
 /**
@@ -69,16 +88,67 @@ void Application::createMethodIfItDoesNotExist(){
   if(mr.method)return;
   int w,h;
   SDL_GetWindowSize(getWindow(),&w,&h);
-  framebuffer = std::make_shared<Framebuffer>(w,h);
+  framebuffer     = std::make_shared<Framebuffer>(w,h,ProgramContext::get().args.tiledFramebuffer);
+  backFramebuffer = std::make_shared<Framebuffer>(w,h,ProgramContext::get().args.tiledFramebuffer);
+  frontFrameIsNew = false;
 
   mr.method = mr.methodFactories[mr.selectedMethod](&*mr.methodConstructData[mr.selectedMethod]);
   SDL_SetWindowTitle(getWindow(),mr.methodName.at(mr.selectedMethod).c_str());
 }
 
+/**
+ * @brief This function is called by main loop.
+ * Frames are pipelined: the frame N+1 is rendered by render thread into back framebuffer
+ * while main thread presents the frame N from front framebuffer.
+ * Framebuffers are swapped only after the render thread finishes whole frame.
+ */
 void Application::idle(){
-  auto&mr=ProgramContext::get().methods;
   createMethodIfItDoesNotExist();
 
+  waitForFrame();
+  submitFrame();
+  if(!ProgramContext::get().args.pipelinedFrames)
+    waitForFrame();
+
+  swap();
+}
+
+/**
+ * @brief This function is executed by render thread.
+ * It draws submitted frames into back framebuffer.
+ */
+void Application::renderLoop(){
+  auto&mr=ProgramContext::get().methods;
+  std::unique_lock<std::mutex>lock(renderMutex);
+  for(;;){
+    renderCondition.wait(lock,[&](){return frameSubmitted || renderThreadExit;});
+    if(renderThreadExit)return;
+    auto const sceneParam = renderSceneParam;
+    lock.unlock();
+
+    std::exception_ptr error;
+    try{
+      auto frame = backFramebuffer->getFrame();
+      mr.method->onDraw(frame,sceneParam);
+    }catch(...){
+      error = std::current_exception();
+    }
+
+    lock.lock();
+    renderError    = error;
+    frameRendered  = !error;
+    frameSubmitted = false;
+    renderCondition.notify_all();
+  }
+}
+
+/**
+ * @brief This function updates the method and submits next frame to render thread.
+ * Render thread has to be idle (see waitForFrame).
+ */
+void Application::submitFrame(){
+  auto&mr=ProgramContext::get().methods;
+
   mr.method->onUpdate(timer.elapsedFromLast());
 
   SceneParam sceneParam;
@@ -87,10 +157,63 @@ void Application::idle(){
   sceneParam.camera = glm::vec3(glm::inverse(sceneParam.view)*glm::vec4(0.f,0.f,0.f,1.f));
   sceneParam.light  = light;
 
-  auto frame = framebuffer->getFrame();
-  mr.method->onDraw(frame,sceneParam);
+  {
+    std::lock_guard<std::mutex>lock(renderMutex);
+    renderSceneParam = sceneParam;
+    backSubmitTime   = FrameClock::now();
+    frameSubmitted   = true;
+  }
+  renderCondition.notify_all();
+}
 
-  swap();
+/**
+ * @brief This function waits until render thread finishes submitted frame.
+ * Finished frame is moved to front framebuffer.
+ * Exception thrown by the method in render thread is rethrown here.
+ */
+void Application::waitForFrame(){
+  std::unique_lock<std::mutex>lock(renderMutex);
+  renderCondition.wait(lock,[&](){return !frameSubmitted;});
+  if(renderError){
+    auto const error = renderError;
+    renderError = nullptr;
+    std::rethrow_exception(error);
+  }
+  if(!frameRendered)return;
+  frameRendered = false;
+  std::swap(framebuffer,backFramebuffer);
+  frontSubmitTime = backSubmitTime;
+  frontFrameIsNew = true;
+}
+
+/**
+ * @brief This function measures throughput and latency (from submission to presentation) of frames.
+ * Averages are shown in window title every second.
+ */
+void Application::updateFrameStatistics(){
+  if(!frontFrameIsNew)return;
+  frontFrameIsNew = false;
+
+  std::chrono::duration<float>const latency = FrameClock::now() - frontSubmitTime;
+  statisticsFrames  ++;
+  statisticsLatency += latency.count();
+
+  auto const elapsed = statisticsTimer.elapsedFromStart();
+  if(elapsed < 1.f)return;
+
+  auto&mr=ProgramContext::get().methods;
+  std::stringstream ss;
+  ss << mr.methodName.at(mr.selectedMethod) << " - ";
+  ss << std::fixed << std::setprecision(1);
+  ss << statisticsFrames / elapsed << " fps, ";
+  ss << statisticsLatency / statisticsFrames * 1000.f << " ms latency";
+  auto const methodStatistics = mr.method ? mr.method->getStatistics() : std::string();
+  if(!methodStatistics.empty())ss << ", " << methodStatistics;
+  SDL_SetWindowTitle(getWindow(),ss.str().c_str());
+
+  statisticsTimer.reset();
+  statisticsFrames  = 0;
+  statisticsLatency = 0.f;
 }
 
 void Application::resize(SDL_Event const&event){
@@ -100,7 +223,9 @@ void Application::resize(SDL_Event const&event){
   auto const aspect = static_cast<float>(width) / static_cast<float>(height);
   perspectiveCamera.setAspect(aspect);
   if(mr.method){
-    framebuffer->resize(event.window.data1,event.window.data2);
+    waitForFrame();
+    framebuffer    ->resize(event.window.data1,event.window.data2);
+    backFramebuffer->resize(event.window.data1,event.window.data2);
   }
   reInitRenderer();
 }
@@ -136,6 +261,7 @@ void Application::mouseMotion(SDL_Event const&event){
 void Application::nextMethod(uint32_t key){
   auto&mr=ProgramContext::get().methods;
   if (key != SDLK_n)return;
+  waitForFrame();
   auto const nofMethods = mr.methodFactories.size();
   mr.selectedMethod++;
   if(mr.selectedMethod >= nofMethods)mr.selectedMethod=0;
@@ -145,6 +271,7 @@ void Application::nextMethod(uint32_t key){
 void Application::prevMethod(uint32_t key){
   auto&mr=ProgramContext::get().methods;
   if (key != SDLK_p)return;
+  waitForFrame();
   auto const nofMethods = mr.methodFactories.size();
   if(mr.selectedMethod > 0)mr.selectedMethod--;
   else mr.selectedMethod = nofMethods-1;
@@ -172,30 +299,143 @@ void Application::keyDown(SDL_Event const&event){
 }
 
 void Application::swap(){
-  auto       frame = framebuffer->color.data();
-  auto const w     = framebuffer->width;
-  auto const h     = framebuffer->height; 
-
-  copyToSDLSurface(surface,frame,w,h);
-}
-
-void copyToSDLSurface(SDL_Surface*surface,uint8_t const*const frame,uint32_t width,uint32_t height){
-  uint32_t const bitsPerByte    = 8;
-  uint32_t const swizzleTable[] = {
-      surface->format->Rshift / bitsPerByte,
-      surface->format->Gshift / bitsPerByte,
-      surface->format->Bshift / bitsPerByte,
-  };
-
-  uint8_t* const  pixels      = (uint8_t*)surface->pixels;
-  for (size_t y = 0; y < height; ++y) {
-    size_t const reversedY = height - y - 1;
-    for (size_t x = 0; x < width; ++x) {
-      auto const color    = frame + (y*width+x)*4;
-      auto const dstPixel = pixels + reversedY * surface->pitch + x * surface->format->BytesPerPixel;
-      for (uint32_t c = 0; c < 3; ++c)
-        dstPixel[swizzleTable[c]] = color[c];
+  copyToSDLSurface(surface,framebuffer->getFrame());
+  updateFrameStatistics();
+}
+
+namespace{
+
+/**
+ * @brief This structure describes how RGBA8 pixels of frame are stored into pixels of SDL_Surface
+ */
+struct PixelSwizzle{
+  uint8_t  shuffle[16]       ;///< byte shuffle mask of 4 destination pixels, value is source byte, 0x80 zeroes the byte
+  uint32_t opaque        = 0 ;///< bits that are set in every destination pixel (padding byte of 32bit surfaces without alpha)
+  uint32_t bytesPerPixel = 0 ;///< bytes per pixel of surface
+  bool     identity      = false;///< surface format matches RGBA8, rows are just copied
+};
+
+/**
+ * @brief This function precomputes swizzle of RGBA8 pixels for SDL surface format
+ *
+ * @param format pixel format of surface
+ *
+ * @return swizzle
+ */
+PixelSwizzle createPixelSwizzle(SDL_PixelFormat const*format){
+  uint32_t const bitsPerByte = 8;
+  PixelSwizzle res;
+  res.bytesPerPixel = format->BytesPerPixel;
+
+  uint8_t pixel[4] = {0x80,0x80,0x80,0x80};
+  pixel[format->Rshift/bitsPerByte] = 0;
+  pixel[format->Gshift/bitsPerByte] = 1;
+  pixel[format->Bshift/bitsPerByte] = 2;
+  if(res.bytesPerPixel == 4 && format->Amask)pixel[format->Ashift/bitsPerByte] = 3;
+
+  for(uint32_t b=0;b<4;++b)
+    if(res.bytesPerPixel == 4 && !format->Amask && pixel[b] == 0x80)res.opaque |= 0xffu << (b*bitsPerByte);
+
+  for(uint32_t p=0;p<4;++p)
+    for(uint32_t b=0;b<4;++b)
+      res.shuffle[p*4+b] = pixel[b] == 0x80 ? 0x80 : (uint8_t)(p*4+pixel[b]);
+
+  res.identity = res.bytesPerPixel == 4 && pixel[0] == 0 && pixel[1] == 1 && pixel[2] == 2 && pixel[3] == 3;
+  return res;
+}
+
+/**
+ * @brief This function converts contiguous span of RGBA8 pixels into surface pixels
+ *
+ * @param dst destination surface pixels
+ * @param src source RGBA8 pixels
+ * @param n number of pixels
+ * @param swizzle precomputed swizzle
+ */
+void blitPixels(uint8_t*dst,uint8_t const*src,uint32_t n,PixelSwizzle const&swizzle){
+  if(swizzle.identity){
+    memcpy(dst,src,(size_t)n*4);
+    return;
+  }
+
+  auto const shuffle = swizzle.shuffle;
+  uint32_t i = 0;
+  if(swizzle.bytesPerPixel == 4){
+#if defined(__SSSE3__)
+    __m128i const mask   = _mm_loadu_si128((__m128i const*)shuffle);
+    __m128i const opaque = _mm_set1_epi32((int)swizzle.opaque);
+    for(;i+4<=n;i+=4){
+      __m128i const p = _mm_loadu_si128((__m128i const*)(src+i*4));
+      _mm_storeu_si128((__m128i*)(dst+i*4),_mm_or_si128(_mm_shuffle_epi8(p,mask),opaque));
+    }
+#elif defined(__SSE2__)
+    // without pshufb every destination byte is shifted from its source byte
+    __m128i const byteMask = _mm_set1_epi32(0xff);
+    __m128i const opaque   = _mm_set1_epi32((int)swizzle.opaque);
+    __m128i srcShift[4],dstShift[4];
+    uint32_t nofBytes = 0;
+    for(uint32_t b=0;b<4;++b){
+      if(shuffle[b] == 0x80)continue;
+      srcShift[nofBytes] = _mm_cvtsi32_si128(shuffle[b]*8);
+      dstShift[nofBytes] = _mm_cvtsi32_si128(b*8);
+      nofBytes++;
+    }
+    for(;i+4<=n;i+=4){
+      __m128i const p = _mm_loadu_si128((__m128i const*)(src+i*4));
+      __m128i r = opaque;
+      for(uint32_t b=0;b<nofBytes;++b)
+        r = _mm_or_si128(r,_mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(p,srcShift[b]),byteMask),dstShift[b]));
+      _mm_storeu_si128((__m128i*)(dst+i*4),r);
+    }
+#endif
+    for(;i<n;++i){
+      uint32_t pixel = swizzle.opaque;
+      for(uint32_t b=0;b<4;++b)
+        if(shuffle[b] != 0x80)pixel |= (uint32_t)src[i*4+shuffle[b]] << (b*8);
+      memcpy(dst+i*4,&pixel,4);
+    }
+    return;
+  }
+
+  if(swizzle.bytesPerPixel == 3){
+    for(;i<n;++i){
+      dst[i*3+0] = src[i*4+shuffle[0]];
+      dst[i*3+1] = src[i*4+shuffle[1]];
+      dst[i*3+2] = src[i*4+shuffle[2]];
     }
+    return;
   }
+
+  for(;i<n;++i)
+    for(uint32_t b=0;b<swizzle.bytesPerPixel && b<4;++b)
+      if(shuffle[b] != 0x80)dst[i*swizzle.bytesPerPixel+b] = src[i*4+shuffle[b]];
+}
+
 }
 
+void copyToSDLSurface(SDL_Surface*surface,Frame const&frame){
+  auto const width   = frame.width ;
+  auto const height  = frame.height;
+  auto const swizzle = createPixelSwizzle(surface->format);
+
+  // rows are flipped, frame has origin in the bottom left corner
+  uint8_t* const pixels = (uint8_t*)surface->pixels;
+  auto const dstRow = [&](uint32_t y){return pixels + (size_t)(height - y - 1) * surface->pitch;};
+
+  if(!frame.tiled){
+    for (uint32_t y = 0; y < height; ++y)
+      blitPixels(dstRow(y),frame.color + (size_t)y*width*4,width,swizzle);
+    return;
+  }
+
+  // tiled frame is read tile by tile, tile rows are contiguous
+  uint8_t const* src = frame.color;
+  for (uint32_t ty = 0; ty < height; ty += frameTileSize)
+    for (uint32_t tx = 0; tx < width; tx += frameTileSize) {
+      auto const n = std::min(frameTileSize,width -tx);
+      auto const m = std::min(frameTileSize,height-ty);
+      for (uint32_t y = 0; y < m; ++y)
+        blitPixels(dstRow(ty+y) + (size_t)tx*swizzle.bytesPerPixel,src + y*frameTileSize*4,n,swizzle);
+      src += frameTileSize*frameTileSize*4;
+    }
+}
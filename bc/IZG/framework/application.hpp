@@ -7,7 +7,12 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <BasicCamera/OrbitCamera.h>
@@ -43,6 +48,12 @@ class Application: protected Window{
     void quit      (uint32_t key);
     void createMethodIfItDoesNotExist();
     void swap();
+    void renderLoop();
+    void submitFrame();
+    void waitForFrame();
+    void updateFrameStatistics();
+
+    using FrameClock = std::chrono::high_resolution_clock;
 
 
     basicCamera::OrbitCamera       orbitCamera                                  ;
@@ -54,7 +65,24 @@ class Application: protected Window{
 
     Timer<float>                   timer                                        ;
 
-    std::shared_ptr<Framebuffer>framebuffer;///< framebuffer
+    std::shared_ptr<Framebuffer>framebuffer    ;///< front framebuffer, it contains the last finished frame that is presented
+    std::shared_ptr<Framebuffer>backFramebuffer;///< back framebuffer, render thread draws the next frame into it
+
+    std::thread               renderThread             ;///< thread that executes onDraw of submitted frames
+    std::mutex                renderMutex              ;///< mutex that guards submitted frame
+    std::condition_variable   renderCondition          ;///< signals submitted and finished frames
+    SceneParam                renderSceneParam         ;///< scene parameters of submitted frame
+    bool                      frameSubmitted   = false ;///< render thread draws into back framebuffer
+    bool                      frameRendered    = false ;///< back framebuffer contains finished frame
+    bool                      renderThreadExit = false ;///< render thread should end
+    std::exception_ptr        renderError              ;///< exception thrown by onDraw in render thread
+    FrameClock::time_point    backSubmitTime           ;///< time when the frame in back framebuffer was submitted
+    FrameClock::time_point    frontSubmitTime          ;///< time when the frame in front framebuffer was submitted
+    bool                      frontFrameIsNew  = false ;///< front framebuffer was not presented yet
+
+    Timer<float>              statisticsTimer          ;///< measures period of frame statistics
+    uint32_t                  statisticsFrames = 0     ;///< number of presented frames in current period
+    float                     statisticsLatency= 0.f   ;///< sum of frame latencies in current period
 };
 
 /**
@@ -74,13 +102,12 @@ void defaultSceneParameters(
 
 /**
  * @brief This function swaps color buffer with SDL_Surface
+ * Tiled frame is resolved to linear layout here.
  *
  * @param surface sdl surface
- * @param color color buffer (RGBA8UI)
- * @param width width of color buffer
- * @param height height of color buffer
+ * @param frame frame with color buffer (RGBA8UI)
  */
-void copyToSDLSurface(SDL_Surface*surface,uint8_t const*const color,uint32_t width,uint32_t height);
+void copyToSDLSurface(SDL_Surface*surface,Frame const&frame);
 
 /**
  * @brief This method registers new rendering method into applicaion
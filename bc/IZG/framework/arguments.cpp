@@ -16,6 +16,18 @@ Arguments::Arguments(int argc,char const*argv[]){
   perfTests           = args->getu32   ("-f"          ,10,"number of frames that are tests during performance tests");
   mseThreshold        = args->getf32   ("--mse"       ,40,"mse threshold for image to image test");
   testToBreak         = args->geti32   ("--breakTest" ,-1,"this will forcefully break test with this number");
+  nofThreads          = args->getu32   ("--threads"   ,0,"number of rendering threads, 0 selects all cores");
+  tiledFramebuffer    = args->isPresent("--tiled"     ,"framebuffer stores pixels in 8x8 tiles");
+  modelCache          = !args->isPresent("--no-model-cache","disables binary cache of preprocessed models");
+  modelInfo           = args->isPresent("--model-info","prints load timings and preprocessing statistics of model");
+  optimizeMeshes      = args->isPresent("--optimize-meshes","optimizes vertex and triangle order of model meshes after loading");
+  modelLods           = args->isPresent("--model-lods","creates levels of detail of model meshes and selects them every frame");
+  pipelinedFrames     = !args->isPresent("--no-pipeline","presents every frame right after it is rendered, disables pipelined rendering");
+  depthPrepass        = args->isPresent("--depth-prepass","renders depth of opaque model meshes first, every visible pixel is shaded once");
+  deferredShading     = args->isPresent("--deferred","phong method uses deferred shading, geometry is written into g-buffer and lit once per pixel");
+  nofLights           = args->getu32   ("--lights"    ,1,"number of lights of deferred phong method");
+  occlusionCulling    = args->isPresent("--occlusion","culls model instances hidden behind large occluders rasterized into low resolution depth buffer");
+  staleOcclusion      = args->isPresent("--occlusion-previous-frame","occlusion culling tests instances against depth buffer of the previous frame");
 
 
   auto printHelp  = args->isPresent("-h"    ,"prints help");
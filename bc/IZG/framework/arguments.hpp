@@ -47,5 +47,17 @@ class Arguments{
   bool     upToTest; ///< run tests up to selected test
   float    mseThreshold;///< threshold for image test
   int32_t  testToBreak;///< if you want to forcefully break test, set it to test id
+  uint32_t nofThreads;///< number of rendering threads, 0 selects all cores
+  bool     tiledFramebuffer = false;///< framebuffer stores pixels in tiles
+  bool     modelCache       = true ;///< models are loaded from binary cache stored next to them
+  bool     modelInfo        = false;///< load timings and preprocessing statistics of model are printed after loading
+  bool     optimizeMeshes   = false;///< model meshes are optimized after loading (see OptimizedMeshes)
+  bool     modelLods        = false;///< levels of detail are created for model meshes and selected every frame (see MeshLods)
+  bool     pipelinedFrames  = true ;///< next frame is rendered in separate thread while the previous one is presented
+  bool     depthPrepass     = false;///< opaque meshes of model are rasterized into depth first and then shaded once (see CommandBuffer::depthPrepass)
+  bool     deferredShading  = false;///< phong method writes g-buffer and lights it in separate pass (see LightingCommand)
+  uint32_t nofLights        = 1    ;///< number of lights of deferred phong method
+  bool     occlusionCulling = false;///< model instances hidden behind occluders are culled every frame (see OcclusionCulling)
+  bool     staleOcclusion   = false;///< occlusion culling uses depth buffer of the previous frame
 };
 
@@ -11,16 +11,19 @@
  */
 class Framebuffer{
   public:
-    Framebuffer(uint32_t w = 500,uint32_t h = 500){
+    Framebuffer(uint32_t w = 500,uint32_t h = 500,bool t = false):tiled(t){
       resize(w,h);
     }
     void resize(uint32_t w,uint32_t h){
       width = w;
       height = h;
-      auto const nofPixes = w*h;
+      // tiled frame is padded to whole tiles
+      auto const paddedWidth  = tiled ? (w+frameTileSize-1)/frameTileSize*frameTileSize : w;
+      auto const paddedHeight = tiled ? (h+frameTileSize-1)/frameTileSize*frameTileSize : h;
+      auto const nofPixes = (size_t)paddedWidth*paddedHeight;
       auto const bytesPerPixel = 4;
-      color.resize((size_t)nofPixes*bytesPerPixel,0);
-      for(size_t i=0;i<w*h;++i)color.at(i*bytesPerPixel+3)=255;
+      color.resize(nofPixes*bytesPerPixel,0);
+      for(size_t i=0;i<nofPixes;++i)color.at(i*bytesPerPixel+3)=255;
       depth.resize(nofPixes,1.f);
     }
     std::vector<uint8_t>color;
@@ -28,6 +31,7 @@ class Framebuffer{
     uint32_t width    = 0;
     uint32_t height   = 0;
     uint32_t channels = 4;
+    bool     tiled    = false;///< color and depth are stored in tiles, see getPixelIndex
     Frame getFrame(){
       Frame frame;
       frame.color    = color.data();
@@ -35,6 +39,7 @@ class Framebuffer{
       frame.width    = width;
       frame.height   = height;
       frame.channels = channels;
+      frame.tiled    = tiled;
       return frame;
     }
 };
@@ -4,6 +4,7 @@
 #include<framework/application.hpp>
 #include<framework/arguments.hpp>
 #include<framework/systemSpecific.hpp>
+#include<student/gpu.hpp>
 #include<tests/conformanceTests.hpp>
 #include<tests/performanceTest.hpp>
 #include<tests/takeScreenShot.hpp>
@@ -16,6 +17,8 @@ int main(int argc,char const*argv[]){
     if(args.stop)
       return 0;
 
+    gpu_getSettings().nofThreads = args.nofThreads;
+
     if(args.runConformanceTests){
       runConformanceTests(args.groundTruthFile,args.modelFile,args.mseThreshold,args.selectedTest,args.upToTest);
       return 0;
@@ -23,6 +26,8 @@ int main(int argc,char const*argv[]){
 
     if(args.runPerformanceTests){
       runPerformanceTest(args.perfTests);
+      runClearPerformanceTest(args.perfTests);
+      runDepthPrepassPerformanceTest(args.perfTests);
       return 0;
     }
 
@@ -0,0 +1,707 @@
+#include<framework/meshOptimizer.hpp>
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+#include<limits>
+#include<string_view>
+#include<unordered_map>
+
+namespace{
+
+uint32_t const overdrawResolution = 128;///< resolution of views used for overdraw statistics
+
+uint32_t attributeSize(AttributeType type){
+  return 4*((uint32_t)type&7);
+}
+
+uint8_t const*getAttrib(Model const&model,VertexAttrib const&att,uint32_t v){
+  if(att.type == AttributeType::EMPTY)return nullptr;
+  if(att.bufferID < 0 || att.bufferID >= (int32_t)model.buffers.size())return nullptr;
+  return (uint8_t const*)model.buffers[att.bufferID].data+att.offset+att.stride*v;
+}
+
+}
+
+/**
+ * @brief This function returns vertex ids of mesh triangles, non-indexed mesh uses ids 0,1,2,...
+ */
+std::vector<uint32_t>readIndices(Model const&model,Mesh const&mesh){
+  std::vector<uint32_t>res(mesh.nofIndices/3*3);
+  auto const indexed = mesh.indexBufferID >= 0 && mesh.indexBufferID < (int32_t)model.buffers.size();
+  auto const*ptr = indexed ? (uint8_t const*)model.buffers[mesh.indexBufferID].data+mesh.indexOffset : nullptr;
+  for(uint32_t i=0;i<res.size();++i){
+    if(!indexed){res[i] = i;continue;}
+    if(mesh.indexType == IndexType::UINT8 ){res[i] = ptr[i];continue;}
+    if(mesh.indexType == IndexType::UINT16){uint16_t v;std::memcpy(&v,ptr+2*i,2);res[i] = v;continue;}
+    std::memcpy(&res[i],ptr+4*i,4);
+  }
+  return res;
+}
+
+std::vector<glm::vec3>readPositions(Model const&model,Mesh const&mesh,uint32_t nofVertices){
+  std::vector<glm::vec3>res(nofVertices,glm::vec3(0.f));
+  auto const n = std::min(attributeSize(mesh.position.type),12u);
+  for(uint32_t v=0;v<nofVertices;++v)
+    std::memcpy(&res[v],getAttrib(model,mesh.position,v),n);
+  return res;
+}
+
+uint32_t countVertices(std::vector<uint32_t>const&indices){
+  uint32_t res = 0;
+  for(auto i:indices)res = std::max(res,i+1);
+  return res;
+}
+
+namespace{
+
+/**
+ * @brief This function simulates fifo post transform cache.
+ *
+ * @return number of cache misses
+ */
+uint32_t simulateCache(std::vector<uint32_t>const&indices,uint32_t nofVertices,std::vector<bool>*allMissed = nullptr){
+  std::vector<uint32_t>cachedAt(nofVertices,0);
+  uint32_t time   = meshOptimizerCacheSize+1;
+  uint32_t misses = 0;
+  if(allMissed)allMissed->assign(indices.size()/3,false);
+  for(size_t t=0;t<indices.size()/3;++t){
+    uint32_t triangleMisses = 0;
+    for(size_t k=0;k<3;++k){
+      auto const v = indices[t*3+k];
+      if(time-cachedAt[v] <= meshOptimizerCacheSize)continue;
+      cachedAt[v] = time++;
+      ++triangleMisses;
+    }
+    misses += triangleMisses;
+    if(allMissed)(*allMissed)[t] = triangleMisses == 3;
+  }
+  return misses;
+}
+
+/**
+ * @brief This function rasterizes mesh from 6 axis aligned orthographic views with depth test.
+ *
+ * @return shaded pixels / covered pixels
+ */
+float computeOverdraw(std::vector<uint32_t>const&indices,std::vector<glm::vec3>const&positions){
+  if(indices.empty())return 0.f;
+  glm::vec3 bmin(std::numeric_limits<float>::max());
+  glm::vec3 bmax(std::numeric_limits<float>::lowest());
+  for(auto i:indices){
+    bmin = glm::min(bmin,positions[i]);
+    bmax = glm::max(bmax,positions[i]);
+  }
+  auto const extent = glm::max(bmax-bmin,glm::vec3(1e-20f));
+
+  uint64_t covered = 0;
+  uint64_t shaded  = 0;
+  std::vector<float>depth(overdrawResolution*overdrawResolution);
+  for(uint32_t axis=0;axis<3;++axis)
+    for(float dir:{1.f,-1.f}){
+      std::fill(depth.begin(),depth.end(),std::numeric_limits<float>::max());
+      auto const project = [&](glm::vec3 const&p){
+        auto const n = (p-bmin)/extent;
+        return glm::vec3(n[(axis+1)%3]*overdrawResolution,n[(axis+2)%3]*overdrawResolution,dir*n[axis]);
+      };
+      for(size_t t=0;t<indices.size();t+=3){
+        auto const a = project(positions[indices[t+0]]);
+        auto const b = project(positions[indices[t+1]]);
+        auto const c = project(positions[indices[t+2]]);
+        auto const area = (b.x-a.x)*(c.y-a.y)-(b.y-a.y)*(c.x-a.x);
+        if(area == 0.f)continue;
+        auto const x0 = (uint32_t)std::max(0.f,std::floor(std::min({a.x,b.x,c.x})));
+        auto const y0 = (uint32_t)std::max(0.f,std::floor(std::min({a.y,b.y,c.y})));
+        auto const x1 = (uint32_t)std::min((float)overdrawResolution-1.f,std::ceil(std::max({a.x,b.x,c.x})));
+        auto const y1 = (uint32_t)std::min((float)overdrawResolution-1.f,std::ceil(std::max({a.y,b.y,c.y})));
+        for(uint32_t y=y0;y<=y1;++y)
+          for(uint32_t x=x0;x<=x1;++x){
+            auto const px = x+.5f;
+            auto const py = y+.5f;
+            auto const l0 = ((b.x-px)*(c.y-py)-(b.y-py)*(c.x-px))/area;
+            auto const l1 = ((c.x-px)*(a.y-py)-(c.y-py)*(a.x-px))/area;
+            auto const l2 = 1.f-l0-l1;
+            if(l0 < 0.f || l1 < 0.f || l2 < 0.f)continue;
+            auto const z = l0*a.z+l1*b.z+l2*c.z;
+            auto&d = depth[y*overdrawResolution+x];
+            if(z >= d)continue;
+            covered += d == std::numeric_limits<float>::max();
+            shaded  += 1;
+            d = z;
+          }
+      }
+    }
+  return covered ? (float)shaded/(float)covered : 0.f;
+}
+
+MeshStatistics computeStatistics(std::vector<uint32_t>const&indices,std::vector<glm::vec3>const&positions){
+  MeshStatistics res;
+  res.nofTriangles = (uint32_t)indices.size()/3;
+  std::vector<bool>used(positions.size(),false);
+  for(auto i:indices)used[i] = true;
+  res.nofVertices = (uint32_t)std::count(used.begin(),used.end(),true);
+  if(!res.nofTriangles)return res;
+  res.acmr     = (float)simulateCache(indices,(uint32_t)positions.size())/(float)res.nofTriangles;
+  res.overdraw = computeOverdraw(indices,positions);
+  return res;
+}
+
+/**
+ * @brief This function orders triangles for post transform cache (Tipsify, Sander et al. 2007).
+ * Triangles are emitted as fans around vertices, next fan vertex is a cached vertex
+ * that is still used by some triangle.
+ */
+std::vector<uint32_t>tipsify(std::vector<uint32_t>const&indices,uint32_t nofVertices){
+  auto const nofTriangles = (uint32_t)indices.size()/3;
+
+  // triangles adjacent to vertices
+  std::vector<uint32_t>live   (nofVertices  ,0);
+  std::vector<uint32_t>offsets(nofVertices+1,0);
+  for(auto i:indices)++live[i];
+  for(uint32_t v=0;v<nofVertices;++v)offsets[v+1] = offsets[v]+live[v];
+  std::vector<uint32_t>adjacency(indices.size());
+  {
+    auto fill = offsets;
+    for(uint32_t t=0;t<nofTriangles;++t)
+      for(uint32_t k=0;k<3;++k)adjacency[fill[indices[t*3+k]]++] = t;
+  }
+
+  std::vector<uint32_t>cachedAt(nofVertices,0);
+  std::vector<bool    >emitted (nofTriangles,false);
+  std::vector<uint32_t>deadEnd;
+  std::vector<uint32_t>candidates;
+  std::vector<uint32_t>res;
+  res.reserve(indices.size());
+
+  uint32_t time   = meshOptimizerCacheSize+1;
+  uint32_t cursor = 0;
+  int64_t  fan    = nofVertices ? 0 : -1;
+  while(fan >= 0){
+    candidates.clear();
+    for(uint32_t a=offsets[fan];a<offsets[fan+1];++a){
+      auto const t = adjacency[a];
+      if(emitted[t])continue;
+      for(uint32_t k=0;k<3;++k){
+        auto const v = indices[t*3+k];
+        res.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if(time-cachedAt[v] > meshOptimizerCacheSize)cachedAt[v] = time++;
+      }
+      emitted[t] = true;
+    }
+
+    // cached candidate with most remaining triangles that stay in cache
+    fan = -1;
+    int64_t best = -1;
+    for(auto v:candidates){
+      if(!live[v])continue;
+      int64_t priority = 0;
+      if(time-cachedAt[v]+2*live[v] <= meshOptimizerCacheSize)priority = time-cachedAt[v];
+      if(priority > best){best = priority;fan = v;}
+    }
+    if(fan >= 0)continue;
+
+    while(!deadEnd.empty() && fan < 0){
+      auto const v = deadEnd.back();
+      deadEnd.pop_back();
+      if(live[v])fan = v;
+    }
+    while(cursor < nofVertices && fan < 0){
+      if(live[cursor])fan = cursor;
+      ++cursor;
+    }
+  }
+  return res;
+}
+
+/**
+ * @brief This function orders clusters of triangles from outside to inside to reduce overdraw.
+ * Clusters are separated by triangles that miss the cache with all vertices,
+ * so their order does not change cache efficiency much.
+ */
+std::vector<uint32_t>sortClusters(std::vector<uint32_t>const&indices,std::vector<glm::vec3>const&positions){
+  std::vector<bool>allMissed;
+  simulateCache(indices,(uint32_t)positions.size(),&allMissed);
+
+  std::vector<uint32_t>starts;
+  for(uint32_t t=0;t<allMissed.size();++t)
+    if(t == 0 || allMissed[t])starts.push_back(t);
+  starts.push_back((uint32_t)allMissed.size());
+
+  glm::vec3 meshCenter(0.f);
+  float     meshArea = 0.f;
+  std::vector<glm::vec3>centers(starts.size()-1,glm::vec3(0.f));
+  std::vector<glm::vec3>normals(starts.size()-1,glm::vec3(0.f));
+  for(size_t c=0;c+1<starts.size();++c){
+    float area = 0.f;
+    for(uint32_t t=starts[c];t<starts[c+1];++t){
+      auto const&a = positions[indices[t*3+0]];
+      auto const&b = positions[indices[t*3+1]];
+      auto const&d = positions[indices[t*3+2]];
+      auto const n = glm::cross(b-a,d-a);
+      auto const l = glm::length(n);
+      centers[c] += (a+b+d)/3.f*l;
+      normals[c] += n;
+      area       += l;
+    }
+    meshCenter += centers[c];
+    meshArea   += area;
+    centers[c] = area > 0.f ? centers[c]/area : positions[indices[starts[c]*3]];
+    auto const l = glm::length(normals[c]);
+    if(l > 0.f)normals[c] /= l;
+  }
+  if(meshArea > 0.f)meshCenter /= meshArea;
+
+  std::vector<uint32_t>order(starts.size()-1);
+  std::vector<float   >keys (starts.size()-1);
+  for(uint32_t c=0;c<order.size();++c){
+    order[c] = c;
+    keys [c] = glm::dot(centers[c]-meshCenter,normals[c]);
+  }
+  std::stable_sort(order.begin(),order.end(),[&](uint32_t a,uint32_t b){return keys[a] > keys[b];});
+
+  std::vector<uint32_t>res;
+  res.reserve(indices.size());
+  for(auto c:order)
+    res.insert(res.end(),indices.begin()+starts[c]*3,indices.begin()+starts[c+1]*3);
+  return res;
+}
+
+/**
+ * @brief This structure represents quadric of squared distances to planes.
+ */
+struct Quadric{
+  double a00 = 0.,a01 = 0.,a02 = 0.,a03 = 0.;
+  double      a11 = 0.,a12 = 0.,a13 = 0.;
+  double           a22 = 0.,a23 = 0.;
+  double                a33 = 0.;
+  double weight = 0.;///< sum of weights of planes
+  void addPlane(glm::dvec3 const&n,double d,double w){
+    a00 += w*n.x*n.x;a01 += w*n.x*n.y;a02 += w*n.x*n.z;a03 += w*n.x*d;
+    a11 += w*n.y*n.y;a12 += w*n.y*n.z;a13 += w*n.y*d;
+    a22 += w*n.z*n.z;a23 += w*n.z*d;
+    a33 += w*d*d;
+    weight += w;
+  }
+  Quadric&operator+=(Quadric const&q){
+    a00 += q.a00;a01 += q.a01;a02 += q.a02;a03 += q.a03;
+    a11 += q.a11;a12 += q.a12;a13 += q.a13;
+    a22 += q.a22;a23 += q.a23;
+    a33 += q.a33;
+    weight += q.weight;
+    return *this;
+  }
+  /**
+   * @brief This function returns mean squared distance of point to planes.
+   */
+  double error(glm::vec3 const&p)const{
+    double const x = p.x,y = p.y,z = p.z;
+    auto const e = x*x*a00+y*y*a11+z*z*a22+a33+2.*(x*y*a01+x*z*a02+y*z*a12+x*a03+y*a13+z*a23);
+    return weight > 0. ? std::max(e,0.)/weight : 0.;
+  }
+};
+
+/**
+ * @brief This class simplifies triangles by half edge collapses ordered by quadric error.
+ * Vertices only move onto their neighbours, so simplified triangles use vertices of the original mesh.
+ * Vertices on borders and on attribute seams are locked.
+ */
+class Simplifier{
+  public:
+    Simplifier(std::vector<uint32_t>const&indices,std::vector<glm::vec3>const&positions,std::vector<uint32_t>const&welded);
+    bool simplify(uint32_t targetTriangles);
+    std::vector<uint32_t>indices  ;
+    float                error = 0.f;///< largest error of performed collapses
+  private:
+    bool flips(uint32_t from,uint32_t to,std::vector<uint32_t>const&offsets,std::vector<uint32_t>const&adjacency)const;
+    std::vector<glm::vec3>const&positions;
+    std::vector<Quadric >quadrics;
+    std::vector<bool    >locked  ;
+};
+
+Simplifier::Simplifier(std::vector<uint32_t>const&i,std::vector<glm::vec3>const&p,std::vector<uint32_t>const&welded):indices(i),positions(p){
+  quadrics.resize(positions.size());
+  locked  .resize(positions.size(),false);
+
+  // area weighted planes of triangles
+  for(size_t t=0;t<indices.size();t+=3){
+    auto const a = glm::dvec3(positions[indices[t+0]]);
+    auto const b = glm::dvec3(positions[indices[t+1]]);
+    auto const c = glm::dvec3(positions[indices[t+2]]);
+    auto n = glm::cross(b-a,c-a);
+    auto const area = glm::length(n);
+    if(area == 0.)continue;
+    n /= area;
+    for(uint32_t k=0;k<3;++k)
+      quadrics[indices[t+k]].addPlane(n,-glm::dot(n,a),area);
+  }
+
+  // vertices with the same position and different attributes lie on a seam
+  std::vector<uint32_t>copies(positions.size(),0);
+  for(uint32_t v=0;v<positions.size();++v)++copies[welded[v]];
+  for(uint32_t v=0;v<positions.size();++v)locked[v] = copies[welded[v]] > 1;
+
+  // border edges are used by one triangle only
+  std::unordered_map<uint64_t,uint32_t>edges;
+  auto const edgeKey = [&](uint32_t a,uint32_t b){
+    a = welded[a];b = welded[b];
+    return a < b ? (uint64_t)a<<32|b : (uint64_t)b<<32|a;
+  };
+  for(size_t t=0;t<indices.size();t+=3)
+    for(uint32_t k=0;k<3;++k)
+      ++edges[edgeKey(indices[t+k],indices[t+(k+1)%3])];
+  for(size_t t=0;t<indices.size();t+=3)
+    for(uint32_t k=0;k<3;++k){
+      auto const a = indices[t+k];
+      auto const b = indices[t+(k+1)%3];
+      if(edges[edgeKey(a,b)] != 1)continue;
+      locked[a] = true;
+      locked[b] = true;
+    }
+}
+
+/**
+ * @brief This function checks whether moving vertex from onto vertex to flips some triangle.
+ */
+bool Simplifier::flips(uint32_t from,uint32_t to,std::vector<uint32_t>const&offsets,std::vector<uint32_t>const&adjacency)const{
+  for(uint32_t a=offsets[from];a<offsets[from+1];++a){
+    auto const*t = indices.data()+adjacency[a]*3;
+    if(t[0] == to || t[1] == to || t[2] == to)continue;
+    glm::vec3 before[3],after[3];
+    for(uint32_t k=0;k<3;++k){
+      before[k] = positions[t[k]];
+      after [k] = positions[t[k] == from ? to : t[k]];
+    }
+    auto const nb = glm::cross(before[1]-before[0],before[2]-before[0]);
+    auto const na = glm::cross(after [1]-after [0],after [2]-after [0]);
+    if(glm::dot(nb,na) <= 0.f)return true;
+  }
+  return false;
+}
+
+/**
+ * @brief This function collapses edges in passes until number of triangles drops to target.
+ * In one pass every vertex takes part in at most one collapse and collapses are ordered by error.
+ *
+ * @return true if target was reached
+ */
+bool Simplifier::simplify(uint32_t targetTriangles){
+  struct Collapse{
+    uint32_t from ;
+    uint32_t to   ;
+    double   error;
+  };
+  std::vector<Collapse>collapses;
+  std::vector<uint32_t>remap(positions.size());
+  std::vector<bool    >touched;
+  std::vector<uint32_t>offsets;
+  std::vector<uint32_t>adjacency;
+
+  while(indices.size()/3 > targetTriangles){
+    auto const nofTriangles = (uint32_t)indices.size()/3;
+
+    offsets.assign(positions.size()+1,0);
+    for(auto i:indices)++offsets[i+1];
+    for(size_t v=0;v<positions.size();++v)offsets[v+1] += offsets[v];
+    adjacency.resize(indices.size());
+    {
+      auto fill = offsets;
+      for(uint32_t t=0;t<nofTriangles;++t)
+        for(uint32_t k=0;k<3;++k)adjacency[fill[indices[t*3+k]]++] = t;
+    }
+
+    collapses.clear();
+    for(size_t t=0;t<indices.size();t+=3)
+      for(uint32_t k=0;k<3;++k){
+        auto const a = indices[t+k];
+        auto const b = indices[t+(k+1)%3];
+        auto q = quadrics[a];
+        q += quadrics[b];
+        if(!locked[a])collapses.push_back({a,b,q.error(positions[b])});
+        if(!locked[b])collapses.push_back({b,a,q.error(positions[a])});
+      }
+    std::sort(collapses.begin(),collapses.end(),[](Collapse const&a,Collapse const&b){return a.error < b.error;});
+
+    for(uint32_t v=0;v<remap.size();++v)remap[v] = v;
+    touched.assign(positions.size(),false);
+    uint32_t removed   = 0;
+    uint32_t performed = 0;
+    for(auto const&c:collapses){
+      if(nofTriangles-removed <= targetTriangles)break;
+      if(touched[c.from] || touched[c.to])continue;
+      if(flips(c.from,c.to,offsets,adjacency))continue;
+
+      // triangles around collapsed vertex change, their vertices wait for the next pass
+      for(uint32_t a=offsets[c.from];a<offsets[c.from+1];++a){
+        auto const*t = indices.data()+adjacency[a]*3;
+        removed += t[0] == c.to || t[1] == c.to || t[2] == c.to;
+        for(uint32_t k=0;k<3;++k)touched[t[k]] = true;
+      }
+      remap[c.from] = c.to;
+      quadrics[c.to] += quadrics[c.from];
+      error = std::max(error,(float)std::sqrt(c.error));
+      ++performed;
+    }
+    if(!performed)return false;
+
+    size_t w = 0;
+    for(size_t t=0;t<indices.size();t+=3){
+      auto const a = remap[indices[t+0]];
+      auto const b = remap[indices[t+1]];
+      auto const c = remap[indices[t+2]];
+      if(a == b || b == c || c == a)continue;
+      indices[w++] = a;
+      indices[w++] = b;
+      indices[w++] = c;
+    }
+    indices.resize(w);
+  }
+  return true;
+}
+
+}
+
+MeshStatistics computeMeshStatistics(Model const&model,Mesh const&mesh){
+  if(!getAttrib(model,mesh.position,0))return MeshStatistics();
+  auto const indices = readIndices(model,mesh);
+  return computeStatistics(indices,readPositions(model,mesh,countVertices(indices)));
+}
+
+OptimizedMeshes::OptimizedMeshes(Model const&model){
+  for(auto const&mesh:model.meshes){
+    meshes.push_back(mesh);
+    before.push_back(computeMeshStatistics(model,mesh));
+    after .push_back(before.back());
+    optimized.push_back(false);
+    if(!before.back().nofTriangles)continue;
+
+    // vertices are interleaved, identical vertices have identical bytes
+    VertexAttrib const*attribs[] = {&mesh.position,&mesh.normal,&mesh.texCoord};
+    uint32_t stride = 0;
+    for(auto const*a:attribs)
+      if(getAttrib(model,*a,0))stride += attributeSize(a->type);
+
+    auto indices = readIndices(model,mesh);
+    auto const nofVertices = countVertices(indices);
+    std::vector<uint8_t>vertices((size_t)nofVertices*stride);
+    for(uint32_t v=0;v<nofVertices;++v){
+      uint32_t offset = 0;
+      for(auto const*a:attribs){
+        auto const*src = getAttrib(model,*a,v);
+        if(!src)continue;
+        std::memcpy(vertices.data()+(size_t)v*stride+offset,src,attributeSize(a->type));
+        offset += attributeSize(a->type);
+      }
+    }
+
+    std::unordered_map<std::string_view,uint32_t>unique;
+    std::vector<uint32_t>remap(nofVertices);
+    std::vector<uint32_t>uniqueVertices;
+    for(uint32_t v=0;v<nofVertices;++v){
+      auto const key = std::string_view((char const*)vertices.data()+(size_t)v*stride,stride);
+      auto const it = unique.emplace(key,(uint32_t)uniqueVertices.size());
+      if(it.second)uniqueVertices.push_back(v);
+      remap[v] = it.first->second;
+    }
+    for(auto&i:indices)i = remap[i];
+
+    std::vector<glm::vec3>positions(uniqueVertices.size());
+    for(size_t v=0;v<uniqueVertices.size();++v)
+      std::memcpy(&positions[v],vertices.data()+(size_t)uniqueVertices[v]*stride,std::min(attributeSize(mesh.position.type),12u));
+
+    indices = tipsify     (indices,(uint32_t)positions.size());
+    indices = sortClusters(indices,positions);
+
+    // vertices are stored in order of their first use
+    std::vector<uint32_t>order(positions.size(),UINT32_MAX);
+    std::vector<glm::vec3>orderedPositions;
+    auto const vertexBase = (data.size()+15)/16*16;
+    data.resize(vertexBase+positions.size()*stride);
+    for(auto&i:indices){
+      if(order[i] == UINT32_MAX){
+        order[i] = (uint32_t)orderedPositions.size();
+        std::memcpy(data.data()+vertexBase+(size_t)order[i]*stride,vertices.data()+(size_t)uniqueVertices[i]*stride,stride);
+        orderedPositions.push_back(positions[i]);
+      }
+      i = order[i];
+    }
+    data.resize(vertexBase+orderedPositions.size()*stride);
+
+    auto&res = meshes.back();
+    uint32_t offset = 0;
+    VertexAttrib*targets[] = {&res.position,&res.normal,&res.texCoord};
+    for(size_t a=0;a<3;++a){
+      if(!getAttrib(model,*attribs[a],0)){
+        *targets[a] = VertexAttrib();
+        continue;
+      }
+      targets[a]->offset = vertexBase+offset;
+      targets[a]->stride = stride;
+      offset += attributeSize(attribs[a]->type);
+    }
+
+    auto const indexBase = (data.size()+3)/4*4;
+    res.indexOffset = indexBase;
+    res.nofIndices  = (uint32_t)indices.size();
+    if(orderedPositions.size() <= UINT16_MAX+1){
+      res.indexType = IndexType::UINT16;
+      data.resize(indexBase+indices.size()*2);
+      for(size_t i=0;i<indices.size();++i){
+        auto const v = (uint16_t)indices[i];
+        std::memcpy(data.data()+indexBase+i*2,&v,2);
+      }
+    }else{
+      res.indexType = IndexType::UINT32;
+      data.resize(indexBase+indices.size()*4);
+      std::memcpy(data.data()+indexBase,indices.data(),indices.size()*4);
+    }
+
+    after.back() = computeStatistics(indices,orderedPositions);
+    optimized.back() = true;
+  }
+}
+
+void OptimizedMeshes::attach(Model&model){
+  auto const bufferID = (int32_t)model.buffers.size();
+  Buffer buffer;
+  buffer.data = data.data();
+  buffer.size = data.size();
+  model.buffers.push_back(buffer);
+  for(size_t i=0;i<meshes.size() && i<model.meshes.size();++i){
+    if(!optimized[i])continue;
+    auto&mesh = model.meshes[i];
+    mesh = meshes[i];
+    mesh.indexBufferID = bufferID;
+    for(auto*a:{&mesh.position,&mesh.normal,&mesh.texCoord})
+      if(a->type != AttributeType::EMPTY)a->bufferID = bufferID;
+  }
+}
+
+MeshLods::MeshLods(Model const&model){
+  uint32_t const minTriangles = 64;
+  for(auto const&mesh:model.meshes){
+    lods.emplace_back();
+    auto&levels = lods.back();
+    levels.push_back({mesh.indexOffset,mesh.nofIndices,0.f});
+    if(!getAttrib(model,mesh.position,0))continue;
+
+    auto const indices   = readIndices(model,mesh);
+    auto const positions = readPositions(model,mesh,countVertices(indices));
+
+    // vertices are welded by position, so seams can be detected
+    std::unordered_map<std::string_view,uint32_t>unique;
+    std::vector<uint32_t>welded(positions.size());
+    for(uint32_t v=0;v<positions.size();++v)
+      welded[v] = unique.emplace(std::string_view((char const*)&positions[v],sizeof(glm::vec3)),v).first->second;
+
+    Simplifier simplifier(indices,positions,welded);
+    auto target = (uint32_t)indices.size()/3;
+    while(levels.size() < maxMeshLods){
+      target /= 4;
+      if(target < minTriangles)break;
+      auto const previous = simplifier.indices.size();
+      simplifier.simplify(target);
+      // level that removes too few triangles is not worth it
+      if(simplifier.indices.empty() || simplifier.indices.size()*10 > previous*9)break;
+
+      auto const offset = (data.size()+3)/4*4;
+      data.resize(offset+simplifier.indices.size()*4);
+      std::memcpy(data.data()+offset,simplifier.indices.data(),simplifier.indices.size()*4);
+      levels.push_back({offset,(uint32_t)simplifier.indices.size(),simplifier.error});
+    }
+  }
+}
+
+void MeshLods::attach(Model&model){
+  bufferID = (int32_t)model.buffers.size();
+  Buffer buffer;
+  buffer.data = data.data();
+  buffer.size = data.size();
+  model.buffers.push_back(buffer);
+}
+
+/**
+ * @brief This function selects level of detail of visible mesh instances.
+ * The coarsest level whose error projected to screen is at most pixelError is used.
+ * Draw commands of culled instances (0 vertices) are not changed.
+ *
+ * @param commandBuffer command buffer created by prepareModel
+ * @param model model with attached levels
+ * @param instances mesh instances created by prepareModel
+ * @param view view matrix
+ * @param proj projection matrix
+ * @param height height of the framebuffer in pixels
+ * @param pixelError allowed error in pixels
+ *
+ * @return number of instances that are not drawn with level 0
+ */
+uint32_t MeshLods::select(CommandBuffer&commandBuffer,Model const&model,std::vector<MeshInstance>const&instances,glm::mat4 const&view,glm::mat4 const&proj,uint32_t height,float pixelError)const{
+  uint32_t simplified = 0;
+  auto const pixelsPerUnit = proj[1][1]*height*.5f;///< at distance 1
+  for(auto const&instance:instances){
+    auto&cmd = commandBuffer.commands[instance.drawCommand].data.drawCommand;
+    if(cmd.nofVertices == 0)continue;
+    auto const&mesh   = model.meshes[instance.mesh];
+    auto const&levels = lods.at(instance.mesh);
+
+    uint32_t level = 0;
+    if(instance.bounded && levels.size() > 1){
+      auto const center = (instance.boundsMin+instance.boundsMax)*.5f;
+      auto const radius = glm::length(instance.boundsMax-instance.boundsMin)*.5f;
+      auto const depth  = -(view*glm::vec4(center,1.f)).z-radius;
+      auto const scale  = std::max({glm::length(glm::vec3(instance.modelMatrix[0])),glm::length(glm::vec3(instance.modelMatrix[1])),glm::length(glm::vec3(instance.modelMatrix[2]))});
+      if(depth > 0.f)
+        while(level+1 < levels.size() && levels[level+1].error*scale*pixelsPerUnit/depth <= pixelError)
+          ++level;
+    }
+
+    cmd.nofVertices = levels[level].nofIndices;
+    if(level == 0){
+      cmd.vao.indexBufferID = mesh.indexBufferID;
+      cmd.vao.indexOffset   = mesh.indexOffset  ;
+      cmd.vao.indexType     = mesh.indexType    ;
+    }else{
+      cmd.vao.indexBufferID = bufferID;
+      cmd.vao.indexOffset   = levels[level].indexOffset;
+      cmd.vao.indexType     = IndexType::UINT32;
+    }
+    simplified += level != 0;
+  }
+  return simplified;
+}
+
+std::ostream&operator<<(std::ostream&o,MeshLods const&m){
+  for(size_t i=0;i<m.lods.size();++i){
+    o << "mesh " << i << " lods:";
+    for(auto const&l:m.lods[i])
+      o << " " << l.nofIndices/3 << " (" << l.error << ")";
+    o << std::endl;
+  }
+  return o;
+}
+
+std::ostream&operator<<(std::ostream&o,OptimizedMeshes const&m){
+  MeshStatistics b,a;
+  double overdrawBefore = 0.,overdrawAfter = 0.;
+  for(size_t i=0;i<m.before.size();++i){
+    auto const&sb = m.before[i];
+    auto const&sa = m.after [i];
+    o << "mesh " << i << ": vertices " << sb.nofVertices << " -> " << sa.nofVertices;
+    o << ", acmr " << sb.acmr << " -> " << sa.acmr;
+    o << ", overdraw " << sb.overdraw << " -> " << sa.overdraw << std::endl;
+    b.nofVertices  += sb.nofVertices ;
+    a.nofVertices  += sa.nofVertices ;
+    b.nofTriangles += sb.nofTriangles;
+    b.acmr         += sb.acmr*sb.nofTriangles;
+    a.acmr         += sa.acmr*sa.nofTriangles;
+    overdrawBefore += sb.overdraw*sb.nofTriangles;
+    overdrawAfter  += sa.overdraw*sa.nofTriangles;
+  }
+  if(!b.nofTriangles)return o;
+  o << "all meshes: vertices " << b.nofVertices << " -> " << a.nofVertices;
+  o << ", acmr " << b.acmr/b.nofTriangles << " -> " << a.acmr/b.nofTriangles;
+  o << ", overdraw " << overdrawBefore/b.nofTriangles << " -> " << overdrawAfter/b.nofTriangles;
+  return o;
+}
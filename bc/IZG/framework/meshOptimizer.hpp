@@ -0,0 +1,79 @@
+/*!
+ * @file
+ * @brief This file contains load time optimization of model meshes.
+ *
+ * @author Tomáš Milet, imilet@fit.vutbr.cz
+ */
+
+#pragma once
+
+#include<vector>
+#include<cstdint>
+#include<iostream>
+#include<student/fwd.hpp>
+#include<student/drawModel.hpp>
+
+uint32_t const meshOptimizerCacheSize = 16;///< size of fifo post transform cache used by optimization and statistics
+uint32_t const maxMeshLods            = 4 ;///< maximal number of levels of detail including the exact mesh
+
+/**
+ * @brief This structure contains statistics of mesh rendering efficiency.
+ */
+struct MeshStatistics{
+  uint32_t nofVertices  = 0  ;///< number of distinct vertices referenced by mesh
+  uint32_t nofTriangles = 0  ;///< number of triangles
+  float    acmr         = 0.f;///< average cache miss ratio, transformed vertices per triangle with fifo cache
+  float    overdraw     = 0.f;///< shaded pixels / covered pixels with depth test, from 6 axis aligned views
+};
+
+MeshStatistics computeMeshStatistics(Model const&model,Mesh const&mesh);
+
+std::vector<uint32_t >readIndices  (Model const&model,Mesh const&mesh);
+std::vector<glm::vec3>readPositions(Model const&model,Mesh const&mesh,uint32_t nofVertices);
+uint32_t              countVertices(std::vector<uint32_t>const&indices);
+
+/**
+ * @brief This class holds optimized copy of model meshes.
+ * Identical vertices are merged, triangles are ordered for post transform cache (Tipsify),
+ * clusters of triangles are ordered to reduce overdraw and vertices are ordered by first use.
+ */
+class OptimizedMeshes{
+  public:
+    OptimizedMeshes(){}
+    OptimizedMeshes(Model const&model);
+    void attach(Model&model);
+    std::vector<uint8_t       >data     ;///< interleaved vertices and indices of all meshes
+    std::vector<Mesh          >meshes   ;///< optimized meshes, attach points them into data
+    std::vector<bool          >optimized;///< mesh was optimized (it has triangles and positions)
+    std::vector<MeshStatistics>before   ;///< statistics of original meshes
+    std::vector<MeshStatistics>after    ;///< statistics of optimized meshes
+};
+
+std::ostream&operator<<(std::ostream&o,OptimizedMeshes const&m);
+
+/**
+ * @brief This structure represents one level of detail of a mesh.
+ * Levels share vertices of the exact mesh, they differ only by indices.
+ */
+struct MeshLod{
+  size_t   indexOffset = 0  ;///< offset of 32-bit indices in MeshLods::data
+  uint32_t nofIndices  = 0  ;///< number of indices
+  float    error       = 0.f;///< object space geometric error of the level
+};
+
+/**
+ * @brief This class holds levels of detail of model meshes created by quadric error metric simplification.
+ * Level 0 is always the exact mesh, coarser levels have roughly 1/4 of triangles of the previous one.
+ */
+class MeshLods{
+  public:
+    MeshLods(){}
+    MeshLods(Model const&model);
+    void attach(Model&model);
+    uint32_t select(CommandBuffer&commandBuffer,Model const&model,std::vector<MeshInstance>const&instances,glm::mat4 const&view,glm::mat4 const&proj,uint32_t height,float pixelError = 1.f)const;
+    std::vector<uint8_t             >data    ;///< indices of all coarse levels
+    std::vector<std::vector<MeshLod>>lods    ;///< levels of every mesh, level 0 is the exact mesh
+    int32_t                          bufferID = -1;///< buffer with data, set by attach
+};
+
+std::ostream&operator<<(std::ostream&o,MeshLods const&m);
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 
 #include <glm/glm.hpp>
 
@@ -54,5 +55,12 @@ class Method{
      * @param dt delta time - time between frames
      */
     virtual void onUpdate(float dt){(void)dt;}
+    /**
+     * @brief This function returns statistics of the method that are shown in window title.
+     * It is called from main thread while the method renders next frame in render thread.
+     *
+     * @return statistics or empty string
+     */
+    virtual std::string getStatistics()const{return "";}
 };
 
@@ -1,10 +1,15 @@
 #include <iostream>
+#include <chrono>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 
 #include <framework/model.hpp>
+#include <framework/textureData.hpp>
+#include <framework/modelCache.hpp>
+#include <student/threadPool.hpp>
 #include <libs/tiny_gltf/tiny_gltf.h>
+#include <libs/stb_image/stb_image.h>
 
 namespace tests{
 void printModel(Model const&model);
@@ -36,31 +41,159 @@ std::string accesstorType2Str(int i){
   return "unknow";
 }
 
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsedMs(Clock::time_point start){
+  return std::chrono::duration<double,std::milli>(Clock::now()-start).count();
+}
+
+/**
+ * @brief This structure represents encoded image whose decoding is postponed after parsing.
+ */
+struct EncodedImage{
+  int                 id       ;///< index into model images
+  int                 reqWidth ;///< required width or 0
+  int                 reqHeight;///< required height or 0
+  std::vector<uint8_t>bytes    ;///< encoded image file
+};
+
 class ModelDataImpl{
   public:
     ModelDataImpl();
-    void load(std::string const&fileName);
+    void load(std::string const&fileName,bool useCache);
     ~ModelDataImpl();
     Model getModel();
+    void decodeImages();
     bool ret = false;
     tinygltf::Model model;
     tinygltf::TinyGLTF loader;
+    std::vector<TextureMipmaps>mipmaps;///< mip pyramids of model images
+    ModelCache cache;///< preprocessed model mapped from cache file
+    std::vector<EncodedImage>encodedImages;///< images waiting for decoding
+    ModelLoadTimings timings;
 };
 
+/**
+ * @brief This function is image loader of tinygltf, it only stores encoded image for decodeImages.
+ */
+bool deferImage(tinygltf::Image*,int const id,std::string*,std::string*,int reqWidth,int reqHeight,unsigned char const*bytes,int size,void*userData){
+  auto*impl = (ModelDataImpl*)userData;
+  impl->encodedImages.push_back({id,reqWidth,reqHeight,std::vector<uint8_t>(bytes,bytes+size)});
+  return true;
+}
+
+/**
+ * @brief This function reads file for tinygltf and measures the time spent by reading.
+ */
+bool readFile(std::vector<unsigned char>*out,std::string*err,std::string const&fileName,void*userData){
+  auto*impl = (ModelDataImpl*)userData;
+  auto const start = Clock::now();
+  auto const res = tinygltf::ReadWholeFile(out,err,fileName,nullptr);
+  impl->timings.fileIO += elapsedMs(start);
+  return res;
+}
+
 ModelDataImpl::ModelDataImpl(){
+  loader.SetImageLoader(deferImage,this);
+  tinygltf::FsCallbacks fs;
+  fs.FileExists     = tinygltf::FileExists    ;
+  fs.ExpandFilePath = tinygltf::ExpandFilePath;
+  fs.ReadWholeFile  = readFile                ;
+  fs.WriteWholeFile = tinygltf::WriteWholeFile;
+  fs.user_data      = this                    ;
+  loader.SetFsCallbacks(fs);
+}
+
+/**
+ * @brief This function decodes all images stored by deferImage in parallel.
+ * Images are decoded directly into RGBA8 and their mip pyramids are created by the same thread.
+ */
+void ModelDataImpl::decodeImages(){
+  ThreadPool pool;
+  pool.resize(0);
+  std::vector<std::string>errors(encodedImages.size());
+  mipmaps.clear();
+  mipmaps.resize(model.images.size());
+  pool.parallelFor((uint32_t)encodedImages.size(),[&](uint32_t i,uint32_t){
+    auto const&encoded = encodedImages[i];
+    auto&img = model.images.at(encoded.id);
+    int w,h,channels;
+    auto*data = stbi_load_from_memory(encoded.bytes.data(),(int)encoded.bytes.size(),&w,&h,&channels,4);
+    if(!data){
+      errors[i] = "cannot decode image["+std::to_string(encoded.id)+"] \""+img.name+"\"";
+      return;
+    }
+    if((encoded.reqWidth && encoded.reqWidth != w) || (encoded.reqHeight && encoded.reqHeight != h)){
+      errors[i] = "image["+std::to_string(encoded.id)+"] \""+img.name+"\" has wrong size";
+      stbi_image_free(data);
+      return;
+    }
+    img.width      = w;
+    img.height     = h;
+    img.component  = 4;
+    img.bits       = 8;
+    img.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    img.image.assign(data,data+(size_t)w*h*4);
+    stbi_image_free(data);
+
+    Texture tex;
+    tex.data     = img.image.data();
+    tex.width    = w;
+    tex.height   = h;
+    tex.channels = 4;
+    mipmaps[encoded.id] = TextureMipmaps(tex);
+  });
+  for(auto const&e:errors)
+    if(!e.empty())std::cerr << "model: " << e << std::endl;
+  encodedImages.clear();
 }
 
-void ModelDataImpl::load(std::string const&fileName){
+void ModelDataImpl::load(std::string const&fileName,bool useCache){
+  // preprocessed model is stored next to the model file
+  auto const cacheName = fileName+".izgcache";
+  auto const stamp     = getFileStamp(fileName);
+  timings = ModelLoadTimings();
+  // model of previous load must not be returned if this one fails or skips the cache
+  cache.close();
+  model = tinygltf::Model();
+  mipmaps.clear();
+  encodedImages.clear();
+  ret = false;
+  auto start = Clock::now();
+  if(useCache && stamp && cache.load(cacheName,stamp)){
+    timings.fileIO = elapsedMs(start);
+    return;
+  }
+
   std::string err;
   std::string warn;
+  start = Clock::now();
   if(fileName.find(".glb")==fileName.length()-4)
     ret = loader.LoadBinaryFromFile(&model, &err, &warn, fileName.c_str());
 
   if(fileName.find(".gltf")==fileName.length()-5)
     ret = loader.LoadASCIIFromFile(&model, &err, &warn, fileName.c_str());
+  timings.jsonParse = elapsedMs(start)-timings.fileIO;
 
-  if(!ret)
+  if(!ret){
+    encodedImages.clear();
     std::cerr << "model: " << fileName << "was not loaded" << std::endl;
+    return;
+  }
+
+  start = Clock::now();
+  decodeImages();
+  timings.imageDecode = elapsedMs(start);
+
+  if(!useCache || !stamp)return;
+  if(!saveModelCache(cacheName,getModel(),stamp)){
+    std::cerr << "model: cache " << cacheName << " was not written" << std::endl;
+    return;
+  }
+  if(!cache.load(cacheName,stamp))return;
+  // everything is served from the cache now
+  model = tinygltf::Model();
+  mipmaps.clear();
 }
 
 ModelDataImpl::~ModelDataImpl(){
@@ -101,6 +234,12 @@ Node loadNode(tinygltf::Node const&root,tinygltf::Model const&model){
 }
 
 Model ModelDataImpl::getModel(){
+  auto const start = Clock::now();
+  if(cache.isLoaded()){
+    auto res = cache.getModel();
+    timings.bufferSetup += elapsedMs(start);
+    return res;
+  }
   Model res;
   if(!ret)return res;
 
@@ -132,6 +271,14 @@ Model ModelDataImpl::getModel(){
     tex.data     = img.image.data();
   }
 
+  if(mipmaps.size() != res.textures.size()){
+    mipmaps.clear();
+    for(auto const&tex:res.textures)
+      mipmaps.emplace_back(tex);
+  }
+  for(size_t i=0;i<res.textures.size();++i)
+    mipmaps[i].attach(res.textures[i]);
+
   for(auto const&buf:model.buffers){
     Buffer buffer;
     buffer.data = (void const*)buf.data.data();
@@ -269,11 +416,12 @@ Model ModelDataImpl::getModel(){
     //std::cerr << __LINE__ << std::endl;
 
   //tests::printModel(res);
+  timings.bufferSetup += elapsedMs(start);
   return res;
 }
 
-void ModelData::load(std::string const&fileName){
-  impl->load(fileName);
+void ModelData::load(std::string const&fileName,bool useCache){
+  impl->load(fileName,useCache);
 }
 
 ModelData::ModelData(){
@@ -287,3 +435,15 @@ ModelData::~ModelData(){
 Model ModelData::getModel(){
   return impl->getModel();
 }
+
+ModelLoadTimings const&ModelData::getTimings()const{
+  return impl->timings;
+}
+
+std::ostream&operator<<(std::ostream&o,ModelLoadTimings const&t){
+  o << "file I/O: "     << t.fileIO      << " ms, ";
+  o << "json parse: "   << t.jsonParse   << " ms, ";
+  o << "image decode: " << t.imageDecode << " ms, ";
+  o << "buffer setup: " << t.bufferSetup << " ms";
+  return o;
+}
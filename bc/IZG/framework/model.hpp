@@ -6,13 +6,26 @@
 
 #include<student/fwd.hpp>
 
+/**
+ * @brief This structure contains durations of model loading phases in milliseconds.
+ */
+struct ModelLoadTimings{
+  double fileIO      = 0.;///< reading of model, buffer and image files (or mapping of cache)
+  double jsonParse   = 0.;///< parsing of gltf without file reading and image decoding
+  double imageDecode = 0.;///< decoding of all images including their mip pyramids
+  double bufferSetup = 0.;///< creation of model structures and buffers
+};
+
+std::ostream&operator<<(std::ostream&o,ModelLoadTimings const&t);
+
 class ModelDataImpl;
 class ModelData{
   public:
     ModelData();
-    void load(std::string const&fileName);
+    void load(std::string const&fileName,bool useCache = true);
     ~ModelData();
     Model getModel();
+    ModelLoadTimings const&getTimings()const;
   private:
     friend class ModelDataImpl;
     ModelDataImpl*impl = nullptr;
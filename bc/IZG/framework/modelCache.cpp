@@ -0,0 +1,453 @@
+#include<framework/modelCache.hpp>
+
+#include<algorithm>
+#include<cstring>
+#include<filesystem>
+#include<fstream>
+#include<functional>
+
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+MappedFile::~MappedFile(){
+  close();
+}
+
+bool MappedFile::open(std::string const&fileName){
+  close();
+#ifdef _WIN32
+  auto file = CreateFileA(fileName.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+  if(file == INVALID_HANDLE_VALUE)return false;
+  handle = file;
+  LARGE_INTEGER fileSize;
+  if(!GetFileSizeEx(file,&fileSize) || fileSize.QuadPart == 0){close();return false;}
+  mapping = CreateFileMappingA(file,nullptr,PAGE_READONLY,0,0,nullptr);
+  if(!mapping){close();return false;}
+  data = (uint8_t const*)MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+  if(!data){close();return false;}
+  size = (size_t)fileSize.QuadPart;
+#else
+  int fd = ::open(fileName.c_str(),O_RDONLY);
+  if(fd < 0)return false;
+  struct stat st;
+  if(fstat(fd,&st) != 0 || st.st_size == 0){::close(fd);return false;}
+  void*ptr = mmap(nullptr,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  // mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if(ptr == MAP_FAILED)return false;
+  data = (uint8_t const*)ptr;
+  size = (size_t)st.st_size;
+#endif
+  return true;
+}
+
+void MappedFile::close(){
+#ifdef _WIN32
+  if(data   )UnmapViewOfFile(data);
+  if(mapping)CloseHandle(mapping);
+  if(handle )CloseHandle(handle);
+#else
+  if(data)munmap((void*)data,size);
+#endif
+  data    = nullptr;
+  size    = 0;
+  handle  = nullptr;
+  mapping = nullptr;
+}
+
+uint64_t getFileStamp(std::string const&fileName){
+  std::error_code ec;
+  auto const size = std::filesystem::file_size(fileName,ec);
+  if(ec)return 0;
+  auto const time = std::filesystem::last_write_time(fileName,ec);
+  if(ec)return 0;
+  auto const ticks = (uint64_t)time.time_since_epoch().count();
+  return (ticks*1099511628211ull)^size^1;
+}
+
+namespace{
+
+char     const cacheMagic[8]  = {'I','Z','G','M','O','D','E','L'};
+uint32_t const cacheVersion   = 1;
+uint64_t const cacheAlignment = 64;///< sections start on cache lines, textures tiles do not cross them
+
+/**
+ * @brief Header at the beginning of cache file, offsets are from the beginning of the file.
+ */
+struct CacheHeader{
+  char     magic[8]       = {};
+  uint32_t version        = 0;
+  uint32_t nofTextures    = 0;
+  uint64_t sourceStamp    = 0;
+  uint32_t nofMeshes      = 0;
+  uint32_t nofNodes       = 0;
+  uint64_t texturesOffset = 0;///< CacheTexture[nofTextures]
+  uint64_t meshesOffset   = 0;///< Mesh[nofMeshes], attributes and indices point into buffer 0
+  uint64_t nodesOffset    = 0;///< CacheNode[nofNodes]
+  uint64_t geometryOffset = 0;///< content of buffer 0
+  uint64_t geometrySize   = 0;///< size of buffer 0
+};
+
+/**
+ * @brief Texture stored in cache, data are RGBA8 row by row followed by tiled mip levels.
+ */
+struct CacheTexture{
+  uint32_t width         = 0;
+  uint32_t height        = 0;
+  uint32_t channels      = 0;///< 4 for stored textures, original value for textures without data
+  uint32_t hasData       = 0;
+  uint64_t dataOffset    = 0;
+  uint64_t mipmapsOffset = 0;
+};
+
+/**
+ * @brief Node stored in cache, nodes are in preorder and parent precedes its children.
+ */
+struct CacheNode{
+  glm::mat4 modelMatrix = glm::mat4(1.f);
+  int32_t   mesh        = -1;
+  int32_t   parent      = -1;
+};
+
+uint64_t align(uint64_t offset){
+  return (offset+cacheAlignment-1)/cacheAlignment*cacheAlignment;
+}
+
+void appendBytes(std::vector<uint8_t>&out,void const*data,size_t size){
+  out.insert(out.end(),(uint8_t const*)data,(uint8_t const*)data+size);
+}
+
+void appendPadding(std::vector<uint8_t>&out,uint64_t base){
+  out.resize(align(base+out.size())-base,0);
+}
+
+void flattenNodes(std::vector<CacheNode>&nodes,Node const&node,int32_t parent){
+  CacheNode n;
+  n.modelMatrix = node.modelMatrix;
+  n.mesh        = node.mesh;
+  n.parent      = parent;
+  nodes.push_back(n);
+  auto const id = (int32_t)nodes.size()-1;
+  for(auto const&child:node.children)
+    flattenNodes(nodes,child,id);
+}
+
+uint32_t attributeSize(AttributeType type){
+  return type == AttributeType::EMPTY ? 0 : 4*((uint32_t)type&7);
+}
+
+uint32_t readIndex(uint8_t const*indices,IndexType type,uint32_t i){
+  if(type == IndexType::UINT8 )return indices[i];
+  if(type == IndexType::UINT16){uint16_t v;std::memcpy(&v,indices+2*i,2);return v;}
+  uint32_t v;std::memcpy(&v,indices+4*i,4);return v;
+}
+
+/**
+ * @brief This function appends interleaved vertices and indices of mesh into geometry buffer.
+ *
+ * @return mesh whose attributes and indices point into the geometry buffer
+ */
+Mesh appendMesh(std::vector<uint8_t>&geometry,Mesh const&mesh,Model const&model){
+  Mesh res = mesh;
+
+  auto const getBuffer = [&](int32_t id)->uint8_t const*{
+    if(id < 0 || id >= (int32_t)model.buffers.size())return nullptr;
+    return (uint8_t const*)model.buffers[id].data;
+  };
+
+  // indexed mesh references vertices up to the largest index
+  uint8_t const*indices = getBuffer(mesh.indexBufferID);
+  uint32_t nofVertices = mesh.nofIndices;
+  if(indices){
+    indices += mesh.indexOffset;
+    nofVertices = 0;
+    for(uint32_t i=0;i<mesh.nofIndices;++i)
+      nofVertices = std::max(nofVertices,readIndex(indices,mesh.indexType,i)+1);
+  }
+
+  VertexAttrib const*sources[] = {&mesh.position,&mesh.normal,&mesh.texCoord};
+  VertexAttrib      *targets[] = {&res .position,&res .normal,&res .texCoord};
+  uint64_t stride = 0;
+  for(auto const*s:sources)
+    if(getBuffer(s->bufferID))stride += attributeSize(s->type);
+
+  auto const vertexBase = (uint64_t)geometry.size();
+  geometry.resize(vertexBase+stride*nofVertices);
+  uint64_t attribOffset = 0;
+  for(size_t a=0;a<3;++a){
+    auto const&s    = *sources[a];
+    auto      &t    = *targets[a];
+    auto const*src  = getBuffer(s.bufferID);
+    auto const size = attributeSize(s.type);
+    if(!src || !size){
+      t = VertexAttrib();
+      continue;
+    }
+    for(uint32_t v=0;v<nofVertices;++v)
+      std::memcpy(geometry.data()+vertexBase+v*stride+attribOffset,src+s.offset+v*s.stride,size);
+    t.bufferID = 0;
+    t.offset   = vertexBase+attribOffset;
+    t.stride   = stride;
+    attribOffset += size;
+  }
+
+  if(indices){
+    geometry.resize((geometry.size()+3)/4*4,0);
+    res.indexBufferID = 0;
+    res.indexOffset   = geometry.size();
+    appendBytes(geometry,indices,(size_t)mesh.nofIndices*(uint32_t)mesh.indexType);
+  }
+  return res;
+}
+
+/**
+ * @brief This function returns true if count items of size bytes at offset fit into limit, it cannot overflow.
+ */
+bool fits(uint64_t offset,uint64_t count,uint64_t size,uint64_t limit){
+  if(offset > limit)return false;
+  return size == 0 || count <= (limit-offset)/size;
+}
+
+/**
+ * @brief This function returns true if texture of cache points only into the file.
+ */
+bool isTextureValid(CacheTexture const&t,uint64_t fileSize){
+  if(!t.hasData)return true;
+  // larger textures are not produced by loader, it also keeps tile padding of mipmaps in 32 bits
+  uint32_t const maxSize = 1u<<16;
+  if(t.channels != 4 || !t.width || !t.height || t.width > maxSize || t.height > maxSize)return false;
+  if(!fits(t.dataOffset,(uint64_t)t.width*t.height,4,fileSize))return false;
+  return fits(t.mipmapsOffset,TextureMipmaps().createLevels(t.width,t.height),1,fileSize);
+}
+
+/**
+ * @brief This function returns true if attributes and indices of mesh of cache point only into geometry buffer.
+ */
+bool isMeshValid(Mesh const&mesh,CacheHeader const&header,uint8_t const*geometry){
+  if(mesh.diffuseTexture < -1 || mesh.diffuseTexture >= (int)header.nofTextures)return false;
+  // bool with other value than 0 or 1 cannot be read as bool
+  uint8_t doubleSided;
+  std::memcpy(&doubleSided,&mesh.doubleSided,sizeof(doubleSided));
+  if(doubleSided > 1)return false;
+
+  // indexed mesh references vertices up to the largest index
+  uint64_t nofVertices = mesh.nofIndices;
+  if(mesh.indexBufferID != -1){
+    if(mesh.indexBufferID != 0)return false;
+    if(mesh.indexType != IndexType::UINT8 && mesh.indexType != IndexType::UINT16 && mesh.indexType != IndexType::UINT32)return false;
+    if(!fits(mesh.indexOffset,mesh.nofIndices,(uint32_t)mesh.indexType,header.geometrySize))return false;
+    nofVertices = 0;
+    for(uint32_t i=0;i<mesh.nofIndices;++i)
+      nofVertices = std::max<uint64_t>(nofVertices,readIndex(geometry+mesh.indexOffset,mesh.indexType,i)+1ull);
+  }
+
+  for(auto const*a:{&mesh.position,&mesh.normal,&mesh.texCoord}){
+    if(a->bufferID == -1)continue;
+    auto const size = attributeSize(a->type);
+    if(a->bufferID != 0 || !size || ((uint32_t)a->type&7) > 4 || (uint32_t)a->type > (uint32_t)AttributeType::UVEC4)return false;
+    if(nofVertices == 0)continue;
+    // the last vertex starts at offset+stride*(nofVertices-1)
+    if(!fits(a->offset,1,size,header.geometrySize))return false;
+    if(!fits(a->offset+size,nofVertices-1,a->stride,header.geometrySize))return false;
+  }
+  return true;
+}
+
+Node createNode(std::vector<CacheNode>const&nodes,std::vector<std::vector<int32_t>>const&children,int32_t id){
+  Node res;
+  res.modelMatrix = nodes[id].modelMatrix;
+  res.mesh        = nodes[id].mesh;
+  for(auto c:children[id])
+    res.children.emplace_back(createNode(nodes,children,c));
+  return res;
+}
+
+}
+
+bool saveModelCache(std::string const&fileName,Model const&model,uint64_t sourceStamp){
+  CacheHeader header;
+  std::memcpy(header.magic,cacheMagic,sizeof(cacheMagic));
+  header.version     = cacheVersion;
+  header.sourceStamp = sourceStamp;
+  header.nofTextures = (uint32_t)model.textures.size();
+  header.nofMeshes   = (uint32_t)model.meshes  .size();
+
+  std::vector<CacheNode>nodes;
+  for(auto const&root:model.roots)
+    flattenNodes(nodes,root,-1);
+  header.nofNodes = (uint32_t)nodes.size();
+
+  std::vector<uint8_t>geometry;
+  std::vector<Mesh>meshes;
+  for(auto const&mesh:model.meshes)
+    meshes.push_back(appendMesh(geometry,mesh,model));
+
+  // everything after header is assembled in memory, offsets are known when it is written
+  std::vector<uint8_t>body;
+  uint64_t const base = align(sizeof(CacheHeader));
+
+  std::vector<CacheTexture>textures(model.textures.size());
+  header.texturesOffset = base+body.size();
+  body.resize(body.size()+textures.size()*sizeof(CacheTexture));
+  appendPadding(body,base);
+
+  for(size_t i=0;i<model.textures.size();++i){
+    auto const&tex = model.textures[i];
+    auto&t = textures[i];
+    t.width    = tex.width;
+    t.height   = tex.height;
+    t.channels = tex.channels;
+    if(!tex.data)continue;
+    t.channels = 4;
+    t.hasData  = 1;
+
+    // RGBA8, missing channels are 0 and missing alpha is 255
+    t.dataOffset = base+body.size();
+    auto const channels = std::min(tex.channels,4u);
+    auto const start = body.size();
+    body.resize(start+(size_t)tex.width*tex.height*4,0);
+    for(size_t p=0;p<(size_t)tex.width*tex.height;++p){
+      auto*d = body.data()+start+p*4;
+      d[3] = 255;
+      for(uint32_t c=0;c<channels;++c)
+        d[c] = tex.data[p*tex.channels+c];
+    }
+    appendPadding(body,base);
+
+    auto const mipmaps = TextureMipmaps(tex);
+    t.mipmapsOffset = base+body.size();
+    appendBytes(body,mipmaps.data.data(),mipmaps.data.size());
+    appendPadding(body,base);
+  }
+  if(!textures.empty())
+    std::memcpy(body.data()+header.texturesOffset-base,textures.data(),textures.size()*sizeof(CacheTexture));
+
+  header.meshesOffset = base+body.size();
+  appendBytes(body,meshes.data(),meshes.size()*sizeof(Mesh));
+  appendPadding(body,base);
+
+  header.nodesOffset = base+body.size();
+  appendBytes(body,nodes.data(),nodes.size()*sizeof(CacheNode));
+  appendPadding(body,base);
+
+  header.geometryOffset = base+body.size();
+  header.geometrySize   = geometry.size();
+
+  // cache is written under temporary name, so a crash never leaves incomplete cache
+  auto const tmpName = fileName+".tmp";
+  {
+    std::ofstream file(tmpName,std::ios::binary|std::ios::trunc);
+    if(!file)return false;
+    std::vector<uint8_t>headerBytes(base,0);
+    std::memcpy(headerBytes.data(),&header,sizeof(header));
+    file.write((char const*)headerBytes.data(),headerBytes.size());
+    file.write((char const*)body.data(),body.size());
+    file.write((char const*)geometry.data(),geometry.size());
+    if(!file){
+      file.close();
+      std::remove(tmpName.c_str());
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmpName,fileName,ec);
+  if(ec){
+    std::remove(tmpName.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool ModelCache::load(std::string const&fileName,uint64_t sourceStamp){
+  mipmaps.clear();
+  if(!file.open(fileName))return false;
+
+  CacheHeader header;
+  bool valid = file.size >= sizeof(header);
+  if(valid)std::memcpy(&header,file.data,sizeof(header));
+  valid = valid && std::memcmp(header.magic,cacheMagic,sizeof(cacheMagic)) == 0;
+  valid = valid && header.version     == cacheVersion;
+  valid = valid && header.sourceStamp == sourceStamp;
+  // sections are aligned by saveModelCache, so their structures can be read in place
+  valid = valid && header.texturesOffset%cacheAlignment == 0 && fits(header.texturesOffset,header.nofTextures,sizeof(CacheTexture),file.size);
+  valid = valid && header.meshesOffset  %cacheAlignment == 0 && fits(header.meshesOffset  ,header.nofMeshes  ,sizeof(Mesh        ),file.size);
+  valid = valid && header.nodesOffset   %cacheAlignment == 0 && fits(header.nodesOffset   ,header.nofNodes   ,sizeof(CacheNode   ),file.size);
+  valid = valid && header.geometryOffset%cacheAlignment == 0 && fits(header.geometryOffset,header.geometrySize,1                   ,file.size);
+
+  // stale or corrupted cache must not point outside of the file
+  auto const*textures = (CacheTexture const*)(file.data+header.texturesOffset);
+  for(uint32_t i=0;valid && i<header.nofTextures;++i)
+    valid = isTextureValid(textures[i],file.size);
+
+  auto const*meshes = (Mesh const*)(file.data+header.meshesOffset);
+  for(uint32_t i=0;valid && i<header.nofMeshes;++i)
+    valid = isMeshValid(meshes[i],header,file.data+header.geometryOffset);
+
+  // nodes are in preorder, so parent precedes its children and there are no cycles
+  auto const*nodes = (CacheNode const*)(file.data+header.nodesOffset);
+  for(uint32_t i=0;valid && i<header.nofNodes;++i)
+    valid = nodes[i].parent < (int32_t)i && nodes[i].parent >= -1 && nodes[i].mesh < (int32_t)header.nofMeshes;
+
+  if(!valid){
+    file.close();
+    return false;
+  }
+  return true;
+}
+
+bool ModelCache::isLoaded()const{
+  return file.data != nullptr;
+}
+
+void ModelCache::close(){
+  mipmaps.clear();
+  file.close();
+}
+
+Model ModelCache::getModel(){
+  Model res;
+  if(!isLoaded())return res;
+
+  CacheHeader header;
+  std::memcpy(&header,file.data,sizeof(header));
+
+  auto const*textures = (CacheTexture const*)(file.data+header.texturesOffset);
+  mipmaps.clear();
+  for(uint32_t i=0;i<header.nofTextures;++i){
+    auto const&t = textures[i];
+    Texture tex;
+    tex.data     = t.hasData ? file.data+t.dataOffset : nullptr;
+    tex.width    = t.width;
+    tex.height   = t.height;
+    tex.channels = t.channels;
+    if(t.hasData)mipmaps.emplace_back(t.width,t.height,file.data+t.mipmapsOffset);
+    else         mipmaps.emplace_back();
+    res.textures.push_back(tex);
+  }
+  for(size_t i=0;i<res.textures.size();++i)
+    mipmaps[i].attach(res.textures[i]);
+
+  auto const*meshes = (Mesh const*)(file.data+header.meshesOffset);
+  res.meshes.assign(meshes,meshes+header.nofMeshes);
+
+  Buffer geometry;
+  geometry.data = file.data+header.geometryOffset;
+  geometry.size = header.geometrySize;
+  res.buffers.push_back(geometry);
+
+  auto const*cacheNodes = (CacheNode const*)(file.data+header.nodesOffset);
+  std::vector<CacheNode>nodes(cacheNodes,cacheNodes+header.nofNodes);
+  std::vector<std::vector<int32_t>>children(nodes.size());
+  for(size_t i=0;i<nodes.size();++i)
+    if(nodes[i].parent >= 0)children[nodes[i].parent].push_back((int32_t)i);
+  for(size_t i=0;i<nodes.size();++i)
+    if(nodes[i].parent < 0)res.roots.push_back(createNode(nodes,children,(int32_t)i));
+
+  return res;
+}
@@ -0,0 +1,70 @@
+/*!
+ * @file
+ * @brief This file contains binary cache of preprocessed models.
+ *
+ * @author Tomáš Milet, imilet@fit.vutbr.cz
+ */
+
+#pragma once
+
+#include<string>
+#include<vector>
+
+#include<student/fwd.hpp>
+#include<framework/textureData.hpp>
+
+/**
+ * @brief This class represents read only file mapped into memory.
+ */
+class MappedFile{
+  public:
+    MappedFile(){}
+    ~MappedFile();
+    MappedFile(MappedFile const&) = delete;
+    MappedFile&operator=(MappedFile const&) = delete;
+    bool open(std::string const&fileName);
+    void close();
+    uint8_t const*data = nullptr;///< content of the file
+    size_t        size = 0      ;///< size of the file
+  private:
+    void*handle  = nullptr;///< windows file handle
+    void*mapping = nullptr;///< windows mapping handle
+};
+
+/**
+ * @brief This function returns stamp of a file that changes when the file is modified.
+ *
+ * @param fileName file
+ *
+ * @return stamp made from size and modification time, 0 if file does not exist
+ */
+uint64_t getFileStamp(std::string const&fileName);
+
+/**
+ * @brief This function converts model into binary cache file.
+ * Textures are stored decoded in RGBA8 together with their mip pyramids,
+ * vertex attributes of every mesh are interleaved into one buffer followed by indices
+ * and the node trees are stored as a flat list.
+ *
+ * @param fileName cache file
+ * @param model model
+ * @param sourceStamp stamp of the source model file (see getFileStamp)
+ *
+ * @return true if cache was written
+ */
+bool saveModelCache(std::string const&fileName,Model const&model,uint64_t sourceStamp);
+
+/**
+ * @brief This class holds model loaded from binary cache file.
+ * Buffer::data, Texture::data and texture levels point directly into the mapped file.
+ */
+class ModelCache{
+  public:
+    bool load(std::string const&fileName,uint64_t sourceStamp);
+    bool isLoaded()const;
+    void close();
+    Model getModel();
+  private:
+    MappedFile                 file   ;///< mapped cache file
+    std::vector<TextureMipmaps>mipmaps;///< mip levels pointing into the file
+};
@@ -0,0 +1,321 @@
+#include<framework/occlusionCulling.hpp>
+#include<framework/meshOptimizer.hpp>
+
+#include<algorithm>
+#include<cmath>
+#include<string_view>
+#include<unordered_map>
+
+namespace{
+
+float const depthBias = 1e-6f;///< box has to be behind occluders at least by this depth, it hides rounding of different transformations
+
+/**
+ * @brief This function converts clip space position to position in the occlusion buffer and depth.
+ */
+glm::dvec3 toBuffer(glm::vec4 const&p){
+  return glm::dvec3(
+      (p.x/p.w*.5+.5)*occlusionBufferWidth ,
+      (p.y/p.w*.5+.5)*occlusionBufferHeight,
+      p.z/p.w);
+}
+
+/**
+ * @brief This function projects bounding box into the occlusion buffer.
+ *
+ * @param rect output screen space rectangle (min x, min y, max x, max y) in pixels of the buffer
+ * @param minDepth output the closest depth of the box
+ * @param viewProjection view projection matrix
+ * @param boundsMin world space bounding box
+ * @param boundsMax world space bounding box
+ *
+ * @return false if the box crosses the near plane, rect and minDepth are not valid
+ */
+bool projectBox(glm::dvec4&rect,float&minDepth,glm::mat4 const&viewProjection,glm::vec3 const&boundsMin,glm::vec3 const&boundsMax){
+  rect     = glm::dvec4(INFINITY,INFINITY,-INFINITY,-INFINITY);
+  minDepth = INFINITY;
+  for(uint32_t c=0;c<8;++c){
+    auto const p = viewProjection*glm::vec4(c&1?boundsMax.x:boundsMin.x,c&2?boundsMax.y:boundsMin.y,c&4?boundsMax.z:boundsMin.z,1.f);
+    if(p.w <= 0.f || p.z < -p.w)return false;
+    auto const s = toBuffer(p);
+    rect     = glm::dvec4(glm::min(glm::dvec2(rect),glm::dvec2(s)),glm::max(glm::dvec2(rect.z,rect.w),glm::dvec2(s)));
+    minDepth = std::min(minDepth,(float)s.z);
+  }
+  return true;
+}
+
+/**
+ * @brief This function returns pixels of the buffer touched by rectangle, max is exclusive.
+ */
+glm::ivec4 toPixels(glm::dvec4 const&rect){
+  return glm::ivec4(
+      std::clamp(std::floor(rect.x),0.,(double)occlusionBufferWidth ),
+      std::clamp(std::floor(rect.y),0.,(double)occlusionBufferHeight),
+      std::clamp(std::ceil (rect.z),0.,(double)occlusionBufferWidth ),
+      std::clamp(std::ceil (rect.w),0.,(double)occlusionBufferHeight));
+}
+
+/**
+ * @brief This function returns doubled signed area of projected triangle, it is positive for front faces.
+ */
+double doubleArea(glm::dvec3 const*v){
+  return (v[1].x-v[0].x)*(v[2].y-v[0].y)-(v[1].y-v[0].y)*(v[2].x-v[0].x);
+}
+
+/**
+ * @brief This function returns depth plane of projected triangle, depth = dot(plane,vec3(x,y,1)).
+ */
+glm::dvec3 depthPlane(glm::dvec3 const*v){
+  auto const area = doubleArea(v);
+  glm::dvec3 plane(0.);
+  for(uint32_t k=0;k<3;++k){
+    auto const&a = v[(k+1)%3];
+    auto const&b = v[(k+2)%3];
+    plane += glm::dvec3(a.y-b.y,b.x-a.x,a.x*b.y-a.y*b.x)*v[k].z/area;
+  }
+  return plane;
+}
+
+/**
+ * @brief This function rasterizes depth of projected triangle.
+ * Pixels have to be fully covered by outer edges of the mesh, so the buffer does not grow over silhouettes.
+ * Interior edges are sampled at pixel centers, pixels on them are covered by the neighbouring triangle too.
+ * Written depth is the farthest depth of the triangle plane inside of the pixel,
+ * it is increased by creaseOffset, because the pixel can reach behind interior edges where neighbours are farther.
+ *
+ * @param depth depth buffer
+ * @param vertices triangle in the buffer
+ * @param interior edge k (opposite to vertex k) is shared with rasterized triangle of the same orientation
+ * @param creaseOffset maximal difference of neighbouring planes inside of pixel
+ */
+void rasterizeTriangle(std::vector<float>&depth,glm::dvec3 const*vertices,bool const(&interior)[3],double creaseOffset){
+  glm::dvec3 v[3] = {vertices[0],vertices[1],vertices[2]};
+  bool       in[3] = {interior[0],interior[1],interior[2]};
+  auto area = doubleArea(v);
+  if(area == 0.)return;
+  if(area < 0.){
+    std::swap(v [1],v [2]);
+    std::swap(in[1],in[2]);
+    area = -area;
+  }
+
+  // edge k is opposite to vertex k, it is area at vertex k and 0 at the other vertices
+  glm::dvec3 edges    [3];
+  double     threshold[3];
+  for(uint32_t k=0;k<3;++k){
+    auto const&a = v[(k+1)%3];
+    auto const&b = v[(k+2)%3];
+    edges    [k] = glm::dvec3(a.y-b.y,b.x-a.x,a.x*b.y-a.y*b.x);
+    threshold[k] = in[k] ? 0. : .5*(std::abs(edges[k].x)+std::abs(edges[k].y));
+  }
+  // the farthest depth inside of pixel is at one of its corners
+  auto const plane     = depthPlane(v);
+  auto const maxOffset = .5*(std::abs(plane.x)+std::abs(plane.y))+creaseOffset;
+
+  auto const pixels = toPixels(glm::dvec4(
+        std::min({v[0].x,v[1].x,v[2].x}),
+        std::min({v[0].y,v[1].y,v[2].y}),
+        std::max({v[0].x,v[1].x,v[2].x}),
+        std::max({v[0].y,v[1].y,v[2].y})));
+  for(int32_t y=pixels.y;y<pixels.w;++y){
+    auto*row = depth.data()+(size_t)y*occlusionBufferWidth;
+    for(int32_t x=pixels.x;x<pixels.z;++x){
+      glm::dvec3 const p(x+.5,y+.5,1.);
+      if(glm::dot(edges[0],p) < threshold[0] || glm::dot(edges[1],p) < threshold[1] || glm::dot(edges[2],p) < threshold[2])continue;
+      row[x] = std::min(row[x],(float)(glm::dot(plane,p)+maxOffset));
+    }
+  }
+}
+
+}
+
+/**
+ * @brief Constructor, it reads triangles of meshes that can occlude and finds their neighbours.
+ * Occluder mesh is opaque (opaque texture and diffuse color), it has positions and at most maxTriangles triangles.
+ *
+ * @param model model
+ */
+OcclusionCulling::OcclusionCulling(Model const&model){
+  std::vector<bool>opaqueTextures;
+  for(auto const&texture:model.textures)
+    opaqueTextures.push_back(isTextureOpaque(texture));
+
+  for(auto const&mesh:model.meshes){
+    triangles  .emplace_back();
+    neighbours .emplace_back();
+    doubleSided.push_back(mesh.doubleSided);
+    bool const opaqueTexture = mesh.diffuseTexture < 0 || mesh.diffuseTexture >= (int)opaqueTextures.size() || opaqueTextures[mesh.diffuseTexture];
+    bool const opaque        = opaqueTexture && (mesh.diffuseTexture >= 0 || mesh.diffuseColor.a >= 1.f);
+    bool const readable      = mesh.position.type != AttributeType::EMPTY && mesh.position.bufferID >= 0 && mesh.position.bufferID < (int32_t)model.buffers.size();
+    if(!opaque || !readable || mesh.nofIndices/3 > maxTriangles)continue;
+
+    auto const indices   = readIndices(model,mesh);
+    auto const positions = readPositions(model,mesh,countVertices(indices));
+    auto&tris = triangles.back();
+    for(auto i:indices)tris.push_back(positions[i]);
+
+    // vertices are welded by position, neighbour goes through the shared edge in opposite direction
+    std::unordered_map<std::string_view,uint32_t>unique;
+    std::vector<uint32_t>welded(tris.size());
+    for(uint32_t v=0;v<tris.size();++v)
+      welded[v] = unique.emplace(std::string_view((char const*)&tris[v],sizeof(glm::vec3)),v).first->second;
+    auto const edge = [&](uint32_t t,uint32_t k,bool reversed){
+      auto const a = welded[t*3+(k+1)%3];
+      auto const b = welded[t*3+(k+2)%3];
+      return reversed ? (uint64_t)b<<32|a : (uint64_t)a<<32|b;
+    };
+    std::unordered_map<uint64_t,uint32_t>edges;
+    for(uint32_t t=0;t<tris.size()/3;++t)
+      for(uint32_t k=0;k<3;++k)
+        edges.emplace(edge(t,k,false),t);
+    auto&adjacent = neighbours.back();
+    for(uint32_t t=0;t<tris.size()/3;++t)
+      for(uint32_t k=0;k<3;++k){
+        auto const it = edges.find(edge(t,k,true));
+        adjacent.push_back(it != edges.end() && it->second != t ? (int32_t)it->second : -1);
+      }
+  }
+}
+
+/**
+ * @brief This function renders occluders into the depth buffer.
+ * Occluders are instances with draw command that are not culled,
+ * the largest ones on the screen are rendered first until the triangle budget is exhausted.
+ *
+ * @param commandBuffer command buffer created by prepareModel, culled instances have no vertices
+ * @param instances mesh instances created by prepareModel
+ * @param viewProjection view projection matrix
+ */
+void OcclusionCulling::render(CommandBuffer const&commandBuffer,std::vector<MeshInstance>const&instances,glm::mat4 const&viewProjection){
+  this->viewProjection = viewProjection;
+  depth.assign((size_t)occlusionBufferWidth*occlusionBufferHeight,INFINITY);
+
+  std::vector<std::pair<double,MeshInstance const*>>occluders;
+  for(auto const&instance:instances){
+    if(!instance.bounded || triangles.at(instance.mesh).empty())continue;
+    if(commandBuffer.commands[instance.drawCommand].data.drawCommand.nofVertices == 0)continue;
+    glm::dvec4 rect;
+    float      minDepth;
+    // instance that crosses the near plane covers large part of the screen
+    double area = INFINITY;
+    if(projectBox(rect,minDepth,viewProjection,instance.boundsMin,instance.boundsMax)){
+      auto const pixels = toPixels(rect);
+      area = (double)std::max(pixels.z-pixels.x,0)*std::max(pixels.w-pixels.y,0);
+    }
+    if(area >= minArea)occluders.emplace_back(area,&instance);
+  }
+  std::stable_sort(occluders.begin(),occluders.end(),[](auto const&a,auto const&b){return a.first > b.first;});
+
+  nofOccluders = 0;
+  size_t nofTriangles = 0;
+  std::vector<glm::dvec3>projected  ;
+  std::vector<glm::dvec3>planes     ;
+  std::vector<int8_t    >orientation;
+  for(auto const&occluder:occluders){
+    auto const&instance = *occluder.second;
+    auto const&tris     = triangles[instance.mesh];
+    if(nofTriangles+tris.size()/3 > maxTriangles)continue;
+    nofTriangles += tris.size()/3;
+    ++nofOccluders;
+
+    // triangles that cross the near plane are skipped, they would need clipping
+    auto const mvp = viewProjection*instance.modelMatrix;
+    projected  .resize(tris.size());
+    planes     .resize(tris.size()/3);
+    orientation.assign(tris.size()/3,0);
+    for(size_t t=0;t<tris.size()/3;++t){
+      bool clipped = false;
+      for(uint32_t k=0;k<3;++k){
+        auto const clip = mvp*glm::vec4(tris[t*3+k],1.f);
+        clipped |= clip.w <= 0.f || clip.z < -clip.w;
+        projected[t*3+k] = toBuffer(clip);
+      }
+      if(clipped)continue;
+      auto const area = doubleArea(&projected[t*3]);
+      orientation[t] = (area > 0.)-(area < 0. && doubleSided[instance.mesh]);
+      if(orientation[t] != 0)planes[t] = depthPlane(&projected[t*3]);
+    }
+
+    auto const&adjacent = neighbours[instance.mesh];
+    for(size_t t=0;t<tris.size()/3;++t){
+      if(orientation[t] == 0)continue;
+      bool   interior[3];
+      double creaseOffset = 0.;
+      for(uint32_t k=0;k<3;++k){
+        auto const n = adjacent[t*3+k];
+        interior[k] = n >= 0 && orientation[n] == orientation[t];
+        // both planes are equal on the shared edge and the pixel reaches at most 1 pixel behind it
+        if(interior[k])creaseOffset += std::abs(planes[n].x-planes[t].x)+std::abs(planes[n].y-planes[t].y);
+      }
+      rasterizeTriangle(depth,&projected[t*3],interior,creaseOffset);
+    }
+  }
+
+  uint32_t const blocksX = occlusionBufferWidth /occlusionBlockSize;
+  uint32_t const blocksY = occlusionBufferHeight/occlusionBlockSize;
+  blockDepth.assign(blocksX*blocksY,-INFINITY);
+  for(uint32_t y=0;y<occlusionBufferHeight;++y)
+    for(uint32_t x=0;x<occlusionBufferWidth;++x){
+      auto&b = blockDepth[(y/occlusionBlockSize)*blocksX+x/occlusionBlockSize];
+      b = std::max(b,depth[y*occlusionBufferWidth+x]);
+    }
+}
+
+/**
+ * @brief This function returns true if bounding box is hidden behind occluders of the depth buffer.
+ * Box is tested by its closest depth against every pixel of its screen space rectangle.
+ *
+ * @param boundsMin world space bounding box
+ * @param boundsMax world space bounding box
+ *
+ * @return true if every pixel of the box rectangle is closer than the box
+ */
+bool OcclusionCulling::isOccluded(glm::vec3 const&boundsMin,glm::vec3 const&boundsMax)const{
+  glm::dvec4 rect;
+  float      minDepth;
+  if(depth.empty() || !projectBox(rect,minDepth,viewProjection,boundsMin,boundsMax))return false;
+  auto const pixels = toPixels(rect);
+  // box outside of the screen is left to frustum culling
+  if(pixels.x >= pixels.z || pixels.y >= pixels.w)return false;
+  minDepth -= depthBias;
+
+  uint32_t const blocksX = occlusionBufferWidth/occlusionBlockSize;
+  for(int32_t by=pixels.y/occlusionBlockSize;by*(int32_t)occlusionBlockSize<pixels.w;++by)
+    for(int32_t bx=pixels.x/occlusionBlockSize;bx*(int32_t)occlusionBlockSize<pixels.z;++bx){
+      if(blockDepth[by*blocksX+bx] < minDepth)continue;
+      for(int32_t y=std::max<int32_t>(pixels.y,by*occlusionBlockSize);y<std::min<int32_t>(pixels.w,(by+1)*occlusionBlockSize);++y)
+        for(int32_t x=std::max<int32_t>(pixels.x,bx*occlusionBlockSize);x<std::min<int32_t>(pixels.z,(bx+1)*occlusionBlockSize);++x)
+          if(!(depth[y*occlusionBufferWidth+x] < minDepth))return false;
+    }
+  return true;
+}
+
+/**
+ * @brief This function disables draw commands of instances hidden behind occluders.
+ * It should be called after cullModel, so only instances inside of the view frustum are occluders.
+ * With previousFrame the instances are tested against the depth buffer and the matrix of the previous frame
+ * and the buffer of this frame is rendered afterwards for the next frame.
+ * It does not wait for occluders of the current frame, but it is not conservative if the camera or the occluders move.
+ *
+ * @param commandBuffer command buffer created by prepareModel
+ * @param instances mesh instances created by prepareModel
+ * @param viewProjection view projection matrix
+ * @param previousFrame use depth buffer of the previous frame
+ *
+ * @return number of occluded instances
+ */
+uint32_t OcclusionCulling::cull(CommandBuffer&commandBuffer,std::vector<MeshInstance>const&instances,glm::mat4 const&viewProjection,bool previousFrame){
+  if(!previousFrame)render(commandBuffer,instances,viewProjection);
+
+  uint32_t occluded = 0;
+  for(auto const&instance:instances){
+    auto&cmd = commandBuffer.commands[instance.drawCommand].data.drawCommand;
+    if(cmd.nofVertices == 0 || !instance.bounded)continue;
+    if(!isOccluded(instance.boundsMin,instance.boundsMax))continue;
+    cmd.nofVertices = 0;
+    ++occluded;
+  }
+
+  if(previousFrame)render(commandBuffer,instances,viewProjection);
+  return occluded;
+}
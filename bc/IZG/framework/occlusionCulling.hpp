@@ -0,0 +1,42 @@
+/*!
+ * @file
+ * @brief This file contains software occlusion culling of model instances.
+ *
+ * @author Tomáš Milet, imilet@fit.vutbr.cz
+ */
+
+#pragma once
+
+#include<vector>
+#include<cstdint>
+#include<student/fwd.hpp>
+#include<student/drawModel.hpp>
+
+uint32_t const occlusionBufferWidth  = 256;///< width of low resolution occluder depth buffer
+uint32_t const occlusionBufferHeight = 128;///< height of low resolution occluder depth buffer
+uint32_t const occlusionBlockSize    = 8  ;///< size of block of pixels with stored maximal depth
+
+/**
+ * @brief This class culls model instances that are hidden behind large occluders.
+ * Large opaque instances are rasterized into low resolution depth buffer by depth only rasterizer,
+ * pixels are written with the farthest depth of the pixel and only if they do not cross outer edges of the mesh,
+ * so the buffer is (up to rounding) conservative.
+ * Screen space bounding box of every instance is then tested against the buffer.
+ */
+class OcclusionCulling{
+  public:
+    OcclusionCulling(){}
+    OcclusionCulling(Model const&model);
+    void     render    (CommandBuffer const&commandBuffer,std::vector<MeshInstance>const&instances,glm::mat4 const&viewProjection);
+    bool     isOccluded(glm::vec3 const&boundsMin,glm::vec3 const&boundsMax)const;
+    uint32_t cull      (CommandBuffer&commandBuffer,std::vector<MeshInstance>const&instances,glm::mat4 const&viewProjection,bool previousFrame = false);
+    std::vector<std::vector<glm::vec3>>triangles     ;///< object space triangles of occluder meshes, empty for meshes that cannot occlude
+    std::vector<std::vector<int32_t  >>neighbours    ;///< triangle behind every edge of occluder triangles, -1 for outer edges
+    std::vector<bool                  >doubleSided   ;///< back faces of mesh occlude too
+    std::vector<float                 >depth         ;///< depth buffer of occluders, INFINITY where nothing is rasterized
+    std::vector<float                 >blockDepth    ;///< maximal depth of every block of occlusionBlockSize^2 pixels
+    glm::mat4                          viewProjection = glm::mat4(1.f);///< matrix used to render the depth buffer
+    uint32_t                           nofOccluders   = 0;///< number of occluders rendered into the depth buffer
+    uint32_t                           maxTriangles   = 32768;///< budget of occluder triangles per frame
+    float                              minArea        = 256.f;///< minimal screen space area of occluder in pixels of the buffer
+};
@@ -2,6 +2,7 @@
 
 #include<libs/stb_image/stb_image.h>
 
+#include <algorithm>
 #include <iostream>
 
 TextureData loadTexture(std::string const&fileName){
@@ -28,3 +29,82 @@ TextureData loadTexture(std::string const&fileName){
   stbi_image_free(data);
   return res;
 }
+
+/**
+ * @brief This function computes sizes and offsets of all mip levels.
+ *
+ * @param width width of level 0
+ * @param height height of level 0
+ *
+ * @return size of all levels in bytes
+ */
+size_t TextureMipmaps::createLevels(uint32_t width,uint32_t height){
+  levels .clear();
+  offsets.clear();
+  if(!width || !height)return 0;
+
+  // every level is padded to whole tiles
+  auto const padded = [](uint32_t s){return (size_t)(s+textureTileSize-1)/textureTileSize*textureTileSize;};
+  size_t size = 0;
+  uint32_t w = width;
+  uint32_t h = height;
+  for(;;){
+    levels .push_back({nullptr,w,h});
+    offsets.push_back(size);
+    size += padded(w)*padded(h)*4;
+    if(w == 1 && h == 1)break;
+    w = std::max(w/2,1u);
+    h = std::max(h/2,1u);
+  }
+  return size;
+}
+
+TextureMipmaps::TextureMipmaps(uint32_t width,uint32_t height,uint8_t const*t):texels(t){
+  createLevels(width,height);
+}
+
+TextureMipmaps::TextureMipmaps(Texture const&texture){
+  if(!texture.data || !texture.width || !texture.height)return;
+
+  data.resize(createLevels(texture.width,texture.height),0);
+
+  // level 0 is converted to RGBA8, missing channels are 0 and missing alpha is 255
+  auto const channels = std::min(texture.channels,4u);
+  for(uint32_t y=0;y<texture.height;++y)
+    for(uint32_t x=0;x<texture.width;++x){
+      auto*t = data.data()+offsets[0]+getTexelIndex(levels[0],x,y)*4;
+      t[3] = 255;
+      for(uint32_t c=0;c<channels;++c)
+        t[c] = texture.data[((size_t)y*texture.width+x)*texture.channels+c];
+    }
+
+  // next levels average 2x2 texels of previous level, odd edge texels are repeated
+  for(size_t l=1;l<levels.size();++l){
+    auto const&src = levels[l-1];
+    auto const&dst = levels[l  ];
+    auto const*s   = data.data()+offsets[l-1];
+    auto      *d   = data.data()+offsets[l  ];
+    for(uint32_t y=0;y<dst.height;++y)
+      for(uint32_t x=0;x<dst.width;++x){
+        uint32_t const x0 = std::min(2*x  ,src.width -1);
+        uint32_t const x1 = std::min(2*x+1,src.width -1);
+        uint32_t const y0 = std::min(2*y  ,src.height-1);
+        uint32_t const y1 = std::min(2*y+1,src.height-1);
+        auto*t = d+getTexelIndex(dst,x,y)*4;
+        for(uint32_t c=0;c<4;++c)
+          t[c] = (uint8_t)((
+            s[getTexelIndex(src,x0,y0)*4+c]+
+            s[getTexelIndex(src,x1,y0)*4+c]+
+            s[getTexelIndex(src,x0,y1)*4+c]+
+            s[getTexelIndex(src,x1,y1)*4+c]+2)/4);
+      }
+  }
+}
+
+void TextureMipmaps::attach(Texture&texture){
+  auto const*base = texels ? texels : data.data();
+  for(size_t l=0;l<levels.size();++l)
+    levels[l].data = base+offsets[l];
+  texture.levels    = levels.empty() ? nullptr : levels.data();
+  texture.nofLevels = (uint32_t)levels.size();
+}
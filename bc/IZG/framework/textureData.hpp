@@ -5,6 +5,24 @@
 #include<string>
 #include<student/fwd.hpp>
 
+/**
+ * @brief This class holds mip pyramid of a texture prepared for sampling.
+ * Every level is converted to RGBA8 and stored in tiles (see getTexelIndex),
+ * so filtering reads few cache lines and minification reads small levels.
+ */
+class TextureMipmaps{
+  public:
+    TextureMipmaps(){}
+    TextureMipmaps(Texture const&texture);
+    TextureMipmaps(uint32_t width,uint32_t height,uint8_t const*texels);
+    void attach(Texture&texture);
+    size_t createLevels(uint32_t width,uint32_t height);
+    std::vector<uint8_t     >data   ;///< texels of all levels
+    std::vector<size_t      >offsets;///< offset of every level in data
+    std::vector<TextureLevel>levels ;///< levels, attach points them into data
+    uint8_t const*texels = nullptr;///< texels of all levels stored outside (mapped file), used instead of data
+};
+
 class TextureData{
   public:
     std::vector<uint8_t>data;
@@ -21,8 +39,17 @@ class TextureData{
       res.width = width;
       res.height = height;
       res.channels = channels;
+      mipmaps.attach(res);
       return res;
     }
+    /**
+     * @brief This function creates mip pyramid of the texture.
+     * Textures obtained by getTexture afterwards can be sampled by read_textureLod and read_textureGrad.
+     */
+    void prepare(){
+      mipmaps = TextureMipmaps(getTexture());
+    }
+    TextureMipmaps mipmaps;
 };
 
 TextureData loadTexture(std::string const&fileName);
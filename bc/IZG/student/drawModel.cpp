@@ -7,8 +7,110 @@
 #include <student/drawModel.hpp>
 #include <student/gpu.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
 ///\endcond
 
+uint32_t const drawCallUniformOffset = 10;///< uniforms of draw calls start after scene uniforms
+uint32_t const drawCallNofUniforms   = 5 ;///< model matrix, inverse model matrix, diffuse color, texture id, double sided
+
+/**
+ * @brief This function computes object space bounding box of mesh from its positions.
+ *
+ * @param mn minimal corner
+ * @param mx maximal corner
+ * @param model model
+ * @param mesh mesh
+ *
+ * @return true if mesh has readable positions
+ */
+bool computeMeshBounds(glm::vec3&mn,glm::vec3&mx,Model const&model,Mesh const&mesh){
+  auto const&pos = mesh.position;
+  auto const nofComponents = std::min((uint32_t)pos.type,3u);
+  if(pos.type == AttributeType::EMPTY || (uint32_t)pos.type > 4)return false;
+  if(pos.bufferID < 0 || pos.bufferID >= (int32_t)model.buffers.size())return false;
+  auto const*positions = (uint8_t const*)model.buffers[pos.bufferID].data;
+  if(!positions)return false;
+
+  auto const indexed = mesh.indexBufferID >= 0 && mesh.indexBufferID < (int32_t)model.buffers.size();
+  auto const*indices = indexed ? (uint8_t const*)model.buffers[mesh.indexBufferID].data+mesh.indexOffset : nullptr;
+
+  mn = glm::vec3(+std::numeric_limits<float>::max());
+  mx = glm::vec3(-std::numeric_limits<float>::max());
+  for(uint32_t i=0;i<mesh.nofIndices;++i){
+    uint32_t v = i;
+    if(indexed){
+      if(mesh.indexType == IndexType::UINT8 )v = indices[i];
+      if(mesh.indexType == IndexType::UINT16){uint16_t x;std::memcpy(&x,indices+i*2,2);v = x;}
+      if(mesh.indexType == IndexType::UINT32)std::memcpy(&v,indices+i*4,4);
+    }
+    glm::vec3 p(0.f);
+    std::memcpy(&p,positions+pos.offset+pos.stride*v,nofComponents*sizeof(float));
+    mn = glm::min(mn,p);
+    mx = glm::max(mx,p);
+  }
+  return mesh.nofIndices > 0;
+}
+
+/**
+ * @brief This function flattens node trees of model into array of mesh instances.
+ * Instances are in pre order, the same order as draw commands of prepareModel.
+ *
+ * @param model model
+ *
+ * @return mesh instances with world matrices and world space bounding boxes
+ */
+std::vector<MeshInstance>flattenModel(Model const&model){
+  struct MeshBounds{
+    glm::vec3 center ;
+    glm::vec3 extent ;
+    bool      bounded;
+  };
+  std::vector<MeshBounds>bounds;
+  for(auto const&mesh:model.meshes){
+    glm::vec3 mn,mx;
+    auto const bounded = computeMeshBounds(mn,mx,model,mesh);
+    bounds.push_back({(mn+mx)*.5f,(mx-mn)*.5f,bounded});
+  }
+
+  // explicit stack, children are pushed in reverse order to keep pre order
+  std::vector<std::pair<Node const*,glm::mat4>>stack;
+  for(auto it=model.roots.rbegin();it!=model.roots.rend();++it)
+    stack.emplace_back(&*it,glm::mat4(1.f));
+
+  std::vector<MeshInstance>res;
+  while(!stack.empty()){
+    auto const node   = stack.back().first;
+    auto const matrix = stack.back().second*node->modelMatrix;
+    stack.pop_back();
+
+    if(node->mesh >= 0 && node->mesh < (int32_t)model.meshes.size()){
+      MeshInstance instance;
+      instance.modelMatrix = matrix;
+      instance.mesh        = node->mesh;
+      auto const&b = bounds[node->mesh];
+      instance.bounded = b.bounded;
+      if(b.bounded){
+        // transformed box is bounded by transformed center and absolute matrix times extent
+        auto const center = glm::vec3(matrix*glm::vec4(b.center,1.f));
+        glm::vec3 extent(0.f);
+        for(int c=0;c<3;++c)
+          extent += glm::abs(glm::vec3(matrix[c]))*b.extent[c];
+        instance.boundsMin = center-extent;
+        instance.boundsMax = center+extent;
+      }
+      res.push_back(instance);
+    }
+
+    for(auto it=node->children.rbegin();it!=node->children.rend();++it)
+      stack.emplace_back(&*it,matrix);
+  }
+  return res;
+}
+
 /**
  * @brief This function prepares model into memory and creates command buffer
  *
@@ -18,16 +120,150 @@
  */
 //! [drawModel]
 void prepareModel(GPUMemory&mem,CommandBuffer&commandBuffer,Model const&model){
-  (void)mem;
-  (void)commandBuffer;
-  (void)model;
-  /// \todo Tato funkce připraví command buffer pro model a nastaví správně pamět grafické karty.<br>
-  /// Vaším úkolem je správně projít model a vložit vykreslovací příkazy do commandBufferu.
-  /// Zároveň musíte vložit do paměti textury, buffery a uniformní proměnné, které buffer command buffer využívat.
-  /// Bližší informace jsou uvedeny na hlavní stránce dokumentace a v testech.
+  std::vector<MeshInstance>instances;
+  prepareModel(mem,commandBuffer,model,instances);
 }
 //! [drawModel]
 
+/**
+ * @brief This function prepares model into memory and creates command buffer from flattened model.
+ * Every mesh instance gets one draw command and uniforms at drawCallUniformOffset+drawID*drawCallNofUniforms.
+ *
+ * @param mem gpu memory
+ * @param commandBuffer command buffer
+ * @param model model structure
+ * @param instances output mesh instances, they can be culled by cullModel
+ */
+void prepareModel(GPUMemory&mem,CommandBuffer&commandBuffer,Model const&model,std::vector<MeshInstance>&instances){
+  for(size_t i=0;i<model.buffers.size() && i<GPUMemory::maxBuffers;++i)
+    mem.buffers[i] = model.buffers[i];
+
+  for(size_t i=0;i<model.textures.size() && i<GPUMemory::maxTextures;++i)
+    mem.textures[i] = model.textures[i];
+
+  auto&prg = mem.programs[0];
+  prg.vertexShader   = drawModel_vertexShader;
+  prg.fragmentShader = drawModel_fragmentShader;
+  prg.vs2fs[0] = AttributeType::VEC3;
+  prg.vs2fs[1] = AttributeType::VEC3;
+  prg.vs2fs[2] = AttributeType::VEC2;
+  prg.vs2fs[3] = AttributeType::UINT;
+
+  commandBuffer.nofCommands = 0;
+  pushClearCommand(commandBuffer,glm::vec4(0.1,0.15,0.1,1.),10e10f);
+
+  instances = flattenModel(model);
+  uint32_t drawID = 0;
+  for(auto&instance:instances){
+    auto const uniforms = drawCallUniformOffset+drawID*drawCallNofUniforms;
+    if(commandBuffer.nofCommands >= CommandBuffer::maxCommands || uniforms+drawCallNofUniforms > GPUMemory::maxUniforms){
+      std::cerr << "prepareModel: model has too many mesh instances" << std::endl;
+      instances.resize(drawID);
+      break;
+    }
+
+    auto const&mesh = model.meshes[instance.mesh];
+    VertexArray vao;
+    vao.indexBufferID   = mesh.indexBufferID;
+    vao.indexOffset     = mesh.indexOffset  ;
+    vao.indexType       = mesh.indexType    ;
+    vao.vertexAttrib[0] = mesh.position     ;
+    vao.vertexAttrib[1] = mesh.normal       ;
+    vao.vertexAttrib[2] = mesh.texCoord     ;
+
+    instance.drawCommand = commandBuffer.nofCommands;
+    pushDrawCommand(commandBuffer,mesh.nofIndices,0,vao,!mesh.doubleSided);
+
+    mem.uniforms[uniforms+0].m4 = instance.modelMatrix;
+    mem.uniforms[uniforms+1].m4 = glm::transpose(glm::inverse(instance.modelMatrix));
+    mem.uniforms[uniforms+2].v4 = mesh.diffuseColor;
+    mem.uniforms[uniforms+3].i1 = mesh.diffuseTexture;
+    mem.uniforms[uniforms+4].v1 = (float)mesh.doubleSided;
+    ++drawID;
+  }
+}
+
+/**
+ * @brief This function disables draw commands of mesh instances that are outside of view frustum.
+ * Culled draw commands draw 0 vertices, so gl_DrawID of other draw commands does not change.
+ *
+ * @param commandBuffer command buffer created by prepareModel
+ * @param model model structure
+ * @param instances mesh instances created by prepareModel
+ * @param viewProjection projection matrix times view matrix
+ *
+ * @return number of culled instances
+ */
+uint32_t cullModel(CommandBuffer&commandBuffer,Model const&model,std::vector<MeshInstance>const&instances,glm::mat4 const&viewProjection){
+  // planes of clip space -w <= x,y,z <= w in world space
+  auto const m = glm::transpose(viewProjection);
+  glm::vec4 const planes[] = {m[3]+m[0],m[3]-m[0],m[3]+m[1],m[3]-m[1],m[3]+m[2],m[3]-m[2]};
+
+  uint32_t culled = 0;
+  for(auto const&instance:instances){
+    bool visible = true;
+    if(instance.bounded){
+      auto const center = (instance.boundsMin+instance.boundsMax)*.5f;
+      auto const extent = (instance.boundsMax-instance.boundsMin)*.5f;
+      for(auto const&p:planes){
+        auto const n = glm::vec3(p);
+        if(glm::dot(n,center)+p.w+glm::dot(glm::abs(n),extent) < 0.f){
+          visible = false;
+          break;
+        }
+      }
+    }
+    commandBuffer.commands[instance.drawCommand].data.drawCommand.nofVertices = visible ? model.meshes[instance.mesh].nofIndices : 0;
+    culled += !visible;
+  }
+  return culled;
+}
+
+/**
+ * @brief This function returns true if every texel of texture is opaque.
+ *
+ * @param texture texture
+ *
+ * @return true if texture has no alpha channel or all its alpha values are 255
+ */
+bool isTextureOpaque(Texture const&texture){
+  if(texture.channels < 4 || !texture.data)return true;
+  auto const nofTexels = (size_t)texture.width*texture.height;
+  for(size_t i=0;i<nofTexels;++i)
+    if(texture.data[i*texture.channels+3] != 255)return false;
+  return true;
+}
+
+/**
+ * @brief This function enables or disables depth prepass of command buffer created by prepareModel.
+ * Draw commands of opaque meshes (opaque diffuse color and texture) are switched to BlendMode::NONE,
+ * so the gpu rasterizes them into depth first and shades every visible pixel only once.
+ * Other meshes keep BlendMode::FRAGMENT_ALPHA and they are shaded as before.
+ *
+ * @param commandBuffer command buffer created by prepareModel
+ * @param model model structure
+ * @param instances mesh instances created by prepareModel
+ * @param enable true enables depth prepass, false restores blending of all draw commands
+ *
+ * @return number of opaque instances
+ */
+uint32_t setDepthPrepass(CommandBuffer&commandBuffer,Model const&model,std::vector<MeshInstance>const&instances,bool enable){
+  std::vector<bool>opaqueTextures;
+  for(auto const&texture:model.textures)
+    opaqueTextures.push_back(isTextureOpaque(texture));
+
+  commandBuffer.depthPrepass = enable;
+  uint32_t opaque = 0;
+  for(auto const&instance:instances){
+    auto const&mesh = model.meshes[instance.mesh];
+    bool const opaqueTexture = mesh.diffuseTexture < 0 || mesh.diffuseTexture >= (int)opaqueTextures.size() || opaqueTextures[mesh.diffuseTexture];
+    bool const isOpaque = enable && opaqueTexture && (mesh.diffuseTexture >= 0 || mesh.diffuseColor.a >= 1.f);
+    commandBuffer.commands[instance.drawCommand].data.drawCommand.blendMode = isOpaque ? BlendMode::NONE : BlendMode::FRAGMENT_ALPHA;
+    opaque += isOpaque;
+  }
+  return opaque;
+}
+
 /**
  * @brief This function represents vertex shader of texture rendering method.
  *
@@ -6,12 +6,36 @@
  */
 #pragma once
 
+#include <vector>
+
 #include <student/fwd.hpp>
 
+/**
+ * @brief This structure represents one mesh instance of flattened model.
+ */
+struct MeshInstance{
+  glm::mat4 modelMatrix = glm::mat4(1.f);///< world matrix of the node
+  glm::vec3 boundsMin   = glm::vec3(0.f);///< world space bounding box of the mesh
+  glm::vec3 boundsMax   = glm::vec3(0.f);///< world space bounding box of the mesh
+  bool      bounded     = false         ;///< mesh has readable positions, otherwise it is never culled
+  int32_t   mesh        = -1            ;///< mesh id
+  uint32_t  drawCommand = 0             ;///< index of draw command created by prepareModel
+};
+
 //void drawModel(Frame&frame,Model const&model,glm::mat4 const&proj,glm::mat4 const&view,glm::vec3 const&light,glm::vec3 const&camera);
 
+std::vector<MeshInstance>flattenModel(Model const&model);
+
 void prepareModel(GPUMemory&mem,CommandBuffer&commandBuffer,Model const&model);
 
+void prepareModel(GPUMemory&mem,CommandBuffer&commandBuffer,Model const&model,std::vector<MeshInstance>&instances);
+
+uint32_t cullModel(CommandBuffer&commandBuffer,Model const&model,std::vector<MeshInstance>const&instances,glm::mat4 const&viewProjection);
+
+bool isTextureOpaque(Texture const&texture);
+
+uint32_t setDepthPrepass(CommandBuffer&commandBuffer,Model const&model,std::vector<MeshInstance>const&instances,bool enable);
+
 void drawModel_vertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface const&si);
 
 void drawModel_fragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&si);
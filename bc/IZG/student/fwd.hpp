@@ -15,6 +15,20 @@
 
 uint32_t const maxAttributes = 4;///< maximum number of vertex/fragment attributes
 
+uint32_t const textureTileSize = 4;///< size of tiles of prepared texture levels in texels (one tile of RGBA8 texels is 64 bytes)
+
+/**
+ * @brief This struct represents one mip level of a prepared texture.
+ * Texels are RGBA8 and they are addressed by getTexelIndex.
+ */
+//! [TextureLevel]
+struct TextureLevel{
+  uint8_t const* data   = nullptr;///< pointer to texels
+  uint32_t       width  = 0      ;///< width of the level
+  uint32_t       height = 0      ;///< height of the level
+};
+//! [TextureLevel]
+
 /**
  * @brief This struct represent a texture
  */
@@ -24,9 +38,28 @@ struct Texture{
   uint32_t       width    = 0      ;///< width of the texture
   uint32_t       height   = 0      ;///< height of the texture
   uint32_t       channels = 3      ;///< number of channels of the texture
+  TextureLevel const*levels    = nullptr;///< mip pyramid created by texture preparation or nullptr
+  uint32_t           nofLevels = 0      ;///< number of mip levels, level 0 has the size of the texture
 };
 //! [Texture]
 
+/**
+ * @brief This function returns index of texel in prepared texture level.
+ * Level stores tiles of textureTileSize x textureTileSize texels row by row
+ * and texels inside a tile row by row, its size is padded to whole tiles.
+ *
+ * @param level texture level
+ * @param x x coordinate of texel
+ * @param y y coordinate of texel
+ *
+ * @return index of texel, its RGBA8 color starts at index*4
+ */
+inline size_t getTexelIndex(TextureLevel const&level,uint32_t x,uint32_t y){
+  size_t const tilesX = (level.width+textureTileSize-1)/textureTileSize;
+  size_t const tile   = (y/textureTileSize)*tilesX+x/textureTileSize;
+  return tile*textureTileSize*textureTileSize+(y%textureTileSize)*textureTileSize+x%textureTileSize;
+}
+
 /**
  * @brief This enum represents vertex/fragment attribute type.
  */
@@ -89,6 +122,8 @@ struct OutVertex{
 struct InFragment{
   Attribute attributes[maxAttributes]               ; ///< fragment attributes
   glm::vec4 gl_FragCoord              = glm::vec4(1); ///< fragment coordinates
+  glm::vec4 dFdx[maxAttributes]                     ; ///< screen space derivatives of float attributes along x, only if Program::derivatives is set
+  glm::vec4 dFdy[maxAttributes]                     ; ///< screen space derivatives of float attributes along y, only if Program::derivatives is set
 };
 //! [InFragment]
 
@@ -97,7 +132,9 @@ struct InFragment{
  */
 //! [OutFragment]
 struct OutFragment{
-  glm::vec4 gl_FragColor = glm::vec4(0.f); ///< fragment color
+  glm::vec4 gl_FragColor    = glm::vec4(0.f); ///< fragment color
+  glm::vec3 gl_FragNormal   = glm::vec3(0.f); ///< normal written into g-buffer (only programs with Program::gbufferOutput)
+  glm::vec3 gl_FragPosition = glm::vec3(0.f); ///< position written into g-buffer (only programs with Program::gbufferOutput)
 };
 //! [OutFragment]
 
@@ -212,23 +249,67 @@ struct Program{
   VertexShader   vertexShader   = nullptr; ///< vertex shader
   FragmentShader fragmentShader = nullptr; ///< fragment shader
   AttributeType  vs2fs[maxAttributes] = {AttributeType::EMPTY}; ///< which attributes are interpolated from vertex shader to fragment shader
+  bool           derivatives    = false  ; ///< fragment shader receives derivatives of attributes computed in 2x2 pixel quads
+  bool           gbufferOutput  = false  ; ///< fragment shader writes gl_FragNormal and gl_FragPosition into g-buffer of frame, gl_FragColor is albedo
+  bool           sideEffects    = false  ; ///< shaders read or write other memory than their inputs and outputs (e.g. they record invocations), the draw then invokes them in one thread for every vertex and every covered fragment and the framebuffer is up to date before its vertex shader
 };
 //! [Program]
 
+uint32_t const frameTileSize = 8;///< size of tiles of tiled frame in pixels
+
 /**
  * @brief This structure represents a frame.
  * Frame (or framebuffer) is used as output of rendering.
+ * Frame with g-buffer (normal and position) is used by deferred shading,
+ * albedo of its pixels is stored in color buffer.
+ * Pixels are addressed by getPixelIndex.
  */
 //! [Frame]
 struct Frame{
-  uint8_t* color    = nullptr; ///< color buffer (1 byte per channel)
-  float  * depth    = nullptr; ///< depth buffer
-  uint32_t channels = 4      ; ///< number of color channels
-  uint32_t width    = 0      ; ///< width of frame
-  uint32_t height   = 0      ; ///< height of frame
+  uint8_t  * color    = nullptr; ///< color buffer (1 byte per channel)
+  float    * depth    = nullptr; ///< depth buffer
+  uint32_t   channels = 4      ; ///< number of color channels
+  uint32_t   width    = 0      ; ///< width of frame
+  uint32_t   height   = 0      ; ///< height of frame
+  bool       tiled    = false  ; ///< pixels are stored in contiguous tiles of frameTileSize x frameTileSize pixels (channels has to be 4)
+  uint32_t * normal   = nullptr; ///< g-buffer normals for deferred shading or nullptr (see encodeGBufferNormal), 0 marks pixel without geometry
+  glm::vec3* position = nullptr; ///< g-buffer positions for deferred shading, it is used together with normal
 };
 //! [Frame]
 
+/**
+ * @brief This function returns index of pixel in frame.
+ * Linear frame stores pixels row by row.
+ * Tiled frame stores tiles row by row and pixels inside a tile row by row,
+ * its buffers are padded to whole tiles.
+ *
+ * @param frame frame
+ * @param x x coordinate of pixel
+ * @param y y coordinate of pixel
+ *
+ * @return index into depth buffer, color of the pixel starts at index*channels
+ */
+inline size_t getPixelIndex(Frame const&frame,uint32_t x,uint32_t y){
+  if(!frame.tiled)return (size_t)y*frame.width+x;
+  size_t const tilesX = (frame.width+frameTileSize-1)/frameTileSize;
+  size_t const tile   = (y/frameTileSize)*tilesX+x/frameTileSize;
+  return tile*frameTileSize*frameTileSize+(y%frameTileSize)*frameTileSize+x%frameTileSize;
+}
+
+/**
+ * @brief This function returns number of pixels stored in buffers of frame.
+ *
+ * @param frame frame
+ *
+ * @return number of pixels including padding of tiled frame
+ */
+inline size_t getNofPixels(Frame const&frame){
+  if(!frame.tiled)return (size_t)frame.width*frame.height;
+  size_t const tilesX = (frame.width +frameTileSize-1)/frameTileSize;
+  size_t const tilesY = (frame.height+frameTileSize-1)/frameTileSize;
+  return tilesX*tilesY*frameTileSize*frameTileSize;
+}
+
 
 /**
  * @brief This structure represents a buffer on GPU
@@ -274,6 +355,17 @@ struct ClearCommand{
 };
 //! [ClearCommand]
 
+/**
+ * @brief This enum represents blending of fragment color with color in framebuffer.
+ */
+//! [BlendMode]
+enum class BlendMode{
+  FRAGMENT_ALPHA, ///< fragments with alpha != 1 are blended (SRC_ALPHA, ONE_MINUS_SRC_ALPHA), depth is written only by fragments with alpha > 0.5
+  NONE          , ///< fragment color is stored, alpha does not blend
+  ALPHA         , ///< all fragments are blended (SRC_ALPHA, ONE_MINUS_SRC_ALPHA) in 8-bit fixed point
+};
+//! [BlendMode]
+
 /**
  * @brief This structure represents draw command.
  * Draw command issues draw operation on the GPU.
@@ -284,17 +376,33 @@ struct DrawCommand{
   uint32_t    nofVertices     = 0    ; ///< number of vertices to draw
   bool        backfaceCulling = false; ///< is culling of backfacing triangles enabled?
   VertexArray vao                    ; ///< active vertex array (input/ triangles)
+  BlendMode   blendMode       = BlendMode::FRAGMENT_ALPHA; ///< blending of fragments with framebuffer
+  bool        depthTest       = true ; ///< are fragments that are not closer than depth in framebuffer discarded?
+  bool        depthWrite      = true ; ///< is depth of fragments written into framebuffer?
 };
 //! [DrawCommand]
 
+/**
+ * @brief This structure represents lighting command of deferred shading.
+ * Fragment shader of the program is executed once for every pixel of g-buffer that contains geometry.
+ * InFragment::attributes[0].v4 contains albedo, attributes[1].v3 normal and attributes[2].v3 position,
+ * gl_FragCoord.z contains depth. gl_FragColor is stored into color buffer.
+ */
+//! [LightingCommand]
+struct LightingCommand{
+  int32_t programID = -1; ///< program with lighting fragment shader
+};
+//! [LightingCommand]
+
 /**
  * @brief This enum represents type of command.
  */
 //! [CommandType]
 enum class CommandType{
-  EMPTY, ///< empty command
-  CLEAR, ///< clear command
-  DRAW , ///< draw command
+  EMPTY   , ///< empty command
+  CLEAR   , ///< clear command
+  DRAW    , ///< draw command
+  LIGHTING, ///< lighting command of deferred shading
 };
 //! [CommandType]
 
@@ -304,8 +412,9 @@ enum class CommandType{
 //! [CommandData]
 union CommandData{
   CommandData():drawCommand(){}///< constructor
-  ClearCommand clearCommand;   ///< clear command data
-  DrawCommand  drawCommand ;   ///< draw command data
+  ClearCommand    clearCommand   ;///< clear command data
+  DrawCommand     drawCommand    ;///< draw command data
+  LightingCommand lightingCommand;///< lighting command data
 };
 //! [CommandData]
 
@@ -329,6 +438,7 @@ struct CommandBuffer{
   uint32_t static const maxCommands           = 10000; ///< maximal number of commands
   uint32_t              nofCommands           = 0    ; ///< number of used commands in command buffer
   Command               commands[maxCommands]        ; ///< array of commands
+  bool                  depthPrepass          = false; ///< opaque draws (BlendMode::NONE with depth test and depth write) are first rasterized only into depth, then shaded with equal depth test
 };
 //! [CommandBuffer]
 
@@ -365,13 +475,19 @@ inline void pushClearCommand(
  * @param prg index of program that should be used for rendering
  * @param vao vertex array
  * @param backfaceCulling should the backface culling be enabled?
+ * @param blendMode blending of fragments with framebuffer
+ * @param depthTest should the depth test be enabled?
+ * @param depthWrite should the depth be written?
  */
 inline void pushDrawCommand(
     CommandBuffer      &cb                     ,
     uint32_t            nofVertices            , 
     int32_t             prg             = 0    ,
     VertexArray   const&vao             = {}   ,
-    bool                backfaceCulling = false){
+    bool                backfaceCulling = false,
+    BlendMode           blendMode       = BlendMode::FRAGMENT_ALPHA,
+    bool                depthTest       = true ,
+    bool                depthWrite      = true ){
   auto&cmd=cb.commands[cb.nofCommands];
   cmd.type = CommandType::DRAW;
   auto&c = cmd.data.drawCommand;
@@ -379,6 +495,24 @@ inline void pushDrawCommand(
   c.nofVertices     = nofVertices    ;
   c.programID       = prg            ;
   c.vao             = vao            ;
+  c.blendMode       = blendMode      ;
+  c.depthTest       = depthTest      ;
+  c.depthWrite      = depthWrite     ;
+  cb.nofCommands++;
+}
+
+/**
+ * @brief This function can be used to insert lighting command of deferred shading into command buffer.
+ *
+ * @param cb command buffer
+ * @param prg index of program with lighting fragment shader
+ */
+inline void pushLightingCommand(
+    CommandBuffer      &cb     ,
+    int32_t             prg = 0){
+  auto&cmd=cb.commands[cb.nofCommands];
+  cmd.type = CommandType::LIGHTING;
+  cmd.data.lightingCommand.programID = prg;
   cb.nofCommands++;
 }
 
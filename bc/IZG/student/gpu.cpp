@@ -6,37 +6,249 @@
  */
 
 #include <student/gpu.hpp>
+#include <student/threadPool.hpp>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Velikost dlazdice (tile) v pixelech
+uint32_t const tileSize = 8;
+
+// Pocet vrcholu, ktere jedno vlakno zpracuje vertex shaderem najednou
+uint32_t const vertexChunkSize = 256;
+
+// Indexy rozhazene vic nez timto krat za pocet vrcholu kresleni se neslucuji
+uint32_t const maxVertexIdSpread = 4;
+
+// Souradnice vrcholu se zaokrouhli na mrizku 1/256 pixelu (fixed point 16.8)
+int32_t const subPixelBits = 8;
+int64_t const subPixelScale = (int64_t)1 << subPixelBits;
+
+// Nejvetsi souradnice vrcholu v pixelech, pri ktere hranove funkce nepretecou int64
+float const maxRasterCoordinate = 4194304.0f;
+
+// Guard band v pixelech, trojuhelniky uvnitr se neorezavaji geometricky,
+// rezerva vuci maxRasterCoordinate pokryva zaokrouhleni pruseciku
+float const guardBandCoordinate = maxRasterCoordinate/2;
+
+// Bity clip kodu, vrchol lezi mimo danou polorovinu
+uint8_t const clipLeft = 1;
+uint8_t const clipRight = 2;
+uint8_t const clipBottom = 4;
+uint8_t const clipTop = 8;
+uint8_t const clipNear = 16;
+
+// Kazda orezavaci rovina prida mnohouhelniku nejvyse jeden vrchol
+uint32_t const maxClippedVertices = 3 + 5;
+
 typedef struct triangle {
     OutVertex vertices[3];
 } Triangle;
 
-typedef struct barycentricCoordinates {
-    float lambda0;
-    float lambda1;
-    float lambda2;
-} BarycentricCoordinates;
-
-void clear(GPUMemory& mem, ClearCommand& clearcmd)
+// Obdelnik pixelu vcetne obou krajnich hodnot
+typedef struct pixelRectangle {
+    uint32_t xmin;
+    uint32_t xmax;
+    uint32_t ymin;
+    uint32_t ymax;
+} PixelRectangle;
+
+// Hranova funkce E(x, y) = a*x + b*y + c v subpixelovych souradnicich,
+// vnitrek trojuhelniku je E >= 0
+typedef struct edgeFunction {
+    int64_t a;
+    int64_t b;
+    int64_t c;
+} EdgeFunction;
+
+// Linearni interpolace ve screen space: q(x, y) = q0 + dqdx*(x - x0) + dqdy*(y - y0)
+typedef struct interpolationPlane {
+    float q0;
+    float dqdx;
+    float dqdy;
+} InterpolationPlane;
+
+// Slozka atributu, ktera se interpoluje do fragmentu
+typedef struct componentTarget {
+    uint8_t attribute;
+    uint8_t component;
+} ComponentTarget;
+
+// Rozlozeni vs2fs prelozene jednou za kresleni: float slozky za sebou, celociselne atributy zvlast
+typedef struct interpolationLayout {
+    uint32_t nofComponents = 0;
+    ComponentTarget components[maxAttributes*4];
+    uint32_t nofFlatAttributes = 0;
+    uint8_t flatAttributes[maxAttributes];
+
+    // Fragment shader dostava derivace float slozek (Program::derivatives)
+    bool derivatives = false;
+} InterpolationLayout;
+
+// Trojuhelnik po sestaveni, pripraveny k rasterizaci po dlazdicich
+typedef struct setupTriangle {
+    PixelRectangle box;
+    EdgeFunction edges[3];
+
+    // Pocatek rovin interpolace (vrchol 0 ve screen space)
+    float x0;
+    float y0;
+    InterpolationPlane depth;
+    InterpolationPlane inverseW;
+
+    // Float slozky se interpoluji jako atribut/w, celociselne atributy se berou z vrcholu 0
+    // Obe pole jsou v poradi podle InterpolationLayout kresleni
+    InterpolationPlane attributePlanes[maxAttributes*4];
+    Attribute flatAttributes[maxAttributes];
+} SetupTriangle;
+
+// Vysledek testu obdelniku (dlazdice) proti hranam trojuhelniku
+enum class TileCoverage {
+    OUTSIDE,
+    PARTIAL,
+    INSIDE
+};
+
+struct drawState;
+
+// Rasterizace trojuhelniku v dlazdici, varianta se vybira jednou za kresleni
+typedef void (*RasterizeFunction)(SetupTriangle& setup, PixelRectangle& tile, float& tileMaxDepth, struct drawState& state, Frame& framebuffer, GPUCounters& counters);
+
+// Stav jednoho kresliciho prikazu sdileny jeho trojuhelniky
+typedef struct drawState {
+    Program prg;
+    ShaderInterface shaderInterface;
+    InterpolationLayout layout;
+    RasterizeFunction rasterize;
+
+    // Prace s hloubkou podle DrawCommand, blending urcuje varianta rasterize
+    bool depthTest;
+    bool depthWrite;
+
+    // Fragmenty se smi zahodit pred fragment shaderem, jen kdyz shader nema vedlejsi efekty
+    bool earlyDepthTest;
+    bool hierarchicalDepth;
+
+    // Nepruhledne kresleni s hloubkovym predpruchodem (CommandBuffer::depthPrepass),
+    // hloubka je uz zapsana a barvu zapise jen fragment se stejnou hloubkou
+    bool prepass;
+    bool depthEqual;
+
+    // Fragment shader zapisuje normalu a pozici do g-bufferu framebufferu (odlozene stinovani)
+    bool gbufferOutput;
+} DrawState;
+
+// Vystupy vertex shaderu jednoho kresleni jako struktura poli (SoA)
+typedef struct vertexBuffers {
+    // gl_VertexID kazdeho transformovaneho vrcholu
+    std::vector<uint32_t> vertexIds;
+
+    // Pro kazdy vrchol kresleni index transformovaneho vrcholu
+    std::vector<uint32_t> slots;
+
+    std::vector<glm::vec4> positions;
+    std::vector<Attribute> attributes[maxAttributes];
+
+    // gl_VertexID -> index transformovaneho vrcholu, mezi kreslenimi ma vsude noSlot
+    std::vector<uint32_t> slotTable;
+} VertexBuffers;
+
+uint32_t const noSlot = UINT32_MAX;
+
+// Kopie jednoho atributu z bufferu do InVertex
+typedef void (*AttributeCopy)(Attribute& attribute, uint8_t const* source);
+
+// Predpripravene cteni jednoho aktivniho atributu
+typedef struct attributeFetch {
+    uint32_t attribute;
+    uint8_t const* base;
+    uint64_t stride;
+    AttributeCopy copy;
+} AttributeFetch;
+
+// Plan cteni vrcholu sestaveny z VertexArray jednou za kresleni
+typedef struct fetchPlan {
+    uint32_t nofAttributes = 0;
+    AttributeFetch attributes[maxAttributes];
+} FetchPlan;
+
+// Seznam trojuhelniku pro kazdou dlazdici ve framebufferu, v poradi z command bufferu
+typedef struct tileBins {
+    uint32_t tilesX = 0;
+    uint32_t tilesY = 0;
+    std::vector<SetupTriangle> triangles;
+    std::vector<DrawState> draws;
+    std::vector<uint32_t> triangleDraws;
+    std::vector<std::vector<uint32_t>> bins;
+
+    // Horni odhad hloubky v kazde dlazdici (hierarchicky z-buffer)
+    std::vector<float> tileMaxDepth;
+
+    // Citace kazdeho vlakna, po dokonceni prace se prictou ke globalnim
+    std::vector<GPUCounters> workerCounters;
+
+    // Neprovedene mazani kazde dlazdice (clearColorBit | clearDepthBit), provede se az pred
+    // prvnim trojuhelnikem v dlazdici nebo na konci command bufferu, novejsi mazani ho prepise
+    std::vector<uint8_t> pendingClears;
+
+    // Hodnoty posledniho mazani barvy a hloubky jako 32bitove vzory
+    uint32_t clearColor = 0;
+    uint32_t clearDepth = 0;
+
+    // Nepruhledna kresleni se nejdrive rasterizuji jen do hloubky
+    bool depthPrepass = false;
+} TileBins;
+
+uint8_t const clearColorBit = 1;
+uint8_t const clearDepthBit = 2;
+
+GPUSettings gpuSettings;
+GPUCounters gpuCounters;
+ThreadPool threadPool;
+
+// Prace se rozdeli mezi vlakna, shadery s vedlejsimi efekty bezi jen ve volajicim vlakne
+void runJobs(uint32_t count, bool serial, ParallelJob const& job)
 {
-    if (clearcmd.clearColor)
-    {
-        for (uint32_t i = 0; i < mem.framebuffer.width*mem.framebuffer.height*mem.framebuffer.channels; i+=4)
-        {
-            mem.framebuffer.color[i]   = (uint8_t)(clearcmd.color.r*255.0);
-            mem.framebuffer.color[i+1] = (uint8_t)(clearcmd.color.g*255.0);
-            mem.framebuffer.color[i+2] = (uint8_t)(clearcmd.color.b*255.0);
-            mem.framebuffer.color[i+3] = (uint8_t)(clearcmd.color.a*255.0);
-        }
-    }
-    if (clearcmd.clearDepth)
+    if (!serial)
     {
-        for (uint32_t i = 0; i < mem.framebuffer.width*mem.framebuffer.height; i++)
-        {
-            mem.framebuffer.depth[i] = clearcmd.depth;
-        }
+        threadPool.parallelFor(count, job);
+        return;
     }
+    for (uint32_t i = 0; i < count; i++)
+        job(i, 0);
+}
+
+GPUSettings& gpu_getSettings()
+{
+    return gpuSettings;
+}
+
+GPUCounters const& gpu_getCounters()
+{
+    return gpuCounters;
+}
+
+void gpu_resetCounters()
+{
+    gpuCounters = GPUCounters();
+}
+
+void addCounters(GPUCounters& target, GPUCounters& source)
+{
+    target.coveredFragments += source.coveredFragments;
+    target.shadedFragments += source.shadedFragments;
+    target.earlyDepthKilled += source.earlyDepthKilled;
+    target.hierarchicalDepthKilled += source.hierarchicalDepthKilled;
+    target.prepassFragments += source.prepassFragments;
+    target.lightingInvocations += source.lightingInvocations;
 }
 
 void getVertexId(InVertex& inVertex, GPUMemory& mem, DrawCommand& drawcmd, uint32_t vertexNum)
@@ -55,18 +267,18 @@ void getVertexId(InVertex& inVertex, GPUMemory& mem, DrawCommand& drawcmd, uint3
         // Posunuti pointeru v bufferu na vertices
         uint8_t* index = (uint8_t*)indexBuffer + drawcmd.vao.indexOffset;
 
-        // Pole je v bytech -> pokud je vetsi typ, nasobime
+        // Offset je v bytech, index se cte cely podle sirky typu
         if (drawcmd.vao.indexType == IndexType::UINT8)
         {
             inVertex.gl_VertexID = index[vertexNum];
         }
         else if (drawcmd.vao.indexType == IndexType::UINT16)
         {
-            inVertex.gl_VertexID = index[vertexNum*sizeof(uint16_t)];
+            inVertex.gl_VertexID = ((uint16_t*)index)[vertexNum];
         }
         else
         {
-            inVertex.gl_VertexID = index[vertexNum*sizeof(uint32_t)];
+            inVertex.gl_VertexID = ((uint32_t*)index)[vertexNum];
         }
     }
 }
@@ -77,83 +289,211 @@ void getTexturesAndUniforms(ShaderInterface& shaderInterface, GPUMemory& mem)
     shaderInterface.uniforms = mem.uniforms;    
 }
 
-void readAttributes(InVertex& inVertex, GPUMemory& mem, VertexArray& va)
+template<uint32_t size>
+void copyAttribute(Attribute& attribute, uint8_t const* source)
 {
+    // Kopiruje se do slozek vektoru, union Attribute neni trivialni typ
+    std::memcpy(&attribute.v4[0], source, size);
+}
+
+AttributeCopy getAttributeCopy(AttributeType type)
+{
+    // Vsechny slozky maji 4 bajty, typ urcuje jen velikost kopie
+    switch (type)
+    {
+        case AttributeType::FLOAT:
+        case AttributeType::UINT:
+            return copyAttribute<4>;
+        case AttributeType::VEC2:
+        case AttributeType::UVEC2:
+            return copyAttribute<8>;
+        case AttributeType::VEC3:
+        case AttributeType::UVEC3:
+            return copyAttribute<12>;
+        case AttributeType::VEC4:
+        case AttributeType::UVEC4:
+            return copyAttribute<16>;
+        default:
+            return nullptr;
+    }
+}
+
+void compileFetchPlan(FetchPlan& plan, GPUMemory& mem, VertexArray& va)
+{
+    plan.nofAttributes = 0;
     for (uint32_t i = 0; i < maxAttributes; i++)
     {
-        // Buffer neni aktivovany -> next attribute
+        // Buffer neni aktivovany nebo atribut nema typ -> neni co cist
         if (va.vertexAttrib[i].bufferID == -1)
-        {
             continue;
-        }
 
-        // Cteni z adresy buf_ptr + offset + stride*gl_VertexID
-        uint32_t offset = va.vertexAttrib[i].offset + va.vertexAttrib[i].stride*inVertex.gl_VertexID;
+        AttributeCopy copy = getAttributeCopy(va.vertexAttrib[i].type);
+        if (!copy)
+            continue;
 
-        // Offset je v bytech -> pretypovani na 8bit datovy typ, posunuti o offset
-        uint8_t* index = (uint8_t*)mem.buffers[va.vertexAttrib[i].bufferID].data + offset;
+        AttributeFetch& fetch = plan.attributes[plan.nofAttributes];
+        fetch.attribute = i;
+        fetch.base = (uint8_t const*)mem.buffers[va.vertexAttrib[i].bufferID].data + va.vertexAttrib[i].offset;
+        fetch.stride = va.vertexAttrib[i].stride;
+        fetch.copy = copy;
+        plan.nofAttributes++;
+    }
+}
 
-        // Podle typu atributu pretypujeme buffer; cteme 0. prvek, protoze uz jsme na spravnem offsetu
-        if (va.vertexAttrib[i].type == AttributeType::EMPTY)
-        {
-            continue;
-        }
-        else if (va.vertexAttrib[i].type == AttributeType::FLOAT)
-        {
-            float* vertexAttributeBuffer = (float*)index;
-            inVertex.attributes[i].v1 = vertexAttributeBuffer[0];
-        }
-        else if (va.vertexAttrib[i].type == AttributeType::UINT)
-        {
-            uint32_t* vertexAttributeBuffer = (uint32_t*)index;
-            inVertex.attributes[i].u1 = vertexAttributeBuffer[0];
-        }
-        else if (va.vertexAttrib[i].type == AttributeType::UVEC2)
-        {
-            glm::uvec2* vertexAttributeBuffer = (glm::uvec2*)index;
-            inVertex.attributes[i].u2 = vertexAttributeBuffer[0];
-        }
-        else if (va.vertexAttrib[i].type == AttributeType::UVEC3)
-        {
-            glm::uvec3* vertexAttributeBuffer = (glm::uvec3*)index;
-            inVertex.attributes[i].u3 = vertexAttributeBuffer[0];
-        }
-        else if (va.vertexAttrib[i].type == AttributeType::UVEC4)
-        {
-            glm::uvec4* vertexAttributeBuffer = (glm::uvec4*)index;
-            inVertex.attributes[i].u4 = vertexAttributeBuffer[0];
-        }
-        else if (va.vertexAttrib[i].type == AttributeType::VEC2)
-        {
-            glm::vec2* vertexAttributeBuffer = (glm::vec2*)index;
-            inVertex.attributes[i].v2 = vertexAttributeBuffer[0];
-        }
-        else if (va.vertexAttrib[i].type == AttributeType::VEC3)
+void fetchVertex(InVertex& inVertex, FetchPlan& plan)
+{
+    // Cteni z adresy buf_ptr + offset + stride*gl_VertexID v 64 bitech
+    for (uint32_t a = 0; a < plan.nofAttributes; a++)
+    {
+        AttributeFetch& fetch = plan.attributes[a];
+        fetch.copy(inVertex.attributes[fetch.attribute], fetch.base + fetch.stride*inVertex.gl_VertexID);
+    }
+}
+
+void startSequentialFetch(uint8_t const* cursors[maxAttributes], FetchPlan& plan, uint32_t firstVertexId)
+{
+    for (uint32_t a = 0; a < plan.nofAttributes; a++)
+        cursors[a] = plan.attributes[a].base + plan.attributes[a].stride*firstVertexId;
+}
+
+void fetchNextVertex(InVertex& inVertex, FetchPlan& plan, uint8_t const* cursors[maxAttributes])
+{
+    for (uint32_t a = 0; a < plan.nofAttributes; a++)
+    {
+        AttributeFetch& fetch = plan.attributes[a];
+        fetch.copy(inVertex.attributes[fetch.attribute], cursors[a]);
+        cursors[a] += fetch.stride;
+    }
+}
+
+bool isSequentialRange(std::vector<uint32_t>& vertexIds, uint32_t begin, uint32_t end)
+{
+    for (uint32_t v = begin + 1; v < end; v++)
+    {
+        if (vertexIds[v] != vertexIds[v - 1] + 1)
+            return false;
+    }
+    return true;
+}
+
+void collectVertices(VertexBuffers& buffers, GPUMemory& mem, DrawCommand& drawcmd, Program& prg, uint32_t nofVertices)
+{
+    buffers.vertexIds.resize(nofVertices);
+    buffers.slots.resize(nofVertices);
+
+    uint32_t maxVertexId = 0;
+    for (uint32_t i = 0; i < nofVertices; i++)
+    {
+        InVertex inVertex;
+        getVertexId(inVertex, mem, drawcmd, i);
+        buffers.vertexIds[i] = inVertex.gl_VertexID;
+        buffers.slots[i] = i;
+        maxVertexId = std::max(maxVertexId, inVertex.gl_VertexID);
+    }
+
+    // Neindexovane kresleni vrcholy neopakuje, shader s vedlejsimi efekty se vola pro kazdy index
+    if (!gpuSettings.vertexCache || drawcmd.vao.indexBufferID == -1 || prg.sideEffects)
+        return;
+
+    if (maxVertexId >= (uint64_t)maxVertexIdSpread*nofVertices + UINT16_MAX)
+        return;
+
+    gpuCounters.vertexCacheLookups += nofVertices;
+
+    // Kazdy gl_VertexID se transformuje jen jednou, poradi prvniho vyskytu zustava
+    if (buffers.slotTable.size() <= maxVertexId)
+        buffers.slotTable.resize(maxVertexId + 1, noSlot);
+
+    uint32_t nofUnique = 0;
+    for (uint32_t i = 0; i < nofVertices; i++)
+    {
+        uint32_t vertexId = buffers.vertexIds[i];
+        if (buffers.slotTable[vertexId] == noSlot)
         {
-            glm::vec3* vertexAttributeBuffer = (glm::vec3*)index;
-            inVertex.attributes[i].v3 = vertexAttributeBuffer[0];
+            buffers.slotTable[vertexId] = nofUnique;
+            buffers.vertexIds[nofUnique] = vertexId;
+            nofUnique++;
         }
-        else if (va.vertexAttrib[i].type == AttributeType::VEC4)
+        buffers.slots[i] = buffers.slotTable[vertexId];
+    }
+    buffers.vertexIds.resize(nofUnique);
+
+    for (uint32_t vertexId : buffers.vertexIds)
+        buffers.slotTable[vertexId] = noSlot;
+
+    gpuCounters.vertexCacheHits += nofVertices - nofUnique;
+}
+
+void shadeVertices(VertexBuffers& buffers, GPUMemory& mem, DrawCommand& drawcmd, Program& prg, uint32_t drawNum)
+{
+    uint32_t nofVertices = buffers.vertexIds.size();
+    buffers.positions.resize(nofVertices);
+    for (uint8_t i = 0; i < maxAttributes; i++)
+    {
+        if (prg.vs2fs[i] != AttributeType::EMPTY)
+            buffers.attributes[i].resize(nofVertices);
+    }
+
+    ShaderInterface shaderInterface;
+    getTexturesAndUniforms(shaderInterface, mem);
+
+    // Aktivni atributy se vyberou jednou pro cele kresleni
+    FetchPlan plan;
+    compileFetchPlan(plan, mem, drawcmd.vao);
+
+    // Vrcholy jsou nezavisle, vlakna si berou cele bloky
+    uint32_t nofChunks = (nofVertices + vertexChunkSize - 1)/vertexChunkSize;
+    runJobs(nofChunks, prg.sideEffects, [&](uint32_t chunk, uint32_t)
+    {
+        uint32_t begin = chunk*vertexChunkSize;
+        uint32_t end = std::min(nofVertices, begin + vertexChunkSize);
+
+        // Souvisly rozsah gl_VertexID se cte jen posouvanim ukazatelu
+        bool sequential = isSequentialRange(buffers.vertexIds, begin, end);
+        uint8_t const* cursors[maxAttributes];
+        if (sequential)
+            startSequentialFetch(cursors, plan, buffers.vertexIds[begin]);
+
+        for (uint32_t v = begin; v < end; v++)
         {
-            glm::vec4* vertexAttributeBuffer = (glm::vec4*)index;
-            inVertex.attributes[i].v4 = vertexAttributeBuffer[0];
+            InVertex inVertex;
+            OutVertex outVertex;
+
+            inVertex.gl_DrawID = drawNum;
+            inVertex.gl_VertexID = buffers.vertexIds[v];
+            if (sequential)
+                fetchNextVertex(inVertex, plan, cursors);
+            else
+                fetchVertex(inVertex, plan);
+
+            prg.vertexShader(outVertex, inVertex, shaderInterface);
+
+            // Dal se dostanou jen atributy, ktere se interpoluji do fragmentu
+            buffers.positions[v] = outVertex.gl_Position;
+            for (uint8_t i = 0; i < maxAttributes; i++)
+            {
+                if (prg.vs2fs[i] != AttributeType::EMPTY)
+                    buffers.attributes[i][v] = outVertex.attributes[i];
+            }
         }
-    }
+    });
+
+    gpuCounters.vertexShaderInvocations += nofVertices;
 }
 
-void loadTriangle(Triangle& triangle, GPUMemory& mem, DrawCommand& drawcmd, Program& prg, uint32_t triangleNum, uint32_t drawNum)
+void loadTriangle(Triangle& triangle, VertexBuffers& buffers, Program& prg, uint32_t triangleNum)
 {
     for (uint32_t vertNum = 0; vertNum < 3; vertNum++)
     {
-        InVertex inVertex;
-        ShaderInterface shaderInterface;
-
-        inVertex.gl_DrawID = drawNum;
-        getVertexId(inVertex, mem, drawcmd, 3*triangleNum + vertNum);
-        getTexturesAndUniforms(shaderInterface, mem);
-        readAttributes(inVertex, mem, drawcmd.vao);
+        uint32_t slot = buffers.slots[3*triangleNum + vertNum];
+        OutVertex& vertex = triangle.vertices[vertNum];
 
-        prg.vertexShader(triangle.vertices[vertNum], inVertex, shaderInterface);
+        vertex.gl_Position = buffers.positions[slot];
+        for (uint8_t i = 0; i < maxAttributes; i++)
+        {
+            if (prg.vs2fs[i] != AttributeType::EMPTY)
+                vertex.attributes[i] = buffers.attributes[i][slot];
+        }
     }
 }
 
@@ -179,320 +519,1596 @@ void runViewportTransformation(Triangle& triangle, Frame& frame)
     
 }
 
-bool isClockWise(Triangle& triangle)
+bool snapVertices(glm::i64vec2 snapped[3], Triangle& triangle)
 {
-    OutVertex A = triangle.vertices[0];
-    OutVertex B = triangle.vertices[1];
-    OutVertex C = triangle.vertices[2]; 
-
-    int32_t u1 = B.gl_Position.x - A.gl_Position.x;
-    int32_t u2 = B.gl_Position.y - A.gl_Position.y;
-    int32_t v1 = C.gl_Position.x - B.gl_Position.x;
-    int32_t v2 = C.gl_Position.y - B.gl_Position.y;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        float x = triangle.vertices[i].gl_Position.x;
+        float y = triangle.vertices[i].gl_Position.y;
 
-    int32_t crossProductZ = u1*v2 - u2*v1;
+        // Zaroven odfiltruje NaN
+        if (!(std::abs(x) <= maxRasterCoordinate && std::abs(y) <= maxRasterCoordinate))
+            return false;
 
-    return (crossProductZ < 0);
+        snapped[i].x = (int64_t)std::llround(x*subPixelScale);
+        snapped[i].y = (int64_t)std::llround(y*subPixelScale);
+    }
+    return true;
 }
 
-bool hasIdenticalVertices(Triangle& triangle)
+int64_t findDoubleArea(glm::i64vec2 snapped[3])
 {
-    return ((triangle.vertices[0].gl_Position.x == triangle.vertices[1].gl_Position.x  &&
-             triangle.vertices[0].gl_Position.y == triangle.vertices[1].gl_Position.y) ||
+    glm::i64vec2 u = snapped[1] - snapped[0];
+    glm::i64vec2 v = snapped[2] - snapped[0];
 
-            (triangle.vertices[1].gl_Position.x == triangle.vertices[2].gl_Position.x  &&
-             triangle.vertices[1].gl_Position.y == triangle.vertices[2].gl_Position.y) ||
-
-            (triangle.vertices[2].gl_Position.x == triangle.vertices[0].gl_Position.x  &&
-             triangle.vertices[2].gl_Position.y == triangle.vertices[0].gl_Position.y));
+    return u.x*v.y - u.y*v.x;
 }
 
-float findXMin(Triangle& triangle)
+bool isClockWise(int64_t doubleArea)
 {
-    float tmp = std::min<float>(triangle.vertices[0].gl_Position.x, triangle.vertices[1].gl_Position.x);
-    return std::min<float>(tmp, triangle.vertices[2].gl_Position.x);
+    return (doubleArea < 0);
 }
 
-float findXMax(Triangle& triangle)
+void setupEdgeFunction(EdgeFunction& edge, glm::i64vec2& point1, glm::i64vec2& point2, bool clockWise)
 {
-    float tmp = std::max<float>(triangle.vertices[0].gl_Position.x, triangle.vertices[1].gl_Position.x);
-    return std::max<float>(tmp, triangle.vertices[2].gl_Position.x);
+    // E = u1*v2 - u2*v1, kde u = point2 - point1 a v = P - point1
+    edge.a = point1.y - point2.y;
+    edge.b = point2.x - point1.x;
+    edge.c = point1.x*point2.y - point1.y*point2.x;
+
+    // Vnitrek trojuhelniku vzdy na kladne strane hran
+    if (clockWise)
+    {
+        edge.a = -edge.a;
+        edge.b = -edge.b;
+        edge.c = -edge.c;
+    }
+
+    // Top-left pravidlo (v souradnicich framebufferu): pixel lezici presne na hrane patri
+    // jen trojuhelniku, pro ktery je hrana leva nebo horni -> sdilene hrany se nekresli dvakrat
+    bool topLeft = (edge.a > 0) || (edge.a == 0 && edge.b > 0);
+    if (!topLeft)
+        edge.c -= 1;
 }
 
-float findYMin(Triangle& triangle)
+int64_t evaluateEdgeFunction(EdgeFunction& edge, uint32_t x, uint32_t y)
 {
-    float tmp = std::min<float>(triangle.vertices[0].gl_Position.y, triangle.vertices[1].gl_Position.y);
-    return std::min<float>(tmp, triangle.vertices[2].gl_Position.y);
+    // Stred pixelu lezi na x + 0.5
+    int64_t px = (int64_t)x*subPixelScale + subPixelScale/2;
+    int64_t py = (int64_t)y*subPixelScale + subPixelScale/2;
+
+    return edge.a*px + edge.b*py + edge.c;
 }
 
-float findYMax(Triangle& triangle)
+uint32_t getNofFloatComponents(AttributeType type)
 {
-    float tmp = std::max<float>(triangle.vertices[0].gl_Position.y, triangle.vertices[1].gl_Position.y);
-    return std::max<float>(tmp, triangle.vertices[2].gl_Position.y);
+    // Float typy maji v enumu hodnotu rovnou poctu slozek, celociselne maji nastaveny bit 8
+    uint32_t value = (uint32_t)type;
+    return (value <= 4) ? value : 0;
 }
 
-float findEdgeFunction(OutVertex& point1, OutVertex& point2, float x, float y)
+void setupInterpolationPlane(InterpolationPlane& plane, float q0, float q1, float q2, glm::dvec2& d1, glm::dvec2& d2, double inverseDeterminant)
 {
-    float u1 = (float)(point2.gl_Position.x - point1.gl_Position.x);
-    float u2 = (float)(point2.gl_Position.y - point1.gl_Position.y);
-    float v1 = (float)(x - point1.gl_Position.x);
-    float v2 = (float)(y - point1.gl_Position.y);
+    double dq1 = (double)q1 - q0;
+    double dq2 = (double)q2 - q0;
 
-    return (u1*v2 - u2*v1);
+    plane.q0 = q0;
+    plane.dqdx = (float)((dq1*d2.y - dq2*d1.y)*inverseDeterminant);
+    plane.dqdy = (float)((dq2*d1.x - dq1*d2.x)*inverseDeterminant);
 }
 
-bool pointIsInTriangle(Triangle& triangle, float exy1, float exy2, float exy3, bool clockWise)
+float evaluatePlane(InterpolationPlane& plane, float dx, float dy)
 {
-    return ((!clockWise && exy1 >= 0.0f && exy2 >= 0.0f && exy3 >= 0.0f) ||
-             (clockWise && exy1 <= 0.0f && exy2 <= 0.0f && exy3 <= 0.0f));
+    return plane.q0 + plane.dqdx*dx + plane.dqdy*dy;
 }
 
-glm::vec3 vectorFromPoints(OutVertex& a, OutVertex& b)
+void compileInterpolationLayout(InterpolationLayout& layout, Program& prg)
 {
-    return glm::vec3 {
-        b.gl_Position.x - a.gl_Position.x,
-        b.gl_Position.y - a.gl_Position.y,
-        1.0f
-    };
+    layout.nofComponents = 0;
+    layout.nofFlatAttributes = 0;
+    layout.derivatives = prg.derivatives;
+    for (uint8_t i = 0; i < maxAttributes; i++)
+    {
+        if (prg.vs2fs[i] == AttributeType::EMPTY)
+            continue;
+
+        uint32_t nofComponents = getNofFloatComponents(prg.vs2fs[i]);
+        if (nofComponents == 0)
+        {
+            layout.flatAttributes[layout.nofFlatAttributes++] = i;
+            continue;
+        }
+
+        for (uint8_t c = 0; c < nofComponents; c++)
+        {
+            layout.components[layout.nofComponents].attribute = i;
+            layout.components[layout.nofComponents].component = c;
+            layout.nofComponents++;
+        }
+    }
 }
 
-float triangleArea(OutVertex& a, OutVertex& b, OutVertex& c)
+void setupInterpolation(SetupTriangle& setup, Triangle& triangle, InterpolationLayout& layout)
 {
-    glm::vec3 BA = vectorFromPoints(b, a);
-    glm::vec3 AC = vectorFromPoints(a, c);
+    OutVertex& A = triangle.vertices[0];
+    OutVertex& B = triangle.vertices[1];
+    OutVertex& C = triangle.vertices[2];
+
+    setup.x0 = A.gl_Position.x;
+    setup.y0 = A.gl_Position.y;
+
+    glm::dvec2 d1 = glm::dvec2(B.gl_Position) - glm::dvec2(A.gl_Position);
+    glm::dvec2 d2 = glm::dvec2(C.gl_Position) - glm::dvec2(A.gl_Position);
+    double inverseDeterminant = 1.0/(d1.x*d2.y - d2.x*d1.y);
+
+    setupInterpolationPlane(setup.depth, A.gl_Position.z, B.gl_Position.z, C.gl_Position.z, d1, d2, inverseDeterminant);
 
-    float crossProductZ = BA.x*AC.y - BA.y*AC.x;
+    // Perspektivne korektni interpolace: 1/w a atribut/w jsou ve screen space linearni
+    float inverseWA = 1.0f/A.gl_Position.w;
+    float inverseWB = 1.0f/B.gl_Position.w;
+    float inverseWC = 1.0f/C.gl_Position.w;
+    setupInterpolationPlane(setup.inverseW, inverseWA, inverseWB, inverseWC, d1, d2, inverseDeterminant);
 
-    return glm::abs(crossProductZ/2);
+    for (uint32_t c = 0; c < layout.nofComponents; c++)
+    {
+        ComponentTarget& target = layout.components[c];
+        setupInterpolationPlane(setup.attributePlanes[c],
+                                A.attributes[target.attribute].v4[target.component]*inverseWA,
+                                B.attributes[target.attribute].v4[target.component]*inverseWB,
+                                C.attributes[target.attribute].v4[target.component]*inverseWC,
+                                d1, d2, inverseDeterminant);
+    }
+
+    for (uint32_t f = 0; f < layout.nofFlatAttributes; f++)
+        setup.flatAttributes[f] = A.attributes[layout.flatAttributes[f]];
 }
 
-void calculateBarycentricCoordinates(BarycentricCoordinates& bc, OutVertex& A, OutVertex& B, OutVertex& C, OutVertex& P)
-{
-    float ABCarea = triangleArea(A, B, C);
+// Pocet interpolovanych slozek je parametr sablony, aby se smycky rozvinuly;
+// varianta dynamicComponents ho cte z rozlozeni za behu
+uint32_t const dynamicComponents = UINT32_MAX;
 
-    bc.lambda0 = triangleArea(P, B, C)/ABCarea;
-    bc.lambda1 = triangleArea(P, A, C)/ABCarea;
-    bc.lambda2 = triangleArea(P, A, B)/ABCarea;
+template<uint32_t N>
+uint32_t getNofComponents(InterpolationLayout& layout)
+{
+    return (N == dynamicComponents) ? layout.nofComponents : N;
 }
 
-void interpolateAttributes(InFragment& inFragment, Triangle& triangle, BarycentricCoordinates& bc, Program& prg)
+template<uint32_t N>
+void createFragment(InFragment& inFragment, float x, float y, SetupTriangle& setup, InterpolationLayout& layout)
 {
-    OutVertex A = triangle.vertices[0];
-    OutVertex B = triangle.vertices[1];
-    OutVertex C = triangle.vertices[2];
-    
-    float s = bc.lambda0/A.gl_Position.w + bc.lambda1/B.gl_Position.w + bc.lambda2/C.gl_Position.w;
+    float dx = x - setup.x0;
+    float dy = y - setup.y0;
 
-    barycentricCoordinates interpolated;
+    inFragment.gl_FragCoord.x = x;
+    inFragment.gl_FragCoord.y = y;
+    inFragment.gl_FragCoord.z = evaluatePlane(setup.depth, dx, dy);
 
-    interpolated.lambda0 = bc.lambda0/(A.gl_Position.w*s);
-    interpolated.lambda1 = bc.lambda1/(B.gl_Position.w*s);
-    interpolated.lambda2 = bc.lambda2/(C.gl_Position.w*s);
+    float w = 1.0f/evaluatePlane(setup.inverseW, dx, dy);
 
-    for (uint8_t currentAttribute = 0; currentAttribute < maxAttributes; currentAttribute++)
+    for (uint32_t c = 0; c < getNofComponents<N>(layout); c++)
     {
-        switch (prg.vs2fs[currentAttribute])
-        {
-            case AttributeType::EMPTY:
-                break;
-            case AttributeType::UINT:
-            {
-                inFragment.attributes[currentAttribute].u1 = A.attributes[currentAttribute].u1;
-                break;
-            }
-            case AttributeType::UVEC2:
-            {
-                inFragment.attributes[currentAttribute].u2 = A.attributes[currentAttribute].u2;
-                break;
-            }
-            case AttributeType::UVEC3:
-            {
-                inFragment.attributes[currentAttribute].u3 = A.attributes[currentAttribute].u3;
-                break;
-            }
-            case AttributeType::UVEC4:
-            {
-                inFragment.attributes[currentAttribute].u4 = A.attributes[currentAttribute].u4;
-                break;
-            }
-            case AttributeType::FLOAT:
-            {
-                inFragment.attributes[currentAttribute].v1 = A.attributes[currentAttribute].v1*interpolated.lambda0 +
-                                                             B.attributes[currentAttribute].v1*interpolated.lambda1 +
-                                                             C.attributes[currentAttribute].v1*interpolated.lambda2;
-            }
-            case AttributeType::VEC2:
-            {
-                inFragment.attributes[currentAttribute].v2 = A.attributes[currentAttribute].v2*interpolated.lambda0 +
-                                                             B.attributes[currentAttribute].v2*interpolated.lambda1 +
-                                                             C.attributes[currentAttribute].v2*interpolated.lambda2;
-            }
-            case AttributeType::VEC3:
-            {
-                inFragment.attributes[currentAttribute].v3 = A.attributes[currentAttribute].v3*interpolated.lambda0 +
-                                                             B.attributes[currentAttribute].v3*interpolated.lambda1 +
-                                                             C.attributes[currentAttribute].v3*interpolated.lambda2;
-            }
-            case AttributeType::VEC4:
-            {
-                inFragment.attributes[currentAttribute].v4 = A.attributes[currentAttribute].v4*interpolated.lambda0 +
-                                                             B.attributes[currentAttribute].v4*interpolated.lambda1 +
-                                                             C.attributes[currentAttribute].v4*interpolated.lambda2;
-            }
-            default:
-                break;
-        }
-    }   
+        ComponentTarget& target = layout.components[c];
+        inFragment.attributes[target.attribute].v4[target.component] = evaluatePlane(setup.attributePlanes[c], dx, dy)*w;
+    }
+
+    for (uint32_t f = 0; f < layout.nofFlatAttributes; f++)
+        inFragment.attributes[layout.flatAttributes[f]].u4 = setup.flatAttributes[f].u4;
 }
 
-void createFragment(InFragment& inFragment, float x, float y, Triangle& triangle, Program& prg)
+// Derivace z rozdilu hodnot v sousednich pixelech ctverice 2x2, ve stejnem poradi operaci jako shadeQuad
+template<uint32_t N>
+void computeDerivatives(InFragment& inFragment, uint32_t x, uint32_t y, SetupTriangle& setup, InterpolationLayout& layout)
 {
-    OutVertex A = triangle.vertices[0];
-    OutVertex B = triangle.vertices[1];
-    OutVertex C = triangle.vertices[2];
-    OutVertex P; P.gl_Position = glm::vec4(x, y, 0, 1);
+    uint32_t quadX = x & ~1u;
+    uint32_t quadY = y & ~1u;
+    float dx[2] = {quadX + 0.5f - setup.x0, (quadX + 1) + 0.5f - setup.x0};
+    float dy[2] = {quadY + 0.5f - setup.y0, (quadY + 1) + 0.5f - setup.y0};
+    uint32_t row = y & 1;
+    uint32_t column = x & 1;
+
+    float w[2][2];
+    for (uint8_t r = 0; r < 2; r++)
+        for (uint8_t c = 0; c < 2; c++)
+            w[r][c] = 1.0f/evaluatePlane(setup.inverseW, dx[c], dy[r]);
+
+    for (uint32_t c = 0; c < getNofComponents<N>(layout); c++)
+    {
+        ComponentTarget& target = layout.components[c];
+        float q[2][2];
+        for (uint8_t r = 0; r < 2; r++)
+            for (uint8_t k = 0; k < 2; k++)
+                q[r][k] = evaluatePlane(setup.attributePlanes[c], dx[k], dy[r])*w[r][k];
+
+        inFragment.dFdx[target.attribute][target.component] = q[row][1] - q[row][0];
+        inFragment.dFdy[target.attribute][target.component] = q[1][column] - q[0][column];
+    }
+}
 
-    BarycentricCoordinates bc;
+// Puvodni blending IZG: v plovouci carce, R a G se orezavaji, B se zaokrouhluje
+void blendFragmentAlpha(uint8_t* color, glm::vec4& fragColor)
+{
+    float rfloat = fragColor.x;
+    float gfloat = fragColor.y;
+    float bfloat = fragColor.z;
+    float afloat = fragColor.w;
 
-    calculateBarycentricCoordinates(bc, A, B, C, P);
+    if (afloat != 1.0f)
+    {
+        rfloat = color[0]/255.0f*(1 - afloat) + rfloat*afloat;
+        gfloat = color[1]/255.0f*(1 - afloat) + gfloat*afloat;
+        bfloat = color[2]/255.0f*(1 - afloat) + bfloat*afloat;
+    }
 
-    inFragment.gl_FragCoord.x = x;
-    inFragment.gl_FragCoord.y = y;
-    inFragment.gl_FragCoord.z = (float)(A.gl_Position.z*bc.lambda0 + B.gl_Position.z*bc.lambda1 + C.gl_Position.z*bc.lambda2);
+    color[0] = (uint8_t)(rfloat*255.0f);
+    color[1] = (uint8_t)(gfloat*255.0f);
+    color[2] = (uint8_t)(std::round(bfloat*255.0f));
+    color[3] = (uint8_t)(afloat*255.0f);
+}
+
+// Prevod do 8 bitu se zaokrouhlenim, NaN a hodnoty mimo [0, 1] se orezou (stejne jako _mm_max_ps a _mm_min_ps)
+uint8_t toFixedPoint(float value)
+{
+    value = value > 0.0f ? value : 0.0f;
+    value = value < 1.0f ? value : 1.0f;
+    return (uint8_t)(value*255.0f + 0.5f);
+}
+
+// Presne zaokrouhlene deleni 255 pro hodnoty do 255*255
+uint32_t divideBy255(uint32_t value)
+{
+    value += 128;
+    return (value + (value >> 8)) >> 8;
+}
+
+void writeGBuffer(Frame& framebuffer, size_t pixelIndex, OutFragment& outFragment)
+{
+    framebuffer.normal[pixelIndex] = encodeGBufferNormal(outFragment.gl_FragNormal);
+    framebuffer.position[pixelIndex] = outFragment.gl_FragPosition;
+}
 
-    interpolateAttributes(inFragment, triangle, bc, prg);
+bool passDepthTest(DrawState& state, float z, float depth)
+{
+    return state.depthEqual ? z == depth : z < depth;
 }
 
-void setColor(InFragment& inFragment, OutFragment& outFragment, Frame& framebuffer)
+template<BlendMode B>
+void setColor(InFragment& inFragment, OutFragment& outFragment, DrawState& state, Frame& framebuffer)
 {
     uint32_t x = (uint32_t)(inFragment.gl_FragCoord.x);
     uint32_t y = (uint32_t)(inFragment.gl_FragCoord.y);
     float z = inFragment.gl_FragCoord.z;
 
-    float rfloat = outFragment.gl_FragColor.x;
-    float gfloat = outFragment.gl_FragColor.y;
-    float bfloat = outFragment.gl_FragColor.z;
-    float afloat = outFragment.gl_FragColor.w;
+    size_t depthIndex = getPixelIndex(framebuffer, x, y);
+    uint8_t* target = framebuffer.color + depthIndex*framebuffer.channels;
 
-    uint32_t depthIndex = framebuffer.width*y + x;
-    uint32_t colorIndex = depthIndex*framebuffer.channels;
+    if (state.depthTest && !passDepthTest(state, z, framebuffer.depth[depthIndex]))
+        return;
 
-    if (z < framebuffer.depth[framebuffer.width*y + x])
+    // Smes pracuje se 4 kanaly, framebuffer s jinym poctem kanalu dostane jen sve bajty
+    uint32_t channels = std::min(framebuffer.channels, 4u);
+    uint8_t pixel[4] = {0, 0, 0, 255};
+    uint8_t* color = target;
+    if (channels != 4)
     {
-        if (afloat != 1.0f)
-        {
-            rfloat = framebuffer.color[colorIndex + 0]/255.0f*(1 - afloat) + rfloat*afloat;
-            gfloat = framebuffer.color[colorIndex + 1]/255.0f*(1 - afloat) + gfloat*afloat;
-            bfloat = framebuffer.color[colorIndex + 2]/255.0f*(1 - afloat) + bfloat*afloat;
-        }
+        memcpy(pixel, target, channels);
+        color = pixel;
+    }
 
-        framebuffer.color[colorIndex + 0] = (uint8_t)(rfloat*255.0f);
-        framebuffer.color[colorIndex + 1] = (uint8_t)(gfloat*255.0f);
-        framebuffer.color[colorIndex + 2] = (uint8_t)(std::round(bfloat*255.0f));
-        framebuffer.color[colorIndex + 3] = (uint8_t)(afloat*255.0f);
-        
-        if (afloat > 0.5f)
-            framebuffer.depth[depthIndex] = z;
+    // Blending je parametr sablony, vetev se vybere uz pri prekladu
+    glm::vec4& fragColor = outFragment.gl_FragColor;
+    bool writeDepth = state.depthWrite;
+    switch (B)
+    {
+    case BlendMode::FRAGMENT_ALPHA:
+        blendFragmentAlpha(color, fragColor);
+        writeDepth &= fragColor.w > 0.5f;
+        break;
+    case BlendMode::NONE:
+        for (uint32_t c = 0; c < 4; c++)
+            color[c] = toFixedPoint(fragColor[c]);
+        break;
+    case BlendMode::ALPHA:
+    {
+        // Cela smes v celych cislech, barva framebufferu se neprevadi na float
+        uint32_t alpha = toFixedPoint(fragColor.w);
+        for (uint32_t c = 0; c < 4; c++)
+            color[c] = (uint8_t)divideBy255(toFixedPoint(fragColor[c])*alpha + color[c]*(255 - alpha));
+        break;
+    }
     }
+    if (color == pixel)
+        memcpy(target, pixel, channels);
+
+    if (writeDepth)
+        framebuffer.depth[depthIndex] = z;
+    if (state.gbufferOutput)
+        writeGBuffer(framebuffer, depthIndex, outFragment);
 }
 
-void rasterizeTriangle(Triangle& triangle, DrawCommand& drawcmd, Program& prg, Frame& framebuffer)
+int64_t floorDivide(int64_t a, int64_t b)
 {
-    bool clockWise = isClockWise(triangle);
-    if (drawcmd.backfaceCulling && clockWise)
-        return;
+    return (a >= 0) ? a/b : -((-a + b - 1)/b);
+}
 
-    if (hasIdenticalVertices(triangle))
-        return;
+bool findPixelBoundingBox(PixelRectangle& box, glm::i64vec2 snapped[3], Frame& framebuffer)
+{
+    int64_t xmin = std::min(std::min(snapped[0].x, snapped[1].x), snapped[2].x);
+    int64_t xmax = std::max(std::max(snapped[0].x, snapped[1].x), snapped[2].x);
+    int64_t ymin = std::min(std::min(snapped[0].y, snapped[1].y), snapped[2].y);
+    int64_t ymax = std::max(std::max(snapped[0].y, snapped[1].y), snapped[2].y);
+
+    // Pixely, jejichz stredy lezi uvnitr obalky, orezane na framebuffer
+    int64_t half = subPixelScale/2;
+    int64_t pxmin = std::max((int64_t)0, floorDivide(xmin - half + subPixelScale - 1, subPixelScale));
+    int64_t pxmax = std::min((int64_t)framebuffer.width - 1, floorDivide(xmax - half, subPixelScale));
+    int64_t pymin = std::max((int64_t)0, floorDivide(ymin - half + subPixelScale - 1, subPixelScale));
+    int64_t pymax = std::min((int64_t)framebuffer.height - 1, floorDivide(ymax - half, subPixelScale));
+
+    if (pxmin > pxmax || pymin > pymax)
+        return false;
+
+    box.xmin = (uint32_t)pxmin;
+    box.xmax = (uint32_t)pxmax;
+    box.ymin = (uint32_t)pymin;
+    box.ymax = (uint32_t)pymax;
+    return true;
+}
 
-    float xmin = findXMin(triangle);
-    float xmax = findXMax(triangle);
-    float ymin = findYMin(triangle);
-    float ymax = findYMax(triangle); 
+void initTileBins(TileBins& tileBins, Frame& framebuffer)
+{
+    tileBins.tilesX = (framebuffer.width + tileSize - 1)/tileSize;
+    tileBins.tilesY = (framebuffer.height + tileSize - 1)/tileSize;
+    tileBins.bins.resize(tileBins.tilesX*tileBins.tilesY);
+
+    // Obsah z-bufferu pred prvnim mazanim nezname
+    tileBins.tileMaxDepth.assign(tileBins.bins.size(), INFINITY);
+    tileBins.workerCounters.assign(threadPool.getNofThreads(), GPUCounters());
+    tileBins.pendingClears.assign(tileBins.bins.size(), 0);
+}
 
-    for (uint32_t y = 0; y < framebuffer.height; y++)
+void collectCounters(TileBins& tileBins)
+{
+    for (auto& counters : tileBins.workerCounters)
     {
-        for (uint32_t x = 0; x < framebuffer.width; x++)
-        {
-            float xfloat = x + 0.5f;
-            float yfloat = y + 0.5f;
+        addCounters(gpuCounters, counters);
+        counters = GPUCounters();
+    }
+}
 
-            float exy1 = findEdgeFunction(triangle.vertices[0], triangle.vertices[1], xfloat, yfloat); 
-            float exy2 = findEdgeFunction(triangle.vertices[1], triangle.vertices[2], xfloat, yfloat);
-            float exy3 = findEdgeFunction(triangle.vertices[2], triangle.vertices[0], xfloat, yfloat);
+void clearTileBins(TileBins& tileBins)
+{
+    tileBins.triangles.clear();
+    tileBins.draws.clear();
+    tileBins.triangleDraws.clear();
+    for (auto& bin : tileBins.bins)
+        bin.clear();
+}
 
-            if (pointIsInTriangle(triangle, exy1, exy2, exy3, clockWise))
-            {
-                InFragment inFragment;
-                OutFragment outFragment;
-                ShaderInterface shaderInterface;
+void binTriangle(TileBins& tileBins, SetupTriangle& setup)
+{
+    uint32_t triangleIndex = tileBins.triangles.size();
+    tileBins.triangles.push_back(setup);
+    tileBins.triangleDraws.push_back(tileBins.draws.size() - 1);
 
-                createFragment(inFragment, xfloat, yfloat, triangle, prg);
-                prg.fragmentShader(outFragment, inFragment, shaderInterface);
-                setColor(inFragment, outFragment, framebuffer);
-            }
+    for (uint32_t ty = setup.box.ymin/tileSize; ty <= setup.box.ymax/tileSize; ty++)
+    {
+        for (uint32_t tx = setup.box.xmin/tileSize; tx <= setup.box.xmax/tileSize; tx++)
+        {
+            tileBins.bins[ty*tileBins.tilesX + tx].push_back(triangleIndex);
         }
     }
 }
 
-void draw(GPUMemory& mem, DrawCommand& drawcmd, uint32_t drawNum)
+template<bool cullBackFaces>
+void setupTriangle(TileBins& tileBins, Triangle& triangle, InterpolationLayout& layout, Frame& framebuffer)
 {
-    Program prg = mem.programs[drawcmd.programID];
-    
-    for (uint32_t i = 0; i < drawcmd.nofVertices/3; i++)
+    SetupTriangle setup;
+
+    // Trojuhelniky mimo rozsah celociselne rasterizace se zahodi
+    glm::i64vec2 snapped[3];
+    if (!snapVertices(snapped, triangle))
+        return;
+
+    int64_t doubleArea = findDoubleArea(snapped);
+    bool clockWise = isClockWise(doubleArea);
+    if (cullBackFaces && clockWise)
+        return;
+
+    // Degenerovany trojuhelnik (i se shodnymi vrcholy) nema zadne pixely
+    if (doubleArea == 0)
+        return;
+
+    if (!findPixelBoundingBox(setup.box, snapped, framebuffer))
+        return;
+
+    for (uint8_t i = 0; i < 3; i++)
+        setupEdgeFunction(setup.edges[i], snapped[i], snapped[(i + 1)%3], clockWise);
+
+    setupInterpolation(setup, triangle, layout);
+    binTriangle(tileBins, setup);
+}
+
+TileCoverage classifyRectangle(SetupTriangle& setup, PixelRectangle& rect)
+{
+    bool inside = true;
+
+    for (uint8_t i = 0; i < 3; i++)
     {
-        Triangle triangle;
-        loadTriangle(triangle, mem, drawcmd, prg, i, drawNum);
+        EdgeFunction& edge = setup.edges[i];
+
+        // Hranova funkce je afinni -> extremy lezi v rozich obdelniku
+        int64_t e00 = evaluateEdgeFunction(edge, rect.xmin, rect.ymin);
+        int64_t e10 = evaluateEdgeFunction(edge, rect.xmax, rect.ymin);
+        int64_t e01 = evaluateEdgeFunction(edge, rect.xmin, rect.ymax);
+        int64_t e11 = evaluateEdgeFunction(edge, rect.xmax, rect.ymax);
 
-        // Primitive assembly
-        runPerspectiveDivision(triangle);
-        runViewportTransformation(triangle, mem.framebuffer);
-        rasterizeTriangle(triangle, drawcmd, prg, mem.framebuffer);
+        int64_t emax = std::max(std::max(e00, e10), std::max(e01, e11));
+        int64_t emin = std::min(std::min(e00, e10), std::min(e01, e11));
+
+        if (emax < 0)
+            return TileCoverage::OUTSIDE;
+
+        if (emin < 0)
+            inside = false;
     }
+
+    return inside ? TileCoverage::INSIDE : TileCoverage::PARTIAL;
 }
 
-//! [gpu_execute]
-void gpu_execute(GPUMemory&mem,CommandBuffer &cb){
-  /// \todo Tato funkce reprezentuje funkcionalitu grafické karty.<br>
-  /// Měla by umět zpracovat command buffer, čistit framebuffer a kresli.<br>
-  /// mem obsahuje paměť grafické karty.
-  /// cb obsahuje command buffer pro zpracování.
-  /// Bližší informace jsou uvedeny na hlavní stránce dokumentace.
+template<uint32_t N, BlendMode B>
+void shadeFragment(SetupTriangle& setup, float x, float y, DrawState& state, Frame& framebuffer, GPUCounters& counters)
+{
+    counters.coveredFragments++;
 
-    uint32_t drawNumber = 0;
-    for (uint32_t i = 0; i < cb.nofCommands; i++)
+    // Fragment shader nemeni hloubku ani nezahazuje fragmenty,
+    // depth test pred nim proto dava stejny vysledek jako pozdni test
+    if (state.earlyDepthTest && state.depthTest)
     {
-        if (cb.commands[i].type == CommandType::CLEAR)
-        {
-            clear(mem, cb.commands[i].data.clearCommand);
-        }
-        else if (cb.commands[i].type == CommandType::DRAW)
+        float z = evaluatePlane(setup.depth, x - setup.x0, y - setup.y0);
+        if (!passDepthTest(state, z, framebuffer.depth[getPixelIndex(framebuffer, (uint32_t)x, (uint32_t)y)]))
         {
-            draw(mem, cb.commands[i].data.drawCommand, drawNumber);
-            drawNumber++;
+            counters.earlyDepthKilled++;
+            return;
         }
     }
 
+    InFragment inFragment;
+    OutFragment outFragment;
+
+    createFragment<N>(inFragment, x, y, setup, state.layout);
+    if (state.layout.derivatives)
+        computeDerivatives<N>(inFragment, (uint32_t)x, (uint32_t)y, setup, state.layout);
+    state.prg.fragmentShader(outFragment, inFragment, state.shaderInterface);
+    counters.shadedFragments++;
+    setColor<B>(inFragment, outFragment, state, framebuffer);
 }
-//! [gpu_execute]
 
-/**
- * @brief This function reads color from texture.
- *
- * @param texture texture
+float findMinimalDepth(SetupTriangle& setup, PixelRectangle& rect)
+{
+    float dx[2] = {rect.xmin + 0.5f - setup.x0, rect.xmax + 0.5f - setup.x0};
+    float dy[2] = {rect.ymin + 0.5f - setup.y0, rect.ymax + 0.5f - setup.y0};
+
+    // Rovina je linearni, minimum v obdelniku lezi v nekterem rohu
+    float minDepth = INFINITY;
+    for (uint8_t i = 0; i < 2; i++)
+        for (uint8_t j = 0; j < 2; j++)
+            minDepth = std::min(minDepth, evaluatePlane(setup.depth, dx[i], dy[j]));
+
+    // Rezerva na zaokrouhleni pri vyhodnoceni roviny v jednotlivych pixelech
+    float maxDx = std::max(std::abs(dx[0]), std::abs(dx[1]));
+    float maxDy = std::max(std::abs(dy[0]), std::abs(dy[1]));
+    float error = std::abs(setup.depth.q0) + std::abs(setup.depth.dqdx)*maxDx + std::abs(setup.depth.dqdy)*maxDy;
+    return minDepth - 8.0f*FLT_EPSILON*error;
+}
+
+float findMaximalDepth(PixelRectangle& tile, Frame& framebuffer)
+{
+    float maxDepth = -INFINITY;
+    for (uint32_t y = tile.ymin; y <= tile.ymax; y++)
+        for (uint32_t x = tile.xmin; x <= tile.xmax; x++)
+            maxDepth = std::max(maxDepth, framebuffer.depth[getPixelIndex(framebuffer, x, y)]);
+    return maxDepth;
+}
+
+template<uint32_t N, BlendMode B>
+void rasterizeRectangle(SetupTriangle& setup, PixelRectangle& rect, TileCoverage coverage, DrawState& state, Frame& framebuffer, GPUCounters& counters)
+{
+    // Hodnoty hranovych funkci v levem dolnim pixelu, dale se jen pricita
+    int64_t rowEdges[3];
+    int64_t stepX[3];
+    int64_t stepY[3];
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        rowEdges[i] = evaluateEdgeFunction(setup.edges[i], rect.xmin, rect.ymin);
+        stepX[i] = setup.edges[i].a*subPixelScale;
+        stepY[i] = setup.edges[i].b*subPixelScale;
+    }
+
+    for (uint32_t y = rect.ymin; y <= rect.ymax; y++)
+    {
+        int64_t e0 = rowEdges[0];
+        int64_t e1 = rowEdges[1];
+        int64_t e2 = rowEdges[2];
+
+        for (uint32_t x = rect.xmin; x <= rect.xmax; x++)
+        {
+            // Znamenkovy bit je nastaven, pokud je nektera hodnota zaporna
+            if (coverage == TileCoverage::INSIDE || (e0 | e1 | e2) >= 0)
+            {
+                shadeFragment<N, B>(setup, x + 0.5f, y + 0.5f, state, framebuffer, counters);
+            }
+
+            e0 += stepX[0];
+            e1 += stepX[1];
+            e2 += stepX[2];
+        }
+
+        rowEdges[0] += stepY[0];
+        rowEdges[1] += stepY[1];
+        rowEdges[2] += stepY[2];
+    }
+}
+
+#ifdef __SSE2__
+// Pruhy ctverice 2x2: 0 = (x, y), 1 = (x + 1, y), 2 = (x, y + 1), 3 = (x + 1, y + 1)
+uint32_t const quadLanes = 4;
+
+uint32_t countLanes(uint32_t mask)
+{
+    return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
+
+__m128i getLaneMask(uint32_t mask)
+{
+    return _mm_setr_epi32(-(int32_t)(mask & 1), -(int32_t)((mask >> 1) & 1), -(int32_t)((mask >> 2) & 1), -(int32_t)((mask >> 3) & 1));
+}
+
+__m128 selectLanes(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Stejne poradi operaci jako evaluatePlane, vysledek je bitove stejny
+__m128 evaluatePlaneQuad(InterpolationPlane& plane, __m128 dx, __m128 dy)
+{
+    __m128 value = _mm_add_ps(_mm_set1_ps(plane.q0), _mm_mul_ps(_mm_set1_ps(plane.dqdx), dx));
+    return _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(plane.dqdy), dy));
+}
+
+// Zaokrouhleni jako std::round (polovina od nuly), SSE2 umi jen oriznuti
+__m128i roundQuad(__m128 value)
+{
+    __m128i truncated = _mm_cvttps_epi32(value);
+    __m128 difference = _mm_sub_ps(value, _mm_cvtepi32_ps(truncated));
+    __m128 up = _mm_and_ps(_mm_cmpge_ps(difference, _mm_set1_ps(0.5f)), _mm_cmplt_ps(difference, _mm_set1_ps(1.0f)));
+    __m128 down = _mm_and_ps(_mm_cmple_ps(difference, _mm_set1_ps(-0.5f)), _mm_cmpgt_ps(difference, _mm_set1_ps(-1.0f)));
+
+    // Maska je v pruhu -1, odectenim se pricte jednicka
+    truncated = _mm_sub_epi32(truncated, _mm_castps_si128(up));
+    return _mm_add_epi32(truncated, _mm_castps_si128(down));
+}
+
+__m128 getColorChannel(__m128i color, uint32_t channel)
+{
+    __m128i value = _mm_and_si128(_mm_srl_epi32(color, _mm_cvtsi32_si128(8*channel)), _mm_set1_epi32(0xff));
+    return _mm_cvtepi32_ps(value);
+}
+
+__m128i packColorChannel(__m128i value, uint32_t channel)
+{
+    // Z prevodu na int se bere nejnizsi bajt stejne jako pri pretypovani na uint8_t
+    return _mm_sll_epi32(_mm_and_si128(value, _mm_set1_epi32(0xff)), _mm_cvtsi32_si128(8*channel));
+}
+
+__m128i blendFragmentAlphaQuad(__m128i color, __m128 colors[4])
+{
+    __m128 alpha = colors[3];
+    __m128 inverseAlpha = _mm_sub_ps(_mm_set1_ps(1.0f), alpha);
+    __m128 blend = _mm_cmpneq_ps(alpha, _mm_set1_ps(1.0f));
+
+    __m128i pixels = packColorChannel(_mm_cvttps_epi32(_mm_mul_ps(alpha, _mm_set1_ps(255.0f))), 3);
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        __m128 destination = _mm_div_ps(getColorChannel(color, c), _mm_set1_ps(255.0f));
+        __m128 blended = _mm_add_ps(_mm_mul_ps(destination, inverseAlpha), _mm_mul_ps(colors[c], alpha));
+        __m128 value = _mm_mul_ps(selectLanes(blend, blended, colors[c]), _mm_set1_ps(255.0f));
+
+        // Modra slozka se v blendFragmentAlpha zaokrouhluje, ostatni orezavaji
+        __m128i converted = (c == 2) ? roundQuad(value) : _mm_cvttps_epi32(value);
+        pixels = _mm_or_si128(pixels, packColorChannel(converted, c));
+    }
+    return pixels;
+}
+
+// Stejne operace jako toFixedPoint, vysledkem jsou 4 pixely RGBA8
+__m128i toFixedPointQuad(__m128 colors[4])
+{
+    __m128i pixels = _mm_setzero_si128();
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        __m128 value = _mm_min_ps(_mm_max_ps(colors[c], _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        __m128i converted = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+        pixels = _mm_or_si128(pixels, packColorChannel(converted, c));
+    }
+    return pixels;
+}
+
+// Smes v 16bitovych pruzich, dva pixely na registr, deleni 255 jako divideBy255
+__m128i blendQuad(__m128i destination, __m128i source)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i result[2];
+    for (uint32_t h = 0; h < 2; h++)
+    {
+        __m128i s = h ? _mm_unpackhi_epi8(source, zero) : _mm_unpacklo_epi8(source, zero);
+        __m128i d = h ? _mm_unpackhi_epi8(destination, zero) : _mm_unpacklo_epi8(destination, zero);
+
+        // Alfa zdroje se rozkopiruje do vsech slozek pixelu
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i inverseAlpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+        __m128i value = _mm_add_epi16(_mm_mullo_epi16(s, alpha), _mm_mullo_epi16(d, inverseAlpha));
+        value = _mm_add_epi16(value, _mm_set1_epi16(128));
+        result[h] = _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+    }
+    return _mm_packus_epi16(result[0], result[1]);
+}
+
+template<BlendMode B>
+void setColorQuad(__m128 z, __m128 depth, __m128 colors[4], uint32_t mask, DrawState& state, float* depthRow0, float* depthRow1, uint8_t* colorRow0, uint8_t* colorRow1)
+{
+    __m128i color = _mm_unpacklo_epi64(_mm_loadl_epi64((__m128i*)colorRow0), _mm_loadl_epi64((__m128i*)colorRow1));
+    __m128i laneMask = getLaneMask(mask);
+    __m128 depthMask = _mm_castsi128_ps(laneMask);
+
+    __m128i pixels = color;
+    switch (B)
+    {
+    case BlendMode::FRAGMENT_ALPHA:
+        pixels = blendFragmentAlphaQuad(color, colors);
+        depthMask = _mm_and_ps(depthMask, _mm_cmpgt_ps(colors[3], _mm_set1_ps(0.5f)));
+        break;
+    case BlendMode::NONE:
+        pixels = toFixedPointQuad(colors);
+        break;
+    case BlendMode::ALPHA:
+        pixels = blendQuad(color, toFixedPointQuad(colors));
+        break;
+    }
+
+    // Maskovany zapis, pixely mimo masku zustanou beze zmeny
+    color = _mm_or_si128(_mm_and_si128(laneMask, pixels), _mm_andnot_si128(laneMask, color));
+    _mm_storel_epi64((__m128i*)colorRow0, color);
+    _mm_storel_epi64((__m128i*)colorRow1, _mm_srli_si128(color, 8));
+
+    if (!state.depthWrite)
+        return;
+    depth = selectLanes(depthMask, z, depth);
+    _mm_storel_pi((__m64*)depthRow0, depth);
+    _mm_storeh_pi((__m64*)depthRow1, depth);
+}
+
+template<uint32_t N, BlendMode B>
+void shadeQuad(SetupTriangle& setup, uint32_t x, uint32_t y, uint32_t mask, DrawState& state, Frame& framebuffer, GPUCounters& counters)
+{
+    counters.coveredFragments += countLanes(mask);
+
+    __m128 px = _mm_add_ps(_mm_cvtepi32_ps(_mm_setr_epi32(x, x + 1, x, x + 1)), _mm_set1_ps(0.5f));
+    __m128 py = _mm_add_ps(_mm_cvtepi32_ps(_mm_setr_epi32(y, y, y + 1, y + 1)), _mm_set1_ps(0.5f));
+    __m128 dx = _mm_sub_ps(px, _mm_set1_ps(setup.x0));
+    __m128 dy = _mm_sub_ps(py, _mm_set1_ps(setup.y0));
+    __m128 z = evaluatePlaneQuad(setup.depth, dx, dy);
+
+    // Ctverice nikdy nepresahuje dlazdici framebufferu, druhy radek je o rowPitch dal
+    size_t pixelIndex = getPixelIndex(framebuffer, x, y);
+    uint32_t rowPitch = framebuffer.tiled ? frameTileSize : framebuffer.width;
+    float* depthRow0 = framebuffer.depth + pixelIndex;
+    float* depthRow1 = depthRow0 + rowPitch;
+    __m128 depth = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (__m64*)depthRow0), (__m64*)depthRow1);
+    uint32_t depthPass = 0xf;
+    if (state.depthTest)
+        depthPass = _mm_movemask_ps(state.depthEqual ? _mm_cmpeq_ps(z, depth) : _mm_cmplt_ps(z, depth));
+
+    if (state.earlyDepthTest && state.depthTest)
+    {
+        counters.earlyDepthKilled += countLanes(mask & ~depthPass);
+        mask &= depthPass;
+        if (!mask)
+            return;
+    }
+
+    // Interpolace vsech pruhu najednou, shader se pak vola pro kazdy pixel zvlast
+    InFragment inFragments[quadLanes];
+    alignas(16) float values[3][quadLanes];
+    _mm_store_ps(values[0], px);
+    _mm_store_ps(values[1], py);
+    _mm_store_ps(values[2], z);
+    for (uint32_t l = 0; l < quadLanes; l++)
+        inFragments[l].gl_FragCoord = glm::vec4(values[0][l], values[1][l], values[2][l], inFragments[l].gl_FragCoord.w);
+
+    __m128 w = _mm_div_ps(_mm_set1_ps(1.0f), evaluatePlaneQuad(setup.inverseW, dx, dy));
+    InterpolationLayout& layout = state.layout;
+    for (uint32_t c = 0; c < getNofComponents<N>(layout); c++)
+    {
+        ComponentTarget& target = layout.components[c];
+        _mm_store_ps(values[0], _mm_mul_ps(evaluatePlaneQuad(setup.attributePlanes[c], dx, dy), w));
+        for (uint32_t l = 0; l < quadLanes; l++)
+            inFragments[l].attributes[target.attribute].v4[target.component] = values[0][l];
+
+        // Pruhy mimo trojuhelnik se interpoluji take, derivace jsou tak platne i na jeho okraji
+        if (layout.derivatives)
+        {
+            for (uint32_t l = 0; l < quadLanes; l++)
+            {
+                uint32_t row = l & 2;
+                uint32_t column = l & 1;
+                inFragments[l].dFdx[target.attribute][target.component] = values[0][row + 1] - values[0][row];
+                inFragments[l].dFdy[target.attribute][target.component] = values[0][column + 2] - values[0][column];
+            }
+        }
+    }
+
+    for (uint32_t f = 0; f < layout.nofFlatAttributes; f++)
+    {
+        for (uint32_t l = 0; l < quadLanes; l++)
+            inFragments[l].attributes[layout.flatAttributes[f]].u4 = setup.flatAttributes[f].u4;
+    }
+
+    OutFragment outFragments[quadLanes];
+    for (uint32_t l = 0; l < quadLanes; l++)
+    {
+        if ((mask >> l) & 1)
+        {
+            state.prg.fragmentShader(outFragments[l], inFragments[l], state.shaderInterface);
+            counters.shadedFragments++;
+        }
+    }
+
+    mask &= depthPass;
+    if (!mask)
+        return;
+
+    alignas(16) float channels[4][quadLanes];
+    for (uint32_t l = 0; l < quadLanes; l++)
+        for (uint32_t c = 0; c < 4; c++)
+            channels[c][l] = outFragments[l].gl_FragColor[c];
+
+    __m128 colors[4];
+    for (uint32_t c = 0; c < 4; c++)
+        colors[c] = _mm_load_ps(channels[c]);
+
+    uint8_t* colorRow0 = framebuffer.color + pixelIndex*4;
+    uint8_t* colorRow1 = colorRow0 + rowPitch*4;
+    setColorQuad<B>(z, depth, colors, mask, state, depthRow0, depthRow1, colorRow0, colorRow1);
+
+    if (state.gbufferOutput)
+    {
+        for (uint32_t l = 0; l < quadLanes; l++)
+            if ((mask >> l) & 1)
+                writeGBuffer(framebuffer, pixelIndex + (l >> 1)*rowPitch + (l & 1), outFragments[l]);
+    }
+}
+
+template<uint32_t N, BlendMode B>
+void rasterizeRectangleQuads(SetupTriangle& setup, PixelRectangle& rect, TileCoverage coverage, DrawState& state, Frame& framebuffer, GPUCounters& counters)
+{
+    // Ctverice zacinaji na sudych souradnicich, pixely mimo obdelnik se maskuji
+    uint32_t xmin = rect.xmin & ~1u;
+    uint32_t ymin = rect.ymin & ~1u;
+
+    // Dva 64bitove pruhy na radek ctverice, pro kazdou hranu dva registry
+    __m128i rowEdges[3][2];
+    __m128i stepX[3];
+    __m128i stepY[3];
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        int64_t e = evaluateEdgeFunction(setup.edges[i], xmin, ymin);
+        int64_t a = setup.edges[i].a*subPixelScale;
+        int64_t b = setup.edges[i].b*subPixelScale;
+        rowEdges[i][0] = _mm_set_epi64x(e + a, e);
+        rowEdges[i][1] = _mm_set_epi64x(e + a + b, e + b);
+        stepX[i] = _mm_set1_epi64x(2*a);
+        stepY[i] = _mm_set1_epi64x(2*b);
+    }
+
+    for (uint32_t y = ymin; y <= rect.ymax; y += 2)
+    {
+        __m128i edges[3][2];
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            edges[i][0] = rowEdges[i][0];
+            edges[i][1] = rowEdges[i][1];
+        }
+        uint32_t rowMask = (y >= rect.ymin ? 0x3 : 0) | (y + 1 <= rect.ymax ? 0xc : 0);
+
+        for (uint32_t x = xmin; x <= rect.xmax; x += 2)
+        {
+            uint32_t mask = rowMask & ((x >= rect.xmin ? 0x5 : 0) | (x + 1 <= rect.xmax ? 0xa : 0));
+            if (coverage != TileCoverage::INSIDE)
+            {
+                // Znamenkove bity 64bitovych pruhu oznacuji pixely mimo trojuhelnik
+                __m128i row0 = _mm_or_si128(_mm_or_si128(edges[0][0], edges[1][0]), edges[2][0]);
+                __m128i row1 = _mm_or_si128(_mm_or_si128(edges[0][1], edges[1][1]), edges[2][1]);
+                uint32_t outside = _mm_movemask_pd(_mm_castsi128_pd(row0)) | (_mm_movemask_pd(_mm_castsi128_pd(row1)) << 2);
+                mask &= ~outside;
+            }
+
+            if (mask)
+            {
+                // Ctverice pres okraj framebufferu (licha velikost) jde po pixelech
+                if (x + 1 < framebuffer.width && y + 1 < framebuffer.height)
+                {
+                    shadeQuad<N, B>(setup, x, y, mask, state, framebuffer, counters);
+                }
+                else
+                {
+                    for (uint32_t l = 0; l < quadLanes; l++)
+                        if ((mask >> l) & 1)
+                            shadeFragment<N, B>(setup, x + (l & 1) + 0.5f, y + (l >> 1) + 0.5f, state, framebuffer, counters);
+                }
+            }
+
+            for (uint8_t i = 0; i < 3; i++)
+            {
+                edges[i][0] = _mm_add_epi64(edges[i][0], stepX[i]);
+                edges[i][1] = _mm_add_epi64(edges[i][1], stepX[i]);
+            }
+        }
+
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            rowEdges[i][0] = _mm_add_epi64(rowEdges[i][0], stepY[i]);
+            rowEdges[i][1] = _mm_add_epi64(rowEdges[i][1], stepY[i]);
+        }
+    }
+}
+#endif
+
+template<uint32_t N, BlendMode B>
+void rasterizeTriangleInTile(SetupTriangle& setup, PixelRectangle& tile, float& tileMaxDepth, DrawState& state, Frame& framebuffer, GPUCounters& counters)
+{
+    PixelRectangle rect;
+    rect.xmin = std::max(tile.xmin, setup.box.xmin);
+    rect.xmax = std::min(tile.xmax, setup.box.xmax);
+    rect.ymin = std::max(tile.ymin, setup.box.ymin);
+    rect.ymax = std::min(tile.ymax, setup.box.ymax);
+
+    if (rect.xmin > rect.xmax || rect.ymin > rect.ymax)
+        return;
+
+    TileCoverage coverage = classifyRectangle(setup, rect);
+    if (coverage == TileCoverage::OUTSIDE)
+        return;
+
+    // Cely trojuhelnik v dlazdici je za vsim, co uz v ni je nakresleno,
+    // test na rovnost ale projde i s hloubkou rovnou odhadu
+    if (state.hierarchicalDepth && state.depthTest)
+    {
+        float minDepth = findMinimalDepth(setup, rect);
+        if (state.depthEqual ? minDepth > tileMaxDepth : minDepth >= tileMaxDepth)
+        {
+            counters.hierarchicalDepthKilled++;
+            return;
+        }
+    }
+
+#ifdef __SSE2__
+    if (gpuSettings.simdQuads && framebuffer.channels == 4)
+        rasterizeRectangleQuads<N, B>(setup, rect, coverage, state, framebuffer, counters);
+    else
+#endif
+        rasterizeRectangle<N, B>(setup, rect, coverage, state, framebuffer, counters);
+
+    // Bez depth testu muze zapis hloubku zvysit, odhad uz neplati
+    if (!state.depthTest && state.depthWrite)
+        tileMaxDepth = INFINITY;
+
+    // Zapis s depth testem hloubku jen snizuje, odhad se zpresni, kdyz trojuhelnik pokryl celou dlazdici
+    bool coversTile = rect.xmin == tile.xmin && rect.xmax == tile.xmax && rect.ymin == tile.ymin && rect.ymax == tile.ymax;
+    if (gpuSettings.hierarchicalDepth && coverage == TileCoverage::INSIDE && coversTile)
+        tileMaxDepth = findMaximalDepth(tile, framebuffer);
+}
+
+// Hloubkovy predpruchod: jen pokryti a hloubka, bez interpolace atributu a fragment shaderu
+void rasterizeDepthInTile(SetupTriangle& setup, PixelRectangle& tile, float& tileMaxDepth, Frame& framebuffer, GPUCounters& counters)
+{
+    PixelRectangle rect;
+    rect.xmin = std::max(tile.xmin, setup.box.xmin);
+    rect.xmax = std::min(tile.xmax, setup.box.xmax);
+    rect.ymin = std::max(tile.ymin, setup.box.ymin);
+    rect.ymax = std::min(tile.ymax, setup.box.ymax);
+
+    if (rect.xmin > rect.xmax || rect.ymin > rect.ymax)
+        return;
+
+    TileCoverage coverage = classifyRectangle(setup, rect);
+    if (coverage == TileCoverage::OUTSIDE)
+        return;
+
+    if (gpuSettings.hierarchicalDepth && findMinimalDepth(setup, rect) >= tileMaxDepth)
+    {
+        counters.hierarchicalDepthKilled++;
+        return;
+    }
+
+    int64_t rowEdges[3];
+    int64_t stepX[3];
+    int64_t stepY[3];
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        rowEdges[i] = evaluateEdgeFunction(setup.edges[i], rect.xmin, rect.ymin);
+        stepX[i] = setup.edges[i].a*subPixelScale;
+        stepY[i] = setup.edges[i].b*subPixelScale;
+    }
+
+    for (uint32_t y = rect.ymin; y <= rect.ymax; y++)
+    {
+        int64_t e0 = rowEdges[0];
+        int64_t e1 = rowEdges[1];
+        int64_t e2 = rowEdges[2];
+        float dy = y + 0.5f - setup.y0;
+        float* depthRow = framebuffer.depth + getPixelIndex(framebuffer, 0, y);
+
+        for (uint32_t x = rect.xmin; x <= rect.xmax; x++)
+        {
+            if (coverage == TileCoverage::INSIDE || (e0 | e1 | e2) >= 0)
+            {
+                // Hloubka se pocita stejne jako ve shadeFragment a shadeQuad, test na rovnost ji pak najde
+                float z = evaluatePlane(setup.depth, x + 0.5f - setup.x0, dy);
+                float& depth = framebuffer.tiled ? framebuffer.depth[getPixelIndex(framebuffer, x, y)] : depthRow[x];
+                if (z < depth)
+                    depth = z;
+                counters.prepassFragments++;
+            }
+
+            e0 += stepX[0];
+            e1 += stepX[1];
+            e2 += stepX[2];
+        }
+
+        rowEdges[0] += stepY[0];
+        rowEdges[1] += stepY[1];
+        rowEdges[2] += stepY[2];
+    }
+
+    bool coversTile = rect.xmin == tile.xmin && rect.xmax == tile.xmax && rect.ymin == tile.ymin && rect.ymax == tile.ymax;
+    if (gpuSettings.hierarchicalDepth && coverage == TileCoverage::INSIDE && coversTile)
+        tileMaxDepth = findMaximalDepth(tile, framebuffer);
+}
+
+// Varianty rasterizace podle poctu interpolovanych float slozek, vetsi pocty pouziji obecnou
+template<BlendMode B>
+RasterizeFunction selectComponentVariant(InterpolationLayout& layout)
+{
+    static RasterizeFunction const variants[] = {
+        rasterizeTriangleInTile<0, B>,  rasterizeTriangleInTile<1, B>,  rasterizeTriangleInTile<2, B>,
+        rasterizeTriangleInTile<3, B>,  rasterizeTriangleInTile<4, B>,  rasterizeTriangleInTile<5, B>,
+        rasterizeTriangleInTile<6, B>,  rasterizeTriangleInTile<7, B>,  rasterizeTriangleInTile<8, B>,
+        rasterizeTriangleInTile<9, B>,  rasterizeTriangleInTile<10, B>, rasterizeTriangleInTile<11, B>,
+        rasterizeTriangleInTile<12, B>, rasterizeTriangleInTile<13, B>, rasterizeTriangleInTile<14, B>,
+        rasterizeTriangleInTile<15, B>, rasterizeTriangleInTile<16, B>
+    };
+    if (layout.nofComponents < sizeof(variants)/sizeof(variants[0]))
+        return variants[layout.nofComponents];
+    return rasterizeTriangleInTile<dynamicComponents, B>;
+}
+
+typedef void (*SetupFunction)(TileBins& tileBins, Triangle& triangle, InterpolationLayout& layout, Frame& framebuffer);
+
+// Varianty sestaveni trojuhelniku, index je DrawCommand::backfaceCulling
+SetupFunction const setupVariants[2] = {setupTriangle<false>, setupTriangle<true>};
+
+// Varianta rasterizace podle blendingu kresleni (ROP) a poctu slozek
+RasterizeFunction selectRasterizeVariant(InterpolationLayout& layout, BlendMode blendMode)
+{
+    switch (blendMode)
+    {
+    case BlendMode::NONE:
+        return selectComponentVariant<BlendMode::NONE>(layout);
+    case BlendMode::ALPHA:
+        return selectComponentVariant<BlendMode::ALPHA>(layout);
+    case BlendMode::FRAGMENT_ALPHA:
+    default:
+        return selectComponentVariant<BlendMode::FRAGMENT_ALPHA>(layout);
+    }
+}
+
+PixelRectangle getTileRectangle(TileBins& tileBins, uint32_t tileIndex, Frame& framebuffer)
+{
+    PixelRectangle tile;
+    tile.xmin = (tileIndex%tileBins.tilesX)*tileSize;
+    tile.ymin = (tileIndex/tileBins.tilesX)*tileSize;
+    tile.xmax = std::min(tile.xmin + tileSize, framebuffer.width) - 1;
+    tile.ymax = std::min(tile.ymin + tileSize, framebuffer.height) - 1;
+    return tile;
+}
+
+// Vyplni count po sobe jdoucich 32bitovych hodnot vzorem
+void fillPattern(uint8_t* target, uint32_t pattern, size_t count)
+{
+    uint8_t* end = target + 4*count;
+#ifdef __SSE2__
+    __m128i patterns = _mm_set1_epi32((int32_t)pattern);
+    for (; end - target >= 16; target += 16)
+        _mm_storeu_si128((__m128i*)target, patterns);
+#endif
+    for (; target < end; target += 4)
+        memcpy(target, &pattern, 4);
+}
+
+// Vyplni dlazdici bufferu se 4 bajty na pixel vzorem
+void fillTile(uint8_t* buffer, uint32_t pattern, PixelRectangle& tile, Frame& framebuffer)
+{
+    // Dlazdice framebufferu je souvisla vcetne zarovnani, radky jsou v ni po frameTileSize pixelech
+    if (framebuffer.tiled)
+    {
+        fillPattern(buffer + 4*getPixelIndex(framebuffer, tile.xmin, tile.ymin), pattern, frameTileSize*frameTileSize);
+        return;
+    }
+
+    for (uint32_t y = tile.ymin; y <= tile.ymax; y++)
+        fillPattern(buffer + 4*getPixelIndex(framebuffer, tile.xmin, y), pattern, tile.xmax - tile.xmin + 1);
+}
+
+void resolveTileClear(TileBins& tileBins, uint32_t tileIndex, Frame& framebuffer)
+{
+    uint8_t pending = tileBins.pendingClears[tileIndex];
+    if (pending == 0)
+        return;
+    tileBins.pendingClears[tileIndex] = 0;
+
+    PixelRectangle tile = getTileRectangle(tileBins, tileIndex, framebuffer);
+    if (pending & clearColorBit)
+    {
+        if (framebuffer.channels == 4)
+        {
+            fillTile(framebuffer.color, tileBins.clearColor, tile, framebuffer);
+        }
+        else
+        {
+            // Vzor ma 4 bajty, pixel dostane jen tolik, kolik ma kanalu
+            uint32_t channels = std::min(framebuffer.channels, 4u);
+            for (uint32_t y = tile.ymin; y <= tile.ymax; y++)
+                for (uint32_t x = tile.xmin; x <= tile.xmax; x++)
+                    memcpy(framebuffer.color + getPixelIndex(framebuffer, x, y)*framebuffer.channels, &tileBins.clearColor, channels);
+        }
+
+        // G-buffer patri k barve, smazany pixel nema geometrii
+        if (framebuffer.normal)
+            fillTile((uint8_t*)framebuffer.normal, 0, tile, framebuffer);
+    }
+    if (pending & clearDepthBit)
+        fillTile((uint8_t*)framebuffer.depth, tileBins.clearDepth, tile, framebuffer);
+}
+
+void resolveClears(TileBins& tileBins, Frame& framebuffer)
+{
+    threadPool.parallelFor(tileBins.bins.size(), [&](uint32_t tileIndex, uint32_t)
+    {
+        resolveTileClear(tileBins, tileIndex, framebuffer);
+    });
+}
+
+void rasterizeTile(TileBins& tileBins, uint32_t tileIndex, Frame& framebuffer, GPUCounters& counters)
+{
+    // Dlazdice bez trojuhelniku si mazani ponecha na pozdeji
+    if (tileBins.bins[tileIndex].empty())
+        return;
+    resolveTileClear(tileBins, tileIndex, framebuffer);
+
+    PixelRectangle tile = getTileRectangle(tileBins, tileIndex, framebuffer);
+    float& tileMaxDepth = tileBins.tileMaxDepth[tileIndex];
+
+    // Nejdrive se zapise konecna hloubka nepruhlednych kresleni, kazdy pixel se pak obarvi jednou
+    if (tileBins.depthPrepass)
+    {
+        for (uint32_t triangleIndex : tileBins.bins[tileIndex])
+        {
+            if (tileBins.draws[tileBins.triangleDraws[triangleIndex]].prepass)
+                rasterizeDepthInTile(tileBins.triangles[triangleIndex], tile, tileMaxDepth, framebuffer, counters);
+        }
+    }
+
+    // Trojuhelniky v dlazdici jsou v poradi, v jakem byly vykresleny
+    for (uint32_t triangleIndex : tileBins.bins[tileIndex])
+    {
+        DrawState& state = tileBins.draws[tileBins.triangleDraws[triangleIndex]];
+        state.rasterize(tileBins.triangles[triangleIndex], tile, tileMaxDepth, state, framebuffer, counters);
+    }
+}
+
+void flushTiles(TileBins& tileBins, Frame& framebuffer, bool serial)
+{
+    if (tileBins.triangles.empty())
+        return;
+
+    // Kazdou dlazdici zpracuje prave jedno vlakno -> depth test a blending bez zamku
+    runJobs(tileBins.bins.size(), serial, [&](uint32_t tileIndex, uint32_t worker)
+    {
+        rasterizeTile(tileBins, tileIndex, framebuffer, tileBins.workerCounters[worker]);
+    });
+
+    collectCounters(tileBins);
+    clearTileBins(tileBins);
+}
+
+void clear(TileBins& tileBins, ClearCommand& clearcmd, Frame& framebuffer)
+{
+    // Predchozi kresleni musi skoncit pred mazanim
+    flushTiles(tileBins, framebuffer, false);
+
+    // Barva se prevede jednou, dlazdice se jen oznaci a smazou se az pri prvnim pouziti
+    uint8_t bits = 0;
+    if (clearcmd.clearColor)
+    {
+        uint8_t color[4];
+        color[0] = (uint8_t)(clearcmd.color.r*255.0);
+        color[1] = (uint8_t)(clearcmd.color.g*255.0);
+        color[2] = (uint8_t)(clearcmd.color.b*255.0);
+        color[3] = (uint8_t)(clearcmd.color.a*255.0);
+        memcpy(&tileBins.clearColor, color, 4);
+        bits |= clearColorBit;
+    }
+    if (clearcmd.clearDepth)
+    {
+        memcpy(&tileBins.clearDepth, &clearcmd.depth, 4);
+        bits |= clearDepthBit;
+    }
+    if (bits == 0)
+        return;
+
+    float tileMaxDepth = std::isnan(clearcmd.depth) ? INFINITY : clearcmd.depth;
+    for (uint32_t tileIndex = 0; tileIndex < tileBins.bins.size(); tileIndex++)
+    {
+        tileBins.pendingClears[tileIndex] |= bits;
+        if (clearcmd.clearDepth)
+            tileBins.tileMaxDepth[tileIndex] = tileMaxDepth;
+    }
+    if (!gpuSettings.lazyClears)
+        resolveClears(tileBins, framebuffer);
+}
+
+// Osvetleni jednoho pixelu g-bufferu
+void lightPixel(Program& prg, ShaderInterface& shaderInterface, uint32_t x, uint32_t y, size_t pixelIndex, Frame& framebuffer)
+{
+    uint8_t* color = framebuffer.color + pixelIndex*framebuffer.channels;
+    InFragment inFragment;
+    inFragment.gl_FragCoord = glm::vec4(x + 0.5f, y + 0.5f, framebuffer.depth[pixelIndex], 1.0f);
+    for (uint32_t c = 0; c < framebuffer.channels; c++)
+        inFragment.attributes[0].v4[c] = color[c]/255.0f;
+    inFragment.attributes[1].v3 = decodeGBufferNormal(framebuffer.normal[pixelIndex]);
+    inFragment.attributes[2].v3 = framebuffer.position[pixelIndex];
+
+    OutFragment outFragment;
+    prg.fragmentShader(outFragment, inFragment, shaderInterface);
+    for (uint32_t c = 0; c < framebuffer.channels; c++)
+        color[c] = toFixedPoint(outFragment.gl_FragColor[c]);
+}
+
+// Osvetleni jednoho radku g-bufferu, pixely bez geometrie si ponechaji barvu
+void lightRow(Program& prg, ShaderInterface& shaderInterface, uint32_t y, Frame& framebuffer, GPUCounters& counters)
+{
+    // Radek je souvisly po celych radcich dlazdic (tiled) nebo cely
+    uint32_t span = framebuffer.tiled ? frameTileSize : framebuffer.width;
+    for (uint32_t x0 = 0; x0 < framebuffer.width; x0 += span)
+    {
+        size_t base = getPixelIndex(framebuffer, x0, y);
+        uint32_t const* normals = framebuffer.normal + base;
+        uint32_t count = std::min(span, framebuffer.width - x0);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (normals[i] == 0)
+                continue;
+            lightPixel(prg, shaderInterface, x0 + i, y, base + i, framebuffer);
+            counters.lightingInvocations++;
+        }
+    }
+}
+
+void light(TileBins& tileBins, GPUMemory& mem, LightingCommand& lightcmd)
+{
+    // G-buffer musi obsahovat vsechna predchozi kresleni a mazani
+    flushTiles(tileBins, mem.framebuffer, false);
+    resolveClears(tileBins, mem.framebuffer);
+    if (!mem.framebuffer.normal)
+        return;
+
+    Program& prg = mem.programs[lightcmd.programID];
+    ShaderInterface shaderInterface;
+    getTexturesAndUniforms(shaderInterface, mem);
+
+    // Cena osvetleni nezavisi na prekryvani, kazdy pixel se osvetli jednou
+    threadPool.parallelFor(mem.framebuffer.height, [&](uint32_t y, uint32_t worker)
+    {
+        lightRow(prg, shaderInterface, y, mem.framebuffer, tileBins.workerCounters[worker]);
+    });
+    collectCounters(tileBins);
+}
+
+// Clip kod vrcholu vuci rovinam x = +-guardX*w, y = +-guardY*w a blizke rovine z = -w
+uint8_t computeClipCode(glm::vec4& position, float guardX, float guardY)
+{
+    uint8_t code = 0;
+    if (position.x < -guardX*position.w)
+        code |= clipLeft;
+    if (position.x > guardX*position.w)
+        code |= clipRight;
+    if (position.y < -guardY*position.w)
+        code |= clipBottom;
+    if (position.y > guardY*position.w)
+        code |= clipTop;
+    if (position.z < -position.w)
+        code |= clipNear;
+    return code;
+}
+
+// Guard band v normalizovanych souradnicich, po viewport transformaci je |x|, |y| <= guardBandCoordinate
+glm::vec2 computeGuardBand(Frame& framebuffer)
+{
+    return glm::vec2(2.0f*guardBandCoordinate/framebuffer.width - 1.0f,
+                     2.0f*guardBandCoordinate/framebuffer.height - 1.0f);
+}
+
+void interpolateClippedVertex(OutVertex& result, OutVertex& a, OutVertex& b, float t, InterpolationLayout& layout)
+{
+    result.gl_Position = a.gl_Position + (b.gl_Position - a.gl_Position)*t;
+    for (uint32_t c = 0; c < layout.nofComponents; c++)
+    {
+        ComponentTarget& target = layout.components[c];
+        float qa = a.attributes[target.attribute].v4[target.component];
+        float qb = b.attributes[target.attribute].v4[target.component];
+        result.attributes[target.attribute].v4[target.component] = qa + (qb - qa)*t;
+    }
+}
+
+// Sutherland-Hodgman, vnitrek roviny je dot(plane, gl_Position) >= 0
+uint32_t clipPolygon(OutVertex* output, OutVertex* input, uint32_t nofInput, glm::vec4 plane, InterpolationLayout& layout)
+{
+    uint32_t nofOutput = 0;
+    for (uint32_t i = 0; i < nofInput; i++)
+    {
+        OutVertex& a = input[i];
+        OutVertex& b = input[(i + 1)%nofInput];
+        float da = glm::dot(plane, a.gl_Position);
+        float db = glm::dot(plane, b.gl_Position);
+
+        if (da >= 0)
+            output[nofOutput++] = a;
+
+        // Hrana protina rovinu
+        if ((da >= 0) != (db >= 0))
+            interpolateClippedVertex(output[nofOutput++], a, b, da/(da - db), layout);
+    }
+    return nofOutput;
+}
+
+void submitTriangle(TileBins& tileBins, Triangle& triangle, InterpolationLayout& layout, SetupFunction setupFunction, Frame& framebuffer)
+{
+    // Primitive assembly
+    runPerspectiveDivision(triangle);
+    runViewportTransformation(triangle, framebuffer);
+    setupFunction(tileBins, triangle, layout, framebuffer);
+}
+
+void clipTriangle(TileBins& tileBins, Triangle& triangle, InterpolationLayout& layout, SetupFunction setupFunction, glm::vec2 guardBand, Frame& framebuffer)
+{
+    // Trojuhelnik cely mimo jednu rovinu zorneho jehlanu se zahodi
+    uint8_t viewCodes[3];
+    uint8_t guardCodes[3];
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        viewCodes[i] = computeClipCode(triangle.vertices[i].gl_Position, 1.0f, 1.0f);
+        guardCodes[i] = computeClipCode(triangle.vertices[i].gl_Position, guardBand.x, guardBand.y);
+    }
+    if (viewCodes[0] & viewCodes[1] & viewCodes[2])
+    {
+        gpuCounters.clipRejectedTriangles++;
+        return;
+    }
+
+    // Vetsina trojuhelniku lezi v guard bandu a pred blizkou rovinou
+    uint8_t clipCodes = guardCodes[0] | guardCodes[1] | guardCodes[2];
+    if (clipCodes == 0)
+    {
+        submitTriangle(tileBins, triangle, layout, setupFunction, framebuffer);
+        return;
+    }
+    gpuCounters.clippedTriangles++;
+
+    glm::vec4 planes[5] = {
+        glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+        glm::vec4(1.0f, 0.0f, 0.0f, guardBand.x),
+        glm::vec4(-1.0f, 0.0f, 0.0f, guardBand.x),
+        glm::vec4(0.0f, 1.0f, 0.0f, guardBand.y),
+        glm::vec4(0.0f, -1.0f, 0.0f, guardBand.y)
+    };
+    uint8_t planeCodes[5] = {clipNear, clipLeft, clipRight, clipBottom, clipTop};
+
+    OutVertex polygons[2][maxClippedVertices];
+    uint32_t nofVertices = 3;
+    uint32_t current = 0;
+    for (uint8_t i = 0; i < 3; i++)
+        polygons[current][i] = triangle.vertices[i];
+
+    for (uint8_t p = 0; p < 5 && nofVertices >= 3; p++)
+    {
+        if (!(clipCodes & planeCodes[p]))
+            continue;
+        nofVertices = clipPolygon(polygons[1 - current], polygons[current], nofVertices, planes[p], layout);
+        current = 1 - current;
+    }
+
+    // Vejir trojuhelniku zachova orientaci, celociselne atributy se berou z puvodniho vrcholu 0
+    for (uint32_t i = 1; i + 1 < nofVertices; i++)
+    {
+        Triangle clipped;
+        clipped.vertices[0] = polygons[current][0];
+        clipped.vertices[1] = polygons[current][i];
+        clipped.vertices[2] = polygons[current][i + 1];
+        for (uint32_t f = 0; f < layout.nofFlatAttributes; f++)
+            clipped.vertices[0].attributes[layout.flatAttributes[f]] = triangle.vertices[0].attributes[layout.flatAttributes[f]];
+
+        submitTriangle(tileBins, clipped, layout, setupFunction, framebuffer);
+    }
+}
+
+void draw(GPUMemory& mem, DrawCommand& drawcmd, uint32_t drawNum, TileBins& tileBins, VertexBuffers& vertexBuffers)
+{
+    DrawState state;
+    state.prg = mem.programs[drawcmd.programID];
+    getTexturesAndUniforms(state.shaderInterface, mem);
+
+    // Varianta pipeline se vybere jednou, ve smycce pres fragmenty uz se nevetvi podle typu
+    compileInterpolationLayout(state.layout, state.prg);
+    state.rasterize = selectRasterizeVariant(state.layout, drawcmd.blendMode);
+    state.depthTest = drawcmd.depthTest;
+    state.depthWrite = drawcmd.depthWrite;
+    state.earlyDepthTest = gpuSettings.earlyDepthTest && !state.prg.sideEffects;
+    state.hierarchicalDepth = gpuSettings.hierarchicalDepth && !state.prg.sideEffects;
+
+    // Predpruchod jen pro nepruhledna kresleni, ktera hloubku testuji i zapisuji
+    state.gbufferOutput = state.prg.gbufferOutput && mem.framebuffer.normal != nullptr;
+    state.prepass = tileBins.depthPrepass && drawcmd.blendMode == BlendMode::NONE && drawcmd.depthTest && drawcmd.depthWrite;
+    state.depthEqual = state.prepass;
+    if (state.prepass)
+        state.depthWrite = false;
+    SetupFunction setupFunction = setupVariants[drawcmd.backfaceCulling ? 1 : 0];
+    tileBins.draws.push_back(state);
+
+    // Shader s vedlejsimi efekty muze cist framebuffer, predchozi kresleni a mazani se dokonci
+    if (state.prg.sideEffects)
+    {
+        flushTiles(tileBins, mem.framebuffer, false);
+        resolveClears(tileBins, mem.framebuffer);
+    }
+
+    // Vertex shader probehne pro vsechny vrcholy kresleni pred sestavenim trojuhelniku
+    uint32_t nofTriangles = drawcmd.nofVertices/3;
+    collectVertices(vertexBuffers, mem, drawcmd, state.prg, 3*nofTriangles);
+    shadeVertices(vertexBuffers, mem, drawcmd, state.prg, drawNum);
+
+    // Sestaveni trojuhelniku, orezani a jejich rozrazeni do dlazdic
+    glm::vec2 guardBand = gpuSettings.guardBand ? computeGuardBand(mem.framebuffer) : glm::vec2(1.0f);
+    for (uint32_t i = 0; i < nofTriangles; i++)
+    {
+        Triangle triangle;
+        loadTriangle(triangle, vertexBuffers, state.prg, i);
+        clipTriangle(tileBins, triangle, state.layout, setupFunction, guardBand, mem.framebuffer);
+    }
+
+    // Fragment shader s vedlejsimi efekty bezi v jednom vlakne
+    if (state.prg.sideEffects)
+        flushTiles(tileBins, mem.framebuffer, true);
+}
+
+//! [gpu_execute]
+void gpu_execute(GPUMemory&mem,CommandBuffer &cb){
+  /// \todo Tato funkce reprezentuje funkcionalitu grafické karty.<br>
+  /// Měla by umět zpracovat command buffer, čistit framebuffer a kresli.<br>
+  /// mem obsahuje paměť grafické karty.
+  /// cb obsahuje command buffer pro zpracování.
+  /// Bližší informace jsou uvedeny na hlavní stránce dokumentace.
+
+    threadPool.resize(gpuSettings.nofThreads);
+    TileBins tileBins;
+    initTileBins(tileBins, mem.framebuffer);
+    tileBins.depthPrepass = cb.depthPrepass;
+    VertexBuffers vertexBuffers;
+
+    // Kresleni se rozradi do dlazdic a rasterizuje az pred dalsim CLEAR, LIGHTING nebo na konci
+    uint32_t drawNumber = 0;
+    for (uint32_t i = 0; i < cb.nofCommands; i++)
+    {
+        if (cb.commands[i].type == CommandType::CLEAR)
+        {
+            clear(tileBins, cb.commands[i].data.clearCommand, mem.framebuffer);
+        }
+        else if (cb.commands[i].type == CommandType::DRAW)
+        {
+            draw(mem, cb.commands[i].data.drawCommand, drawNumber, tileBins, vertexBuffers);
+            drawNumber++;
+        }
+        else if (cb.commands[i].type == CommandType::LIGHTING)
+        {
+            light(tileBins, mem, cb.commands[i].data.lightingCommand);
+        }
+    }
+    flushTiles(tileBins, mem.framebuffer, false);
+    resolveClears(tileBins, mem.framebuffer);
+
+}
+//! [gpu_execute]
+
+/**
+ * @brief This function reads one texel of texture.
+ * Texture without mip levels has only level 0 in its original layout.
+ *
+ * @param texture texture
+ * @param level mip level
+ * @param x x coordinate of texel
+ * @param y y coordinate of texel
+ *
+ * @return color 4 floats, missing channels are 0 and missing alpha is 1
+ */
+glm::vec4 fetchTexel(Texture const&texture,uint32_t level,uint32_t x,uint32_t y){
+  if(texture.levels){
+    auto const&l = texture.levels[level];
+    auto const*t = l.data+getTexelIndex(l,x,y)*4;
+    return glm::vec4(t[0],t[1],t[2],t[3])/255.f;
+  }
+  glm::vec4 color = glm::vec4(0.f,0.f,0.f,1.f);
+  for(uint32_t c=0;c<texture.channels;++c)
+    color[c] = texture.data[((size_t)y*texture.width+x)*texture.channels+c]/255.f;
+  return color;
+}
+
+/**
+ * @brief This function encodes normal for g-buffer using octahedral mapping.
+ *
+ * @param normal normal
+ *
+ * @return 2 x 15 bits of octahedral coordinates, the highest bit is always set
+ */
+uint32_t encodeGBufferNormal(glm::vec3 const&normal){
+  auto const l1 = std::abs(normal.x)+std::abs(normal.y)+std::abs(normal.z);
+  // zero or NaN normal is stored as +z
+  auto p = l1 > 0.f ? glm::vec2(normal)/l1 : glm::vec2(0.f);
+  if(normal.z < 0.f)
+    p = (1.f-glm::abs(glm::vec2(p.y,p.x)))*glm::vec2(p.x >= 0.f ? 1.f : -1.f,p.y >= 0.f ? 1.f : -1.f);
+  auto const q = glm::uvec2(glm::clamp(p*.5f+.5f,0.f,1.f)*32767.f+.5f);
+  return 0x80000000u | q.y << 15 | q.x;
+}
+
+/**
+ * @brief This function decodes normal encoded by encodeGBufferNormal.
+ *
+ * @param normal encoded normal
+ *
+ * @return normalized normal
+ */
+glm::vec3 decodeGBufferNormal(uint32_t normal){
+  auto const p = glm::vec2(normal&0x7fff,(normal>>15)&0x7fff)/32767.f*2.f-1.f;
+  auto n = glm::vec3(p,1.f-std::abs(p.x)-std::abs(p.y));
+  if(n.z < 0.f){
+    n.x = (1.f-std::abs(p.y))*(p.x >= 0.f ? 1.f : -1.f);
+    n.y = (1.f-std::abs(p.x))*(p.y >= 0.f ? 1.f : -1.f);
+  }
+  return glm::normalize(n);
+}
+
+/**
+ * @brief This function reads color from texture.
+ *
+ * @param texture texture
  * @param uv uv coordinates
  *
  * @return color 4 floats
  */
 glm::vec4 read_texture(Texture const&texture,glm::vec2 uv){
-  if(!texture.data)return glm::vec4(0.f);
+  if(!texture.data && !texture.levels)return glm::vec4(0.f);
   auto uv1 = glm::fract(uv);
   auto uv2 = uv1*glm::vec2(texture.width-1,texture.height-1)+0.5f;
   auto pix = glm::uvec2(uv2);
   //auto t   = glm::fract(uv2);
-  glm::vec4 color = glm::vec4(0.f,0.f,0.f,1.f);
-  for(uint32_t c=0;c<texture.channels;++c)
-    color[c] = texture.data[(pix.y*texture.width+pix.x)*texture.channels+c]/255.f;
-  return color;
+  return fetchTexel(texture,0,pix.x,pix.y);
+}
+
+/**
+ * @brief This function returns size of texture level.
+ *
+ * @param texture texture
+ * @param level mip level, texture without mip levels has only level 0
+ *
+ * @return size in texels
+ */
+glm::uvec2 getLevelSize(Texture const&texture,uint32_t level){
+  if(!texture.levels)return glm::uvec2(texture.width,texture.height);
+  return glm::uvec2(texture.levels[level].width,texture.levels[level].height);
+}
+
+#ifdef __SSE2__
+/**
+ * @brief This function reads one texel of prepared texture level into SSE register.
+ * It computes the same values as fetchTexel.
+ */
+__m128 loadTexel(TextureLevel const&level,uint32_t x,uint32_t y){
+  uint32_t texel;
+  memcpy(&texel,level.data+getTexelIndex(level,x,y)*4,4);
+  auto const zero  = _mm_setzero_si128();
+  auto const bytes = _mm_cvtsi32_si128((int32_t)texel);
+  auto const ints  = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes,zero),zero);
+  return _mm_div_ps(_mm_cvtepi32_ps(ints),_mm_set1_ps(255.f));
+}
+
+/**
+ * @brief This function interpolates texels in the same way as glm::mix.
+ */
+__m128 mixTexels(__m128 a,__m128 b,float t){
+  return _mm_add_ps(_mm_mul_ps(a,_mm_set1_ps(1.f-t)),_mm_mul_ps(b,_mm_set1_ps(t)));
+}
+#endif
+
+/**
+ * @brief This function reads color from one level with bilinear filtering.
+ *
+ * @param texture texture
+ * @param uv uv coordinates
+ * @param level mip level
+ *
+ * @return color 4 floats
+ */
+glm::vec4 read_textureLevel(Texture const&texture,glm::vec2 uv,uint32_t level){
+  auto const size = getLevelSize(texture,level);
+  auto const st   = glm::fract(uv)*glm::vec2(size)-.5f;
+  // clamping also removes NaN
+  auto const x = std::min(std::max(std::floor(st.x),-1.f),(float)size.x-1.f);
+  auto const y = std::min(std::max(std::floor(st.y),-1.f),(float)size.y-1.f);
+  auto const t = st-glm::vec2(x,y);
+  // texture repeats
+  uint32_t const x0 = x < 0.f ? size.x-1 : (uint32_t)x;
+  uint32_t const y0 = y < 0.f ? size.y-1 : (uint32_t)y;
+  uint32_t const x1 = x0+1 == size.x ? 0 : x0+1;
+  uint32_t const y1 = y0+1 == size.y ? 0 : y0+1;
+#ifdef __SSE2__
+  if(texture.levels){
+    auto const&l = texture.levels[level];
+    auto const bottom = mixTexels(loadTexel(l,x0,y0),loadTexel(l,x1,y0),t.x);
+    auto const top    = mixTexels(loadTexel(l,x0,y1),loadTexel(l,x1,y1),t.x);
+    glm::vec4 color;
+    _mm_storeu_ps(&color[0],mixTexels(bottom,top,t.y));
+    return color;
+  }
+#endif
+  auto const bottom = glm::mix(fetchTexel(texture,level,x0,y0),fetchTexel(texture,level,x1,y0),t.x);
+  auto const top    = glm::mix(fetchTexel(texture,level,x0,y1),fetchTexel(texture,level,x1,y1),t.x);
+  return glm::mix(bottom,top,t.y);
+}
+
+glm::vec4 read_textureBilinear(Texture const&texture,glm::vec2 uv){
+  if(!texture.data && !texture.levels)return glm::vec4(0.f);
+  return read_textureLevel(texture,uv,0);
+}
+
+glm::vec4 read_textureLod(Texture const&texture,glm::vec2 uv,float lod){
+  if(!texture.data && !texture.levels)return glm::vec4(0.f);
+  uint32_t const nofLevels = texture.levels ? texture.nofLevels : 1;
+  // magnification and NaN use level 0
+  if(!(lod > 0.f))lod = 0.f;
+  lod = std::min(lod,(float)(nofLevels-1));
+  auto const level = (uint32_t)lod;
+  auto const t     = lod-(float)level;
+  if(t == 0.f)return read_textureLevel(texture,uv,level);
+  return glm::mix(read_textureLevel(texture,uv,level),read_textureLevel(texture,uv,level+1),t);
+}
+
+float texture_lod(Texture const&texture,glm::vec2 dUVdx,glm::vec2 dUVdy){
+  auto const size = glm::vec2(getLevelSize(texture,0));
+  auto const dx   = dUVdx*size;
+  auto const dy   = dUVdy*size;
+  auto const rho2 = std::max(glm::dot(dx,dx),glm::dot(dy,dy));
+  return .5f*std::log2(rho2);
+}
+
+glm::vec4 read_textureGrad(Texture const&texture,glm::vec2 uv,glm::vec2 dUVdx,glm::vec2 dUVdy){
+  return read_textureLod(texture,uv,texture_lod(texture,dUVdx,dUVdy));
 }
 
@@ -8,6 +8,58 @@
 
 #include <student/fwd.hpp>
 
+/**
+ * @brief This struct holds settings of the gpu implementation.
+ * Settings do not change the rendered image, only the way it is computed.
+ * Draws of programs with side effects (Program::sideEffects) do not use early depth test, hierarchical depth, vertex cache, lazy clears and threads.
+ */
+struct GPUSettings{
+  uint32_t nofThreads        = 1   ; ///< number of rendering threads, 0 selects all cores
+  bool     earlyDepthTest    = true; ///< depth test runs before the fragment shader
+  bool     hierarchicalDepth = true; ///< per tile max depth rejects whole tiles of a triangle
+  bool     simdQuads         = true; ///< fragments are processed in 2x2 quads with SSE2, false selects the scalar path
+  bool     vertexCache       = true; ///< indexed draws reuse transformed vertices with the same gl_VertexID
+  bool     lazyClears        = true; ///< clear of a tile is postponed until a triangle touches it or until the end of gpu_execute
+  bool     guardBand         = true; ///< triangles inside guard band around the viewport are not clipped, false clips them against the viewport
+};
+
+/**
+ * @brief This struct holds statistics of the rasterization.
+ * Counters are accumulated by every gpu_execute until gpu_resetCounters is called.
+ */
+struct GPUCounters{
+  uint64_t coveredFragments        = 0; ///< fragments that passed the coverage test
+  uint64_t shadedFragments         = 0; ///< fragment shader invocations
+  uint64_t earlyDepthKilled        = 0; ///< fragments rejected by the early depth test
+  uint64_t hierarchicalDepthKilled = 0; ///< triangle tiles rejected by the hierarchical depth
+  uint64_t vertexShaderInvocations = 0; ///< vertex shader invocations
+  uint64_t vertexCacheLookups      = 0; ///< vertices of indexed draws looked up in the vertex cache (draws with too spread ids skip it)
+  uint64_t vertexCacheHits         = 0; ///< vertices reused from the vertex cache
+  uint64_t clipRejectedTriangles   = 0; ///< triangles rejected because they lie outside one plane of the view volume
+  uint64_t clippedTriangles        = 0; ///< triangles clipped by the near plane or by the guard band
+  uint64_t prepassFragments        = 0; ///< fragments written by the depth prepass, see CommandBuffer::depthPrepass
+  uint64_t lightingInvocations     = 0; ///< fragment shader invocations of lighting commands (deferred shading)
+};
+
+/**
+ * @brief This function returns settings of the gpu.
+ *
+ * @return gpu settings, they are applied by the next gpu_execute
+ */
+GPUSettings&gpu_getSettings();
+
+/**
+ * @brief This function returns counters of the gpu.
+ *
+ * @return counters accumulated since the last gpu_resetCounters
+ */
+GPUCounters const&gpu_getCounters();
+
+/**
+ * @brief This function sets all counters of the gpu to zero.
+ */
+void gpu_resetCounters();
+
 /**
  * @brief function that executes work stored in command buffer on the gpu memory.
  * This function represents the functionality of GPU.
@@ -20,3 +72,68 @@
 void gpu_execute(GPUMemory&mem,CommandBuffer&cb);
 
 glm::vec4 read_texture(Texture const&texture,glm::vec2 uv);
+
+/**
+ * @brief This function encodes normal for g-buffer.
+ * Normal is projected onto octahedron and stored in 2 x 15 bits, the highest bit marks written pixel.
+ *
+ * @param normal normal, it does not have to be normalized
+ *
+ * @return encoded normal, it is never 0
+ */
+uint32_t encodeGBufferNormal(glm::vec3 const&normal);
+
+/**
+ * @brief This function decodes normal stored in g-buffer.
+ *
+ * @param normal encoded normal (see encodeGBufferNormal)
+ *
+ * @return normalized normal
+ */
+glm::vec3 decodeGBufferNormal(uint32_t normal);
+
+/**
+ * @brief This function reads color from level 0 of texture with bilinear filtering.
+ *
+ * @param texture texture
+ * @param uv uv coordinates, texture repeats outside of [0,1]
+ *
+ * @return color 4 floats
+ */
+glm::vec4 read_textureBilinear(Texture const&texture,glm::vec2 uv);
+
+/**
+ * @brief This function reads color from mip levels of texture with trilinear filtering.
+ * Texture without mip levels (see TextureMipmaps) is sampled bilinearly.
+ *
+ * @param texture texture
+ * @param uv uv coordinates, texture repeats outside of [0,1]
+ * @param lod level of detail, it is clamped to existing levels
+ *
+ * @return color 4 floats
+ */
+glm::vec4 read_textureLod(Texture const&texture,glm::vec2 uv,float lod);
+
+/**
+ * @brief This function reads color with trilinear filtering,
+ * level of detail is computed from screen space derivatives of uv coordinates.
+ *
+ * @param texture texture
+ * @param uv uv coordinates, texture repeats outside of [0,1]
+ * @param dUVdx derivative of uv along x (InFragment::dFdx)
+ * @param dUVdy derivative of uv along y (InFragment::dFdy)
+ *
+ * @return color 4 floats
+ */
+glm::vec4 read_textureGrad(Texture const&texture,glm::vec2 uv,glm::vec2 dUVdx,glm::vec2 dUVdy);
+
+/**
+ * @brief This function computes level of detail of texture from screen space derivatives of uv coordinates.
+ *
+ * @param texture texture
+ * @param dUVdx derivative of uv along x
+ * @param dUVdy derivative of uv along y
+ *
+ * @return level of detail, 0 is level 0, negative values mean magnification
+ */
+float texture_lod(Texture const&texture,glm::vec2 dUVdx,glm::vec2 dUVdy);
@@ -0,0 +1,118 @@
+/*!
+ * @file
+ * @brief This file contains implementation of pool of worker threads
+ */
+
+#include <student/threadPool.hpp>
+
+#include <algorithm>
+
+ThreadPool::~ThreadPool()
+{
+    resize(1);
+}
+
+/**
+ * @brief This function sets number of threads including the calling thread.
+ *
+ * @param nofThreads number of threads, 0 selects all cores
+ */
+void ThreadPool::resize(uint32_t nofThreads)
+{
+    if (nofThreads == 0)
+        nofThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (nofThreads == getNofThreads())
+        return;
+
+    // Zastaveni starych vlaken
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    startCondition.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+    threads.clear();
+
+    stop = false;
+
+    // Volajici vlakno je worker 0
+    for (uint32_t worker = 1; worker < nofThreads; worker++)
+        threads.emplace_back(&ThreadPool::workerLoop, this, worker, generation);
+}
+
+/**
+ * @brief This function returns number of threads including the calling thread.
+ *
+ * @return number of threads
+ */
+uint32_t ThreadPool::getNofThreads() const
+{
+    return (uint32_t)threads.size() + 1;
+}
+
+/**
+ * @brief This function executes job for indices 0..count-1 and waits for all of them.
+ *
+ * @param count number of jobs
+ * @param job job function
+ */
+void ThreadPool::parallelFor(uint32_t count, ParallelJob const& job)
+{
+    if (threads.empty() || count <= 1)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            job(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job   = &job;
+        this->count = count;
+        nextIndex   = 0;
+        running     = (uint32_t)threads.size();
+        generation++;
+    }
+    startCondition.notify_all();
+
+    runJobs(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [&](){ return running == 0; });
+    this->job = nullptr;
+}
+
+void ThreadPool::runJobs(uint32_t worker)
+{
+    for (;;)
+    {
+        uint32_t index = nextIndex.fetch_add(1);
+        if (index >= count)
+            return;
+        (*job)(index, worker);
+    }
+}
+
+void ThreadPool::workerLoop(uint32_t worker, uint64_t seenGeneration)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&](){ return stop || generation != seenGeneration; });
+            if (stop)
+                return;
+            seenGeneration = generation;
+        }
+
+        runJobs(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+        }
+        doneCondition.notify_one();
+    }
+}
@@ -0,0 +1,49 @@
+/*!
+ * @file
+ * @brief This file contains pool of worker threads used by gpu
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Function type for one job of parallel for
+ *
+ * @param index index of the job
+ * @param worker id of the worker that executes the job (0 is the calling thread)
+ */
+using ParallelJob = std::function<void(uint32_t index, uint32_t worker)>;
+
+/**
+ * @brief This class represents pool of persistent worker threads.
+ * Jobs are distributed dynamically, every index is executed exactly once.
+ */
+class ThreadPool
+{
+    public:
+        ThreadPool() {}
+        ~ThreadPool();
+        void resize(uint32_t nofThreads);
+        uint32_t getNofThreads() const;
+        void parallelFor(uint32_t count, ParallelJob const& job);
+    private:
+        void workerLoop(uint32_t worker, uint64_t seenGeneration);
+        void runJobs(uint32_t worker);
+
+        std::vector<std::thread> threads;
+        std::mutex               mutex;
+        std::condition_variable  startCondition;
+        std::condition_variable  doneCondition;
+        ParallelJob const*       job        = nullptr;
+        uint32_t                 count      = 0;
+        std::atomic<uint32_t>    nextIndex  {0};
+        uint64_t                 generation = 0;
+        uint32_t                 running    = 0;
+        bool                     stop       = false;
+};
@@ -0,0 +1,133 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iostream>
+#include <string.h>
+
+#include <student/gpu.hpp>
+#include <framework/framebuffer.hpp>
+
+#include <tests/testCommon.hpp>
+
+using namespace tests;
+
+namespace blendTests{
+
+/**
+ * @brief This vertex shader generates one triangle per draw.
+ * Draw 2 covers only the lower left half of the screen, other draws cover whole screen.
+ * uniforms[drawID*2+0] contains color, uniforms[drawID*2+1] contains depth.
+ */
+void vertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface const&si){
+  auto const id   = inVertex.gl_VertexID%3;
+  auto const size = inVertex.gl_DrawID == 2 ? 2.f : 4.f;
+  auto const z    = si.uniforms[inVertex.gl_DrawID*2+1].v1;
+  outVertex.gl_Position = glm::vec4(-1.f+(id==1)*size,-1.f+(id==2)*size,z,1.f);
+  outVertex.attributes[0].u1 = inVertex.gl_DrawID;
+}
+
+/**
+ * @brief This fragment shader returns color of the draw.
+ */
+void fragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&si){
+  outFragment.gl_FragColor = si.uniforms[inFragment.attributes[0].u1*2].v4;
+}
+
+/**
+ * @brief This function converts color to 8 bits with rounding.
+ */
+glm::uvec4 toBytes(glm::vec4 const&c){
+  return glm::uvec4(glm::clamp(c,0.f,1.f)*255.f+.5f);
+}
+
+/**
+ * @brief This function blends colors in 8 bits (SRC_ALPHA, ONE_MINUS_SRC_ALPHA) with rounding.
+ */
+glm::uvec4 blendBytes(glm::uvec4 const&dst,glm::uvec4 const&src){
+  return (src*src.a + dst*(255u-src.a) + 127u)/255u;
+}
+
+}
+
+using namespace blendTests;
+
+SCENARIO("56"){
+  std::cerr << "56 - blend mode, depth test and depth write of draw command" << std::endl;
+
+  auto const settings = gpu_getSettings();
+
+  glm::vec4 const clearColor = glm::vec4(.5f,.3f,.2f,1.f);
+  glm::vec4 const colors[] = {
+    glm::vec4(.3f,.4f,.2f,.7f),
+    glm::vec4(.3f,.4f,.2f,.7f),
+    glm::vec4(.9f,.1f,.6f,.2f),
+    glm::vec4(.1f,.2f,.8f,1.f),
+  };
+  float const depths[] = {.8f,.8f,.7f,.6f};
+
+  auto const clearBytes = glm::uvec4(glm::dvec4(clearColor)*255.);
+  auto const blended    = blendBytes(clearBytes,toBytes(colors[1]));
+  auto const stored     = toBytes(colors[3]);
+
+  size_t differentPixels = 0;
+  size_t storedPixels    = 0;
+  size_t blendedPixels   = 0;
+  for(bool quads:{false,true}){
+    gpu_getSettings().simdQuads = quads;
+
+    Framebuffer framebuffer(37,23);
+    MEMCB();
+    mem.framebuffer = framebuffer.getFrame();
+    for(uint32_t d=0;d<4;++d){
+      mem.uniforms[d*2+0].v4 = colors[d];
+      mem.uniforms[d*2+1].v1 = depths[d];
+    }
+    mem.programs[0].vertexShader   = vertexShader;
+    mem.programs[0].fragmentShader = fragmentShader;
+    mem.programs[0].vs2fs[0]       = AttributeType::UINT;
+
+    pushClearCommand(cb,clearColor,.5f);
+    // farther than cleared depth, rejected by the depth test
+    pushDrawCommand (cb,3,0,{},false,BlendMode::ALPHA);
+    // blended without depth test and without depth write
+    pushDrawCommand (cb,3,0,{},false,BlendMode::ALPHA,false,false);
+    // lower left half is overwritten by farther depth
+    pushDrawCommand (cb,3,0,{},false,BlendMode::NONE ,false,true );
+    // passes only in the lower left half
+    pushDrawCommand (cb,3,0,{},false,BlendMode::NONE);
+    gpu_execute(mem,cb);
+
+    auto const frame = framebuffer.getFrame();
+    for(uint32_t y=0;y<frame.height;++y)
+      for(uint32_t x=0;x<frame.width;++x){
+        auto const pix   = glm::uvec2(x,y);
+        auto const depth = readDepth(frame,pix);
+        auto const color = getColor(frame,pix);
+        if(depth == depths[3]){
+          storedPixels++;
+          differentPixels += color != stored;
+        }else{
+          blendedPixels++;
+          differentPixels += color != blended || depth != .5f;
+        }
+      }
+  }
+
+  gpu_getSettings() = settings;
+
+  if(differentPixels == 0 && storedPixels > 0 && blendedPixels > 0)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test kreslí trojúhelníky s různým nastavením blendingu, depth testu a zápisu hloubky (DrawCommand).
+  BlendMode::ALPHA míchá barvy v 8 bitech se zaokrouhlením, BlendMode::NONE barvu jen zapíše.
+  Kreslení bez depth testu nesmí být zahozeno ani tehdy, když je dál než hloubka ve framebufferu,
+  kreslení bez zápisu hloubky hloubku ve framebufferu nemění.
+
+  Očekávaná smíchaná barva: )." << str(blended) << R".(
+  Očekávaná zapsaná barva: )." << str(stored) << R".(
+  Počet pixelů se zapsanou barvou: )." << storedPixels << R".(
+  Počet pixelů se smíchanou barvou: )." << blendedPixels << R".(
+  Počet rozdílných pixelů: )." << differentPixels << std::endl;
+  REQUIRE(false);
+}
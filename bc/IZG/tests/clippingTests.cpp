@@ -16,6 +16,53 @@ using namespace tests;
 
 #include <glm/gtc/matrix_transform.hpp>
 
+namespace clippingTests{
+
+/**
+ * @brief This vertex shader passes clip space position and color from attributes.
+ */
+void vertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface const&){
+  outVertex.gl_Position      = inVertex.attributes[0].v4;
+  outVertex.attributes[0].v3 = inVertex.attributes[1].v3;
+}
+
+/**
+ * @brief This fragment shader returns interpolated color.
+ */
+void fragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&){
+  outFragment.gl_FragColor = glm::vec4(inFragment.attributes[0].v3,1.f);
+}
+
+/**
+ * @brief This function draws triangles given by clip space positions and colors.
+ *
+ * @param framebuffer output framebuffer
+ * @param vertices position (vec4) and color (vec3) of every vertex
+ *
+ * @return counters of the draw
+ */
+GPUCounters renderTriangles(Framebuffer&framebuffer,std::vector<float>const&vertices){
+  MEMCB();
+  mem.framebuffer = framebuffer.getFrame();
+  mem.buffers[0].data = vertices.data();
+  mem.buffers[0].size = vertices.size()*sizeof(float);
+  mem.programs[0].vertexShader   = vertexShader;
+  mem.programs[0].fragmentShader = fragmentShader;
+  mem.programs[0].vs2fs[0]       = AttributeType::VEC3;
+
+  VertexArray vao;
+  vao.vertexAttrib[0] = {0,sizeof(float)*7,0                ,AttributeType::VEC4};
+  vao.vertexAttrib[1] = {0,sizeof(float)*7,sizeof(float)*4  ,AttributeType::VEC3};
+  pushClearCommand(cb,glm::vec4(0.f),1.f);
+  pushDrawCommand (cb,(uint32_t)vertices.size()/7,0,vao);
+
+  gpu_resetCounters();
+  gpu_execute(mem,cb);
+  return gpu_getCounters();
+}
+
+}
+
 SCENARIO("21"){
   std::cerr << "21 - clipping - CW triangle behind near plane" << std::endl;
 
@@ -40,6 +87,7 @@ SCENARIO("21"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3);
 
@@ -72,6 +120,7 @@ SCENARIO("22"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3);
 
@@ -110,6 +159,7 @@ SCENARIO("23"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
+  mem.programs[0].sideEffects    = true;
 
 
   pushDrawCommand(cb,3);
@@ -154,6 +204,7 @@ SCENARIO("24"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
+  mem.programs[0].sideEffects    = true;
 
 
   pushDrawCommand(cb,3);
@@ -169,3 +220,72 @@ SCENARIO("24"){
     REQUIRE(inFragments.size() >= expectedCount - err);
 }
 
+
+SCENARIO("61"){
+  std::cerr << "61 - clipping - guard band" << std::endl;
+
+  // x, y, z, w, r, g, b
+  std::vector<float>const vertices = {
+    // inside guard band, partly outside viewport -> rasterized without clipping
+    -3.f ,-.5f ,.0f,1.f, 1.f,0.f,0.f,
+    .8f  ,-.6f ,.0f,1.f, 0.f,1.f,0.f,
+    .2f  ,2.5f ,.0f,1.f, 0.f,0.f,1.f,
+    // one vertex behind near plane -> clipped
+    -.5f ,-.8f ,.5f,1.f, 1.f,1.f,0.f,
+    .6f  ,-.7f ,.5f,1.f, 0.f,1.f,1.f,
+    .1f  ,.9f  ,-3.f,1.f, 1.f,0.f,1.f,
+    // far outside guard band, covers whole viewport behind other triangles -> clipped
+    -1e6f,-1e6f,.9f,1.f, .2f,.4f,.6f,
+    1e6f ,-1e6f,.9f,1.f, .6f,.2f,.4f,
+    .0f  ,1e6f ,.9f,1.f, .4f,.6f,.2f,
+    // outside right plane of view volume -> rejected
+    2.f  ,.0f  ,.0f,1.f, 1.f,1.f,1.f,
+    3.f  ,1.f  ,.0f,1.f, 1.f,1.f,1.f,
+    2.5f ,-1.f ,.0f,1.f, 1.f,1.f,1.f,
+  };
+
+  auto const settings = gpu_getSettings();
+
+  Framebuffer guardBand(101,77);
+  Framebuffer reference(101,77);
+  gpu_getSettings().guardBand = true;
+  auto const guardBandCounters = clippingTests::renderTriangles(guardBand,vertices);
+  gpu_getSettings().guardBand = false;
+  auto const referenceCounters = clippingTests::renderTriangles(reference,vertices);
+
+  gpu_getSettings() = settings;
+
+  // clipped triangles have new vertices, colors may differ by rounding
+  auto const frameA = guardBand.getFrame();
+  auto const frameB = reference.getFrame();
+  size_t differentPixels = 0;
+  for(uint32_t y=0;y<frameA.height;++y)
+    for(uint32_t x=0;x<frameA.width;++x){
+      auto const a = glm::ivec4(getColor(frameA,glm::uvec2(x,y)));
+      auto const b = glm::ivec4(getColor(frameB,glm::uvec2(x,y)));
+      auto const d = glm::abs(a-b);
+      differentPixels += glm::max(glm::max(d.x,d.y),glm::max(d.z,d.w)) > 2;
+    }
+
+  bool const countersOk =
+    guardBandCounters.clippedTriangles      == 2 && guardBandCounters.clipRejectedTriangles == 1 &&
+    referenceCounters.clippedTriangles      == 3 && referenceCounters.clipRejectedTriangles == 1;
+
+  if(differentPixels == 0 && countersOk)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test kreslí trojúhelník uvnitř guard bandu, který přesahuje okno,
+  trojúhelník s vrcholem za blízkou rovinou, obří trojúhelník daleko za hranicí guard bandu
+  a trojúhelník celý mimo pravou rovinu pohledového tělesa.
+  Obraz s guard bandem musí být stejný jako obraz s ořezem všech trojúhelníků oknem (GPUSettings::guardBand = false).
+  S guard bandem se ořežou 2 trojúhelníky, s ořezem oknem 3 a v obou případech se 1 trojúhelník zahodí.
+
+  Počet rozdílných pixelů: )." << differentPixels << R".(
+  Ořezané trojúhelníky (guard band): )." << guardBandCounters.clippedTriangles << R".(
+  Zahozené trojúhelníky (guard band): )." << guardBandCounters.clipRejectedTriangles << R".(
+  Ořezané trojúhelníky (ořez oknem): )." << referenceCounters.clippedTriangles << R".(
+  Zahozené trojúhelníky (ořez oknem): )." << referenceCounters.clipRejectedTriangles << std::endl;
+  REQUIRE(false);
+}
@@ -6,9 +6,10 @@ namespace tests{
 
 std::string commandTypeToStr(CommandType const&type){
   switch(type){
-    case CommandType::CLEAR:return "CLEAR";
-    case CommandType::DRAW :return "DRAW" ;
-    case CommandType::EMPTY:return "EMPTY";
+    case CommandType::CLEAR   :return "CLEAR"   ;
+    case CommandType::DRAW    :return "DRAW"    ;
+    case CommandType::LIGHTING:return "LIGHTING";
+    case CommandType::EMPTY   :return "EMPTY"   ;
   }
   return "";
 }
@@ -27,6 +28,11 @@ std::string drawCommandToStr(size_t p,uint32_t i,DrawCommand const&cmd){
   ss << padding(p) << "cb.commands["<<i<<"].data.drawCommand.backfaceCulling = "<<str(cmd.backfaceCulling) <<";" << std::endl;
   ss << padding(p) << "cb.commands["<<i<<"].data.drawCommand.programID       = "<<cmd.programID            <<";" << std::endl;
   ss << padding(p) << "cb.commands["<<i<<"].data.drawCommand.nofVertices     = "<<cmd.nofVertices          <<";" << std::endl;
+  if(cmd.blendMode != BlendMode::FRAGMENT_ALPHA || !cmd.depthTest || !cmd.depthWrite){
+    ss << padding(p) << "cb.commands["<<i<<"].data.drawCommand.blendMode       = "<<str(cmd.blendMode)       <<";" << std::endl;
+    ss << padding(p) << "cb.commands["<<i<<"].data.drawCommand.depthTest       = "<<str(cmd.depthTest)       <<";" << std::endl;
+    ss << padding(p) << "cb.commands["<<i<<"].data.drawCommand.depthWrite      = "<<str(cmd.depthWrite)      <<";" << std::endl;
+  }
   if(cmd.vao.indexBufferID>=0){
     ss << padding(p) << "cb.commands["<<i<<"].data.drawCommand.vao.indexBufferID = " << cmd.vao.indexBufferID  << ";" << std::endl;
     ss << padding(p) << "cb.commands["<<i<<"].data.drawCommand.vao.indexOffset   = " << cmd.vao.indexOffset    << ";" << std::endl;
@@ -42,6 +48,12 @@ std::string drawCommandToStr(size_t p,uint32_t i,DrawCommand const&cmd){
   return ss.str();
 }
 
+std::string lightingCommandToStr(size_t p,uint32_t i,LightingCommand const&cmd){
+  std::stringstream ss;
+  ss << padding(p) << "cb.commands["<<i<<"].data.lightingCommand.programID = "<<cmd.programID<<";" << std::endl;
+  return ss.str();
+}
+
 std::string commandToStr(size_t p,uint32_t i,Command const&cmd){
   std::stringstream ss;
   ss << padding(p) << "cb.commands["<<i<<"].type = CommandType::" << commandTypeToStr(cmd.type) << ";" << std::endl;
@@ -52,6 +64,9 @@ std::string commandToStr(size_t p,uint32_t i,Command const&cmd){
     case CommandType::DRAW:
       ss << drawCommandToStr(p,i,cmd.data.drawCommand);
       break;
+    case CommandType::LIGHTING:
+      ss << lightingCommandToStr(p,i,cmd.data.lightingCommand);
+      break;
     case CommandType::EMPTY:
       break;
   }
@@ -266,12 +266,16 @@ void nofVerticesTest(uint32_t N,uint32_t prg){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderDump0  ;
   mem.programs[0].fragmentShader = fragmentShaderEmpty;
+  mem.programs[0].sideEffects    = true;
   mem.programs[1].vertexShader   = vertexShaderDump1  ;
   mem.programs[1].fragmentShader = fragmentShaderEmpty;
+  mem.programs[1].sideEffects    = true;
   mem.programs[2].vertexShader   = vertexShaderDump2  ;
   mem.programs[2].fragmentShader = fragmentShaderEmpty;
+  mem.programs[2].sideEffects    = true;
   mem.programs[3].vertexShader   = vertexShaderDump3  ;
   mem.programs[3].fragmentShader = fragmentShaderEmpty;
+  mem.programs[3].sideEffects    = true;
 
   pushDrawCommand(cb,N,prg);
 
@@ -354,12 +358,16 @@ SCENARIO("02"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderDump0  ;
   mem.programs[0].fragmentShader = fragmentShaderEmpty;
+  mem.programs[0].sideEffects    = true;
   mem.programs[1].vertexShader   = vertexShaderDump1  ;
   mem.programs[1].fragmentShader = fragmentShaderEmpty;
+  mem.programs[1].sideEffects    = true;
   mem.programs[2].vertexShader   = vertexShaderDump2  ;
   mem.programs[2].fragmentShader = fragmentShaderEmpty;
+  mem.programs[2].sideEffects    = true;
   mem.programs[3].vertexShader   = vertexShaderDump3  ;
   mem.programs[3].fragmentShader = fragmentShaderEmpty;
+  mem.programs[3].sideEffects    = true;
 
   pushClearCommand(cb,glm::vec4(.1,.1,.1,1),3,true,true);
   pushDrawCommand(cb,3,0);
@@ -406,8 +414,10 @@ SCENARIO("03"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderDump0  ;
   mem.programs[0].fragmentShader = fragmentShaderEmpty;
+  mem.programs[0].sideEffects    = true;
   mem.programs[1].vertexShader   = vertexShaderDump1  ;
   mem.programs[1].fragmentShader = fragmentShaderEmpty;
+  mem.programs[1].sideEffects    = true;
 
   pushClearCommand(cb,glm::vec4(.1,.1,.1,1),3,true,true);
   pushDrawCommand(cb,3,0);
@@ -0,0 +1,175 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iostream>
+#include <string.h>
+
+#include <student/gpu.hpp>
+#include <framework/framebuffer.hpp>
+
+#include <tests/testCommon.hpp>
+
+using namespace tests;
+
+namespace deferredShadingTests{
+
+float const depths[] = {.2f,.5f,.3f};///< depth of draws
+
+/**
+ * @brief This vertex shader generates one triangle per draw.
+ * Draws 0 and 1 cover the lower left half of the screen, draw 2 is closer than draw 1 and covers its lower left quarter.
+ */
+void vertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface const&){
+  auto const id   = inVertex.gl_VertexID%3;
+  auto const size = inVertex.gl_DrawID == 2 ? 1.f : 2.f;
+  outVertex.gl_Position = glm::vec4(-1.f+(id==1)*size,-1.f+(id==2)*size,depths[inVertex.gl_DrawID],1.f);
+  outVertex.attributes[0].u1 = inVertex.gl_DrawID;
+}
+
+/**
+ * @brief This fragment shader writes albedo, normal and position of the draw into g-buffer.
+ * uniforms[drawID*2+0] contains albedo, uniforms[drawID*2+1] contains normal.
+ */
+void geometryShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&si){
+  auto const d = inFragment.attributes[0].u1;
+  outFragment.gl_FragColor    = si.uniforms[d*2+0].v4;
+  outFragment.gl_FragNormal   = si.uniforms[d*2+1].v3;
+  outFragment.gl_FragPosition = glm::vec3(glm::vec2(inFragment.gl_FragCoord),(float)d);
+}
+
+/**
+ * @brief This lighting shader uses albedo, normal, position and depth of pixel.
+ * uniforms[6] contains direction to the light.
+ */
+void lightingShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&si){
+  auto const albedo   = inFragment.attributes[0].v4;
+  auto const normal   = inFragment.attributes[1].v3;
+  auto const position = inFragment.attributes[2].v3;
+  auto const diffuse  = glm::max(glm::dot(normal,si.uniforms[6].v3),0.f);
+  outFragment.gl_FragColor = glm::vec4(glm::vec3(albedo)*diffuse,albedo.a);
+  outFragment.gl_FragColor.b += glm::fract(position.x/16.f)*.25f+position.z*.1f;
+  outFragment.gl_FragColor.a  = inFragment.gl_FragCoord.z;
+}
+
+/**
+ * @brief This function converts color to 8 bits with rounding.
+ */
+glm::uvec4 toBytes(glm::vec4 const&c){
+  return glm::uvec4(glm::clamp(c,0.f,1.f)*255.f+.5f);
+}
+
+}
+
+using namespace deferredShadingTests;
+
+SCENARIO("58"){
+  std::cerr << "58 - deferred shading" << std::endl;
+
+  auto const settings = gpu_getSettings();
+
+  uint32_t const width  = 45;
+  uint32_t const height = 38;
+
+  glm::vec4 const albedos[] = {glm::vec4(1.f),glm::vec4(.9f,.6f,.2f,1.f),glm::vec4(.3f,.8f,.7f,1.f)};
+  glm::vec3 const normals[] = {glm::vec3(1.f),glm::vec3(.2f,.3f,1.f) ,glm::vec3(-.7f,.1f,-.4f)};
+  glm::vec4 const clearColor = glm::vec4(.1f,.2f,.3f,1.f);
+  auto const clearBytes = glm::uvec4(glm::dvec4(clearColor)*255.);
+
+  size_t   wrongGBuffer   = 0;
+  size_t   wrongColors    = 0;
+  size_t   coveredPixels  = 0;
+  uint64_t lightedPixels  = 0;
+  float    maxNormalError = 0.f;
+  for(bool tiled:{false,true})
+    for(bool quads:{false,true}){
+      gpu_getSettings().simdQuads = quads;
+
+      Framebuffer framebuffer(width,height,tiled);
+      MEMCB();
+      mem.framebuffer = framebuffer.getFrame();
+      std::vector<uint32_t >gbufferNormals  (getNofPixels(mem.framebuffer));
+      std::vector<glm::vec3>gbufferPositions(getNofPixels(mem.framebuffer));
+      mem.framebuffer.normal   = gbufferNormals  .data();
+      mem.framebuffer.position = gbufferPositions.data();
+
+      for(uint32_t d=0;d<3;++d){
+        mem.uniforms[d*2+0].v4 = albedos[d];
+        mem.uniforms[d*2+1].v3 = normals[d];
+      }
+      mem.uniforms[6].v3 = glm::normalize(glm::vec3(.3f,.4f,.8f));
+      mem.programs[0].vertexShader   = vertexShader;
+      mem.programs[0].fragmentShader = geometryShader;
+      mem.programs[0].vs2fs[0]       = AttributeType::UINT;
+      mem.programs[0].gbufferOutput  = true;
+      mem.programs[1].fragmentShader = lightingShader;
+
+      // the first draw is cleared, cleared pixels do not contain geometry
+      pushDrawCommand (cb,3,0,{},false,BlendMode::NONE);
+      pushClearCommand(cb,clearColor,.9f);
+      pushDrawCommand (cb,3,0,{},false,BlendMode::NONE);
+      pushDrawCommand (cb,3,0,{},false,BlendMode::NONE);
+      gpu_execute(mem,cb);
+
+      auto const frame = framebuffer.getFrame();
+      std::vector<glm::uvec4>expected(width*height);
+      for(uint32_t y=0;y<height;++y)
+        for(uint32_t x=0;x<width;++x){
+          auto const pix   = glm::uvec2(x,y);
+          auto const depth = readDepth(frame,pix);
+          auto const index = getPixelIndex(frame,x,y);
+          auto&e = expected[y*width+x];
+          e = getColor(frame,pix);
+          if(depth == .9f){
+            wrongGBuffer += gbufferNormals[index] != 0;
+            continue;
+          }
+          auto const d = depth == depths[2] ? 2u : 1u;
+          coveredPixels++;
+          auto const normal = decodeGBufferNormal(gbufferNormals[index]);
+          auto const error  = glm::length(normal-glm::normalize(normals[d]));
+          maxNormalError = std::max(maxNormalError,error);
+          wrongGBuffer += gbufferNormals[index] == 0 || !(error < 1e-3f) || gbufferPositions[index] != glm::vec3(x+.5f,y+.5f,(float)d) || e != toBytes(albedos[d]);
+
+          InFragment inFragment;
+          inFragment.gl_FragCoord = glm::vec4(x+.5f,y+.5f,depth,1.f);
+          inFragment.attributes[0].v4 = glm::vec4(e)/255.f;
+          inFragment.attributes[1].v3 = normal;
+          inFragment.attributes[2].v3 = gbufferPositions[index];
+          OutFragment outFragment;
+          ShaderInterface si;
+          si.uniforms = mem.uniforms;
+          lightingShader(outFragment,inFragment,si);
+          e = toBytes(outFragment.gl_FragColor);
+        }
+
+      cb.nofCommands = 0;
+      pushLightingCommand(cb,1);
+      gpu_resetCounters();
+      gpu_execute(mem,cb);
+      lightedPixels += gpu_getCounters().lightingInvocations;
+
+      for(uint32_t y=0;y<height;++y)
+        for(uint32_t x=0;x<width;++x)
+          wrongColors += getColor(frame,glm::uvec2(x,y)) != expected[y*width+x];
+      wrongColors += getColor(frame,glm::uvec2(width-1,height-1)) != clearBytes;
+    }
+
+  gpu_getSettings() = settings;
+
+  if(wrongGBuffer == 0 && wrongColors == 0 && coveredPixels > 0 && lightedPixels == coveredPixels)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test kreslí dva trojúhelníky programem, který zapisuje do g-bufferu (Program::gbufferOutput),
+  a pak je osvětlí příkazem LIGHTING (pushLightingCommand).
+  Barva fragmentu je albedo, gl_FragNormal a gl_FragPosition se zapíší do g-bufferu
+  (Frame::normal a Frame::position, normála je zakódovaná funkcí encodeGBufferNormal). Smazané pixely nemají geometrii (normal == 0).
+  Osvětlovací shader se spustí jednou pro každý pixel s geometrií, ostatní pixely si ponechají barvu.
+
+  Počet pixelů s chybným g-bufferem: )." << wrongGBuffer << R".(
+  Největší chyba dekódované normály: )." << maxNormalError << R".(
+  Počet pixelů s chybnou barvou po osvětlení: )." << wrongColors << R".(
+  Počet pixelů s geometrií: )." << coveredPixels << R".(
+  Počet spuštění osvětlovacího shaderu: )." << lightedPixels << std::endl;
+  REQUIRE(false);
+}
@@ -0,0 +1,133 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iostream>
+#include <string.h>
+
+#include <student/gpu.hpp>
+#include <framework/framebuffer.hpp>
+
+#include <tests/testCommon.hpp>
+
+using namespace tests;
+
+namespace depthPrepassTests{
+
+uint32_t const nofDraws = 8;
+
+/**
+ * @brief This vertex shader generates one slanted triangle per draw.
+ * Triangles overlap and intersect each other, later draws are mostly closer.
+ */
+void vertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface const&){
+  auto const id = inVertex.gl_VertexID%3;
+  auto const d  = (float)inVertex.gl_DrawID;
+  glm::vec2 const positions[] = {
+    glm::vec2(-1.1f+.1f*d,-1.2f     ),
+    glm::vec2( 1.2f      ,-.9f+.2f*d),
+    glm::vec2(-.6f+.15f*d, 1.3f     ),
+  };
+  float const depths[] = {.9f-.1f*d,.75f-.08f*d+.3f*(inVertex.gl_DrawID%2),.7f-.05f*d};
+  outVertex.gl_Position = glm::vec4(positions[id],depths[id],1.f);
+  outVertex.attributes[0].u1 = inVertex.gl_DrawID;
+}
+
+/**
+ * @brief This fragment shader returns color that depends on draw and on pixel.
+ * The last draw is transparent.
+ */
+void fragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&){
+  auto const d = inFragment.attributes[0].u1;
+  outFragment.gl_FragColor = glm::vec4(
+      glm::fract(.37f*d)                        ,
+      glm::fract(inFragment.gl_FragCoord.x/64.f),
+      glm::fract(inFragment.gl_FragCoord.y/64.f),
+      d+1 == nofDraws ? .4f : 1.f);
+}
+
+/**
+ * @brief This function renders the scene and returns counters of the gpu.
+ */
+GPUCounters render(Framebuffer&framebuffer,bool depthPrepass){
+  MEMCB();
+  mem.framebuffer = framebuffer.getFrame();
+  mem.programs[0].vertexShader   = vertexShader;
+  mem.programs[0].fragmentShader = fragmentShader;
+  mem.programs[0].vs2fs[0]       = AttributeType::UINT;
+
+  pushClearCommand(cb,glm::vec4(.2f,.1f,.3f,1.f));
+  for(uint32_t d=0;d<nofDraws;++d)
+    pushDrawCommand(cb,3,0,{},false,d+1 == nofDraws ? BlendMode::ALPHA : BlendMode::NONE);
+  cb.depthPrepass = depthPrepass;
+
+  gpu_resetCounters();
+  gpu_execute(mem,cb);
+  return gpu_getCounters();
+}
+
+}
+
+using namespace depthPrepassTests;
+
+SCENARIO("57"){
+  std::cerr << "57 - depth prepass" << std::endl;
+
+  auto const settings = gpu_getSettings();
+
+  uint32_t const width  = 61;
+  uint32_t const height = 47;
+
+  size_t differentPixels  = 0;
+  size_t prepassFragments = 0;
+  bool   shadedOnce       = true;
+  uint64_t shaded         = 0;
+  uint64_t prepassShaded  = 0;
+  for(bool tiled:{false,true})
+    for(bool quads:{false,true})
+      for(bool early:{false,true})
+        for(bool hierarchical:{false,true}){
+          gpu_getSettings().simdQuads         = quads;
+          gpu_getSettings().earlyDepthTest    = early;
+          gpu_getSettings().hierarchicalDepth = hierarchical;
+
+          Framebuffer expected(width,height,tiled);
+          Framebuffer prepass (width,height,tiled);
+          auto const counters        = render(expected,false);
+          auto const prepassCounters = render(prepass ,true );
+
+          auto const expectedFrame = expected.getFrame();
+          auto const prepassFrame  = prepass .getFrame();
+          for(uint32_t y=0;y<height;++y)
+            for(uint32_t x=0;x<width;++x){
+              auto const pix = glm::uvec2(x,y);
+              differentPixels += getColor(expectedFrame,pix) != getColor(prepassFrame,pix) || readDepth(expectedFrame,pix) != readDepth(prepassFrame,pix);
+            }
+
+          prepassFragments += prepassCounters.prepassFragments;
+          // every pixel is shaded once by opaque draws and once by the transparent draw
+          if(early){
+            shaded        = counters       .shadedFragments;
+            prepassShaded = prepassCounters.shadedFragments;
+            shadedOnce &= prepassShaded <= 2*width*height && prepassShaded < shaded;
+          }
+        }
+
+  gpu_getSettings() = settings;
+
+  if(differentPixels == 0 && prepassFragments > 0 && shadedOnce)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test kreslí překrývající se neprůhledné trojúhelníky (BlendMode::NONE) a jeden průhledný
+  s hloubkovým předprůchodem (CommandBuffer::depthPrepass) a bez něj.
+  Neprůhledná kreslení se nejdříve rasterizují jen do hloubky a pak se obarví jen fragmenty
+  se stejnou hloubkou, jako je ve framebufferu. Výsledný obraz musí být stejný jako bez předprůchodu
+  a s časným testem hloubky se každý viditelný pixel neprůhledných kreslení stínuje jen jednou.
+
+  Počet rozdílných pixelů: )." << differentPixels << R".(
+  Počet fragmentů předprůchodu: )." << prepassFragments << R".(
+  Stínované fragmenty bez předprůchodu: )." << shaded << R".(
+  Stínované fragmenty s předprůchodem: )." << prepassShaded << R".(
+  Maximální počet stínovaných fragmentů: )." << 2*width*height << std::endl;
+  REQUIRE(false);
+}
@@ -139,6 +139,7 @@ void triangleRasterizationTest(glm::vec4 const&a,glm::vec4 const&b,glm::vec4 con
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3,0,{},backFaceCulling);
 
@@ -350,6 +351,7 @@ SCENARIO("11"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3,0,{},backFaceCulling);
 
@@ -407,6 +409,7 @@ SCENARIO("12"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3);
 
@@ -520,6 +523,7 @@ SCENARIO("13"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3);
 
@@ -630,6 +634,7 @@ SCENARIO("14"){
   mem.programs[0].vertexShader   = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
   mem.programs[0].vs2fs[0]       = AttributeType::VEC3;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3);
   gpu_execute(mem,cb);
@@ -743,6 +748,7 @@ SCENARIO("15"){
   mem.programs[0].vertexShader   = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderDump;
   mem.programs[0].vs2fs[0]       = AttributeType::VEC3;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3);
 
@@ -857,6 +863,7 @@ SCENARIO("16"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderWhite;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3);
 
@@ -944,6 +951,7 @@ SCENARIO("17"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderInject;
   mem.programs[0].fragmentShader = fragmentShaderWhite;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3);
 
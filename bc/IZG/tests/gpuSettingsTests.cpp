@@ -0,0 +1,395 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iostream>
+#include <string.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include <student/gpu.hpp>
+#include <framework/framebuffer.hpp>
+
+#include <tests/testCommon.hpp>
+
+using namespace tests;
+
+namespace gpuSettingsTests{
+
+/**
+ * @brief This vertex shader generates pseudo random overlapping triangles.
+ */
+void vertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface const&si){
+  auto const id   = inVertex.gl_VertexID;
+  auto const tri  = id/3;
+  auto const seed = si.uniforms[0].u1;
+  auto hash = [](uint32_t x){
+    x ^= x >> 16; x *= 0x7feb352du;
+    x ^= x >> 15; x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+  };
+  auto rnd = [&](uint32_t i){return (float)(hash(id*4+i+seed*7919)%10000)/10000.f;};
+  outVertex.gl_Position = glm::vec4(rnd(0)*2.4f-1.2f,rnd(1)*2.4f-1.2f,rnd(2)*2.f-1.f,1.f+rnd(3));
+  outVertex.attributes[0].v4 = glm::vec4(rnd(4),rnd(5),rnd(6),(tri%3)*.4f+.2f);
+  outVertex.attributes[1].u1 = tri;
+}
+
+/**
+ * @brief This fragment shader returns interpolated color.
+ */
+void fragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&){
+  outFragment.gl_FragColor = inFragment.attributes[0].v4;
+  if(inFragment.attributes[1].u1%5 == 0)outFragment.gl_FragColor.a = 1.f;
+}
+
+/**
+ * @brief This function renders test scene using current gpu settings.
+ *
+ * @param framebuffer output framebuffer
+ * @param sideEffects program is marked as program with side effects (Program::sideEffects)
+ */
+void renderScene(Framebuffer&framebuffer,bool sideEffects = false){
+  MEMCB();
+  mem.framebuffer = framebuffer.getFrame();
+  mem.uniforms[0].u1 = 1;
+  mem.programs[0].vertexShader   = vertexShader;
+  mem.programs[0].fragmentShader = fragmentShader;
+  mem.programs[0].vs2fs[0]       = AttributeType::VEC4;
+  mem.programs[0].vs2fs[1]       = AttributeType::UINT;
+  mem.programs[0].sideEffects    = sideEffects;
+
+  pushClearCommand(cb,glm::vec4(.2f,.3f,.4f,1.f),1.f);
+  pushDrawCommand (cb,300*3,0);
+  pushDrawCommand (cb,100*3,0,{},true);
+  pushClearCommand(cb,glm::vec4(0.f),.5f,false,true);
+  pushDrawCommand (cb,200*3,0);
+  gpu_execute(mem,cb);
+}
+
+/**
+ * @brief This function renders test scene with 16 bit indices shared by many triangles.
+ *
+ * @param framebuffer output framebuffer
+ */
+void renderIndexedScene(Framebuffer&framebuffer){
+  MEMCB();
+
+  std::vector<uint16_t>indices;
+  for(uint32_t i=0;i<600*3;++i)
+    indices.push_back((uint16_t)((i*7919u+(i/3)*104729u)%400u));
+
+  mem.framebuffer = framebuffer.getFrame();
+  mem.buffers[0]  = vectorToBuffer(indices);
+  mem.uniforms[0].u1 = 2;
+  mem.programs[0].vertexShader   = vertexShader;
+  mem.programs[0].fragmentShader = fragmentShader;
+  mem.programs[0].vs2fs[0]       = AttributeType::VEC4;
+  mem.programs[0].vs2fs[1]       = AttributeType::UINT;
+
+  VertexArray vao;
+  vao.indexBufferID = 0;
+  vao.indexType     = IndexType::UINT16;
+
+  pushClearCommand(cb,glm::vec4(.2f,.3f,.4f,1.f),1.f);
+  pushDrawCommand (cb,(uint32_t)indices.size(),0,vao);
+  gpu_execute(mem,cb);
+}
+
+/**
+ * @brief This function renders test scene with few triangles between several clears,
+ * so some tiles are not touched by any draw.
+ *
+ * @param frame output frame
+ */
+void renderClearScene(Frame const&frame){
+  MEMCB();
+  mem.framebuffer = frame;
+  mem.uniforms[0].u1 = 3;
+  mem.programs[0].vertexShader   = vertexShader;
+  mem.programs[0].fragmentShader = fragmentShader;
+  mem.programs[0].vs2fs[0]       = AttributeType::VEC4;
+  mem.programs[0].vs2fs[1]       = AttributeType::UINT;
+
+  pushClearCommand(cb,glm::vec4(.2f,.3f,.4f,1.f),1.f);
+  pushDrawCommand (cb,3*3,0);
+  pushClearCommand(cb,glm::vec4(.7f,.1f,.1f,.5f),0.f,true,false);
+  pushDrawCommand (cb,2*3,0);
+  pushClearCommand(cb,glm::vec4(0.f),.25f,false,true);
+  pushClearCommand(cb,glm::vec4(0.f,.5f,1.f,1.f),0.f,true,false);
+  pushDrawCommand (cb,4*3,0);
+  gpu_execute(mem,cb);
+}
+
+/**
+ * @brief This function renders clear scene into framebuffer.
+ *
+ * @param framebuffer output framebuffer
+ */
+void renderClearScene(Framebuffer&framebuffer){
+  renderClearScene(framebuffer.getFrame());
+}
+
+/**
+ * @brief This function compares two framebuffers of any memory layout.
+ *
+ * @return number of differing pixels
+ */
+size_t countDifferentPixels(Framebuffer&a,Framebuffer&b){
+  auto const frameA = a.getFrame();
+  auto const frameB = b.getFrame();
+  size_t counter = 0;
+  for(uint32_t y=0;y<frameA.height;++y)
+    for(uint32_t x=0;x<frameA.width;++x){
+      auto const pix = glm::uvec2(x,y);
+      bool same = getDepth(frameA,pix) == getDepth(frameB,pix);
+      same &= getColor(frameA,pix) == getColor(frameB,pix);
+      counter += !same;
+    }
+  return counter;
+}
+
+}
+
+using namespace gpuSettingsTests;
+
+SCENARIO("43"){
+  std::cerr << "43 - multithreaded rendering" << std::endl;
+
+  auto const settings = gpu_getSettings();
+
+  Framebuffer reference(173,131);
+  Framebuffer parallel (173,131);
+
+  gpu_getSettings().nofThreads = 1;
+  renderScene(reference);
+  gpu_getSettings().nofThreads = 4;
+  renderScene(parallel);
+
+  gpu_getSettings() = settings;
+
+  auto const differentPixels = countDifferentPixels(reference,parallel);
+  if(differentPixels == 0)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vykreslí stejnou scénu jedním a čtyřmi vlákny.
+  Dlaždice vlastní vždy jedno vlákno a trojúhelníky se v ní zpracují v pořadí kreslení,
+  proto musí být výsledek bitově stejný.
+
+  Počet rozdílných pixelů: )." << differentPixels << std::endl;
+  REQUIRE(false);
+}
+
+SCENARIO("44"){
+  std::cerr << "44 - early depth test and hierarchical depth" << std::endl;
+
+  auto const settings = gpu_getSettings();
+
+  Framebuffer reference(173,131);
+  Framebuffer early    (173,131);
+
+  gpu_getSettings().earlyDepthTest    = false;
+  gpu_getSettings().hierarchicalDepth = false;
+  gpu_resetCounters();
+  renderScene(reference);
+  auto const lateCounters = gpu_getCounters();
+
+  gpu_getSettings().earlyDepthTest    = true;
+  gpu_getSettings().hierarchicalDepth = true;
+  gpu_resetCounters();
+  renderScene(early);
+  auto const earlyCounters = gpu_getCounters();
+
+  // program with side effects opts out, its fragment shader runs for every covered fragment
+  Framebuffer sideEffects(173,131);
+  gpu_resetCounters();
+  renderScene(sideEffects,true);
+  auto const sideEffectsCounters = gpu_getCounters();
+
+  gpu_getSettings() = settings;
+
+  auto const differentPixels = countDifferentPixels(reference,early) + countDifferentPixels(reference,sideEffects);
+  bool const killed = earlyCounters.earlyDepthKilled        > 0 &&
+                      earlyCounters.hierarchicalDepthKilled > 0 &&
+                      earlyCounters.shadedFragments < lateCounters.shadedFragments;
+  bool const optOut = sideEffectsCounters.earlyDepthKilled        == 0 &&
+                      sideEffectsCounters.hierarchicalDepthKilled == 0 &&
+                      sideEffectsCounters.shadedFragments == lateCounters.shadedFragments;
+  if(differentPixels == 0 && killed && optOut)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vykreslí stejnou scénu s pozdním a s časným depth testem.
+  Fragment shader nemění hloubku, proto musí být výsledek bitově stejný
+  a časný test musí ušetřit spouštění fragment shaderu.
+  Program s vedlejšími efekty (Program::sideEffects) časný test nepoužívá
+  a jeho fragment shader se spustí stejněkrát jako s pozdním testem.
+
+  Počet rozdílných pixelů: )." << differentPixels << R".(
+  Spuštění fragment shaderu (pozdní test): )." << lateCounters.shadedFragments << R".(
+  Spuštění fragment shaderu (časný test): )." << earlyCounters.shadedFragments << R".(
+  Spuštění fragment shaderu (vedlejší efekty): )." << sideEffectsCounters.shadedFragments << R".(
+  Fragmenty zahozené časným testem: )." << earlyCounters.earlyDepthKilled << R".(
+  Dlaždice zahozené hierarchickým testem: )." << earlyCounters.hierarchicalDepthKilled << std::endl;
+  REQUIRE(false);
+}
+
+SCENARIO("45"){
+  std::cerr << "45 - simd quads" << std::endl;
+
+  auto const settings = gpu_getSettings();
+
+  size_t differentPixels = 0;
+  for(bool early:{false,true}){
+    Framebuffer scalar(173,131);
+    Framebuffer quads (173,131);
+
+    gpu_getSettings().earlyDepthTest = early;
+    gpu_getSettings().simdQuads      = false;
+    renderScene(scalar);
+    gpu_getSettings().simdQuads      = true;
+    renderScene(quads);
+
+    differentPixels += countDifferentPixels(scalar,quads);
+  }
+
+  gpu_getSettings() = settings;
+
+  if(differentPixels == 0)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vykreslí stejnou scénu po jednotlivých pixelech a po čtveřicích 2x2 (SIMD).
+  Čtveřice počítají stejné operace ve stejném pořadí,
+  proto musí být výsledek bitově stejný.
+
+  Počet rozdílných pixelů: )." << differentPixels << std::endl;
+  REQUIRE(false);
+}
+
+SCENARIO("46"){
+  std::cerr << "46 - vertex cache" << std::endl;
+
+  auto const settings = gpu_getSettings();
+
+  Framebuffer reference(173,131);
+  Framebuffer cached   (173,131);
+
+  gpu_getSettings().vertexCache = false;
+  gpu_resetCounters();
+  renderIndexedScene(reference);
+  auto const uncachedCounters = gpu_getCounters();
+
+  gpu_getSettings().vertexCache = true;
+  gpu_resetCounters();
+  renderIndexedScene(cached);
+  auto const cachedCounters = gpu_getCounters();
+
+  gpu_getSettings() = settings;
+
+  auto const differentPixels = countDifferentPixels(reference,cached);
+  bool const reused = cachedCounters.vertexShaderInvocations <= 400 &&
+                      cachedCounters.vertexShaderInvocations + cachedCounters.vertexCacheHits == uncachedCounters.vertexShaderInvocations;
+  if(differentPixels == 0 && reused)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vykreslí 600 trojúhelníků, které indexují 400 vrcholů (16 bitové indexy).
+  S cache transformovaných vrcholů se vertex shader spustí nejvýše jednou pro každý vrchol
+  a výsledek musí být bitově stejný jako bez cache.
+
+  Počet rozdílných pixelů: )." << differentPixels << R".(
+  Spuštění vertex shaderu bez cache: )." << uncachedCounters.vertexShaderInvocations << R".(
+  Spuštění vertex shaderu s cache: )." << cachedCounters.vertexShaderInvocations << R".(
+  Zásahy v cache: )." << cachedCounters.vertexCacheHits << std::endl;
+  REQUIRE(false);
+}
+
+SCENARIO("47"){
+  std::cerr << "47 - tiled framebuffer" << std::endl;
+
+  Framebuffer linear(173,131);
+  Framebuffer tiled (173,131,true);
+
+  renderScene(linear);
+  renderScene(tiled );
+
+  auto const differentPixels = countDifferentPixels(linear,tiled);
+  if(differentPixels == 0)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vykreslí stejnou scénu do framebufferu uloženého po řádcích
+  a do framebufferu uloženého po dlaždicích 8x8 pixelů.
+  Pixely se čtou přes getPixelIndex, výsledek musí být bitově stejný.
+
+  Počet rozdílných pixelů: )." << differentPixels << std::endl;
+  REQUIRE(false);
+}
+
+SCENARIO("48"){
+  std::cerr << "48 - lazy clears" << std::endl;
+
+  auto const settings = gpu_getSettings();
+
+  size_t differentPixels = 0;
+  for(bool tiled:{false,true}){
+    Framebuffer eager(173,131,tiled);
+    Framebuffer lazy (173,131,tiled);
+
+    gpu_getSettings().lazyClears = false;
+    renderClearScene(eager);
+    gpu_getSettings().lazyClears = true;
+    renderClearScene(lazy);
+
+    differentPixels += countDifferentPixels(eager,lazy);
+  }
+
+  // frame with 3 channels, bytes behind its color buffer must not be overwritten
+  uint32_t const width  = 173;
+  uint32_t const height = 131;
+  size_t   const guard  = 16;
+  std::vector<uint8_t>colors[2];
+  std::vector<float  >depths[2];
+  for(uint32_t lazy=0;lazy<2;++lazy){
+    colors[lazy].assign((size_t)width*height*3+guard,0xcd);
+    depths[lazy].assign((size_t)width*height,1.f);
+    Frame frame;
+    frame.color    = colors[lazy].data();
+    frame.depth    = depths[lazy].data();
+    frame.width    = width;
+    frame.height   = height;
+    frame.channels = 3;
+    gpu_getSettings().lazyClears = lazy;
+    renderClearScene(frame);
+  }
+  size_t differentBytes = 0;
+  for(size_t i=0;i<colors[0].size();++i)
+    differentBytes += colors[0][i] != colors[1][i];
+  size_t overwrittenGuard = 0;
+  for(auto const&color:colors)
+    for(size_t i=color.size()-guard;i<color.size();++i)
+      overwrittenGuard += color[i] != 0xcd;
+
+  gpu_getSettings() = settings;
+
+  if(differentPixels == 0 && differentBytes == 0 && overwrittenGuard == 0)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vykreslí několik trojúhelníků mezi mazáním jen barvy, jen hloubky i obojího.
+  Odložené mazání smaže dlaždici až před prvním trojúhelníkem v ní nebo na konci gpu_execute,
+  výsledek musí být bitově stejný jako při okamžitém mazání.
+  Ve framebufferu se 3 kanály se zapisují jen 3 bajty na pixel, paměť za color bufferem se nesmí přepsat.
+
+  Počet rozdílných pixelů: )." << differentPixels << R".(
+  Počet rozdílných bajtů framebufferu se 3 kanály: )." << differentBytes << R".(
+  Počet přepsaných bajtů za color bufferem se 3 kanály: )." << overwrittenGuard << std::endl;
+  REQUIRE(false);
+}
@@ -0,0 +1,285 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iostream>
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+
+#include <framework/meshOptimizer.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <tests/testCommon.hpp>
+
+using namespace tests;
+
+namespace meshOptimizerTests{
+
+using Triangle = std::array<glm::vec3,3>;
+
+/**
+ * @brief This function reads triangles of mesh, every triangle starts with its smallest vertex.
+ *
+ * @param model model
+ * @param mesh mesh
+ *
+ * @return sorted triangles
+ */
+std::vector<Triangle>readTriangles(Model const&model,Mesh const&mesh){
+  auto const less = [](glm::vec3 const&a,glm::vec3 const&b){return std::lexicographical_compare(&a.x,&a.x+3,&b.x,&b.x+3);};
+  std::vector<Triangle>res;
+  for(uint32_t t=0;t<mesh.nofIndices/3;++t){
+    Triangle tri;
+    for(uint32_t k=0;k<3;++k){
+      uint32_t v = t*3+k;
+      if(mesh.indexBufferID >= 0){
+        auto const*ptr = (uint8_t const*)model.buffers.at(mesh.indexBufferID).data+mesh.indexOffset;
+        if(mesh.indexType == IndexType::UINT16)v = ((uint16_t const*)ptr)[v];
+        else                                   v = ((uint32_t const*)ptr)[v];
+      }
+      memcpy(&tri[k],(uint8_t const*)model.buffers.at(mesh.position.bufferID).data+mesh.position.offset+mesh.position.stride*v,sizeof(glm::vec3));
+    }
+    // rotation keeps winding
+    auto const first = std::min_element(tri.begin(),tri.end(),less)-tri.begin();
+    std::rotate(tri.begin(),tri.begin()+first,tri.end());
+    res.push_back(tri);
+  }
+  std::sort(res.begin(),res.end(),[&](Triangle const&a,Triangle const&b){
+    return std::lexicographical_compare(a.begin(),a.end(),b.begin(),b.end(),less);
+  });
+  return res;
+}
+
+}
+
+using namespace meshOptimizerTests;
+
+SCENARIO("52"){
+  std::cerr << "52 - mesh optimizer" << std::endl;
+
+  // grid of 32x32 quads stored without indexing, quads are in random order
+  uint32_t const size = 32;
+  std::vector<glm::vec3>vertices;
+  std::vector<uint32_t>quads(size*size);
+  for(uint32_t i=0;i<quads.size();++i)quads[i] = (i*661u)%quads.size();
+  for(auto q:quads){
+    auto const x = (float)(q%size);
+    auto const y = (float)(q/size);
+    glm::vec3 const a(x,y,0.f),b(x+1.f,y,0.f),c(x,y+1.f,0.f),d(x+1.f,y+1.f,0.f);
+    vertices.insert(vertices.end(),{a,b,c,c,b,d});
+  }
+
+  Model model;
+  model.buffers.push_back({vertices.data(),vertices.size()*sizeof(glm::vec3)});
+  Mesh mesh;
+  mesh.position   = {0,sizeof(glm::vec3),0,AttributeType::VEC3};
+  mesh.nofIndices = (uint32_t)vertices.size();
+  model.meshes.push_back(mesh);
+
+  auto const original = readTriangles(model,model.meshes[0]);
+
+  OptimizedMeshes optimized(model);
+  optimized.attach(model);
+
+  auto const triangles = readTriangles(model,model.meshes[0]);
+  auto const&before = optimized.before.at(0);
+  auto const&after  = optimized.after .at(0);
+
+  bool const sameTriangles = triangles == original;
+  bool const merged        = after.nofVertices == (size+1)*(size+1) && before.nofVertices == vertices.size();
+  bool const betterCache   = after.acmr < before.acmr && after.acmr < 1.f;
+
+  if(sameTriangles && merged && betterCache)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test optimalizuje neindexovanou mřížku 32x32 čtverců (2048 trojúhelníků) pomocí OptimizedMeshes.
+  Optimalizovaný mesh musí obsahovat stejné trojúhelníky se stejným směrem otáčení,
+  stejné vrcholy musí být sloučeny (33x33 vrcholů)
+  a průměrný počet transformovaných vrcholů na trojúhelník (ACMR) se musí zmenšit pod 1.
+
+  Stejné trojúhelníky: )." << sameTriangles << R".(
+  Počet vrcholů před: )." << before.nofVertices << R".(
+  Počet vrcholů po: )." << after.nofVertices << R".(
+  ACMR před: )." << before.acmr << R".(
+  ACMR po: )." << after.acmr << std::endl;
+  REQUIRE(false);
+}
+
+SCENARIO("54"){
+  std::cerr << "54 - mesh levels of detail" << std::endl;
+
+  // flat indexed grid, interior vertices can be removed without error
+  uint32_t const size = 32;
+  std::vector<glm::vec3>vertices;
+  std::vector<uint32_t>indices;
+  for(uint32_t y=0;y<=size;++y)
+    for(uint32_t x=0;x<=size;++x)
+      vertices.emplace_back((float)x/size,(float)y/size,0.f);
+  for(uint32_t y=0;y<size;++y)
+    for(uint32_t x=0;x<size;++x){
+      auto const v = y*(size+1)+x;
+      indices.insert(indices.end(),{v,v+1,v+size+1,v+size+1,v+1,v+size+2});
+    }
+
+  Model model;
+  model.buffers.push_back({vertices.data(),vertices.size()*sizeof(glm::vec3)});
+  model.buffers.push_back({indices .data(),indices .size()*sizeof(uint32_t )});
+  Mesh mesh;
+  mesh.position      = {0,sizeof(glm::vec3),0,AttributeType::VEC3};
+  mesh.indexBufferID = 1;
+  mesh.indexType     = IndexType::UINT32;
+  mesh.nofIndices    = (uint32_t)indices.size();
+  model.meshes.push_back(mesh);
+  model.roots.push_back(Node());
+  model.roots.back().mesh = 0;
+
+  MeshLods lods(model);
+  lods.attach(model);
+
+  // every level has fewer triangles that cover the same area with the same orientation
+  auto const&levels = lods.lods.at(0);
+  size_t wrongLevels = levels.size() < 3;
+  for(size_t l=1;l<levels.size();++l){
+    auto const*lod = (uint32_t const*)(lods.data.data()+levels[l].indexOffset);
+    float area = 0.f;
+    bool flipped = false;
+    for(uint32_t t=0;t<levels[l].nofIndices/3;++t){
+      auto const&a = vertices.at(lod[t*3+0]);
+      auto const&b = vertices.at(lod[t*3+1]);
+      auto const&c = vertices.at(lod[t*3+2]);
+      auto const z = glm::cross(b-a,c-a).z;
+      flipped |= z <= 0.f;
+      area += z*.5f;
+    }
+    wrongLevels += levels[l].nofIndices >= levels[l-1].nofIndices || flipped || std::abs(area-1.f) > 1e-4f || levels[l].error > 1e-4f;
+  }
+
+  MEMCB();
+  std::vector<MeshInstance>instances;
+  prepareModel(mem,cb,model,instances);
+  auto const proj = glm::perspective(glm::radians(90.f),1.f,.1f,1000.f);
+  auto const farView  = glm::lookAt(glm::vec3(.5f,.5f,500.f),glm::vec3(.5f,.5f,0.f),glm::vec3(0.f,1.f,0.f));
+  auto const nearView = glm::lookAt(glm::vec3(.5f,.5f,  1.f),glm::vec3(.5f,.5f,0.f),glm::vec3(0.f,1.f,0.f));
+
+  auto const&draw = cb.commands[instances.at(0).drawCommand].data.drawCommand;
+  lods.select(cb,model,instances,farView ,proj,500,1.f);
+  bool const farCoarse = draw.nofVertices == levels.back().nofIndices && draw.vao.indexBufferID == lods.bufferID;
+  // levels of flat grid have no error, exact mesh is used only if no error is allowed
+  lods.select(cb,model,instances,nearView,proj,500,-1.f);
+  bool const nearExact = draw.nofVertices == mesh.nofIndices && draw.vao.indexBufferID == mesh.indexBufferID;
+
+  if(wrongLevels == 0 && farCoarse && nearExact)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vytvoří úrovně detailu (MeshLods) rovinné mřížky 32x32 čtverců (2048 trojúhelníků).
+  Musí vzniknout aspoň 2 hrubší úrovně, každá s menším počtem trojúhelníků,
+  které pokrývají stejnou plochu, nejsou otočené a mají nulovou chybu.
+  Vzdálená instance se musí kreslit nejhrubší úrovní a pokud není povolena žádná chyba, musí se vrátit přesný mesh.
+
+  Počet úrovní: )." << levels.size() << R".(
+  Počet špatných úrovní: )." << wrongLevels << R".(
+  Vzdálená instance používá nejhrubší úroveň: )." << farCoarse << R".(
+  Blízká instance používá přesný mesh: )." << nearExact << std::endl;
+  REQUIRE(false);
+}
+
+SCENARIO("62"){
+  std::cerr << "62 - mesh levels of detail of curved mesh" << std::endl;
+
+  // indexed unit sphere, every level of detail has nonzero error
+  uint32_t const slices = 64;
+  uint32_t const stacks = 32;
+  std::vector<glm::vec3>vertices;
+  std::vector<uint32_t>indices;
+  for(uint32_t y=0;y<=stacks;++y)
+    for(uint32_t x=0;x<=slices;++x){
+      auto const theta = glm::pi<float>()*y/stacks;
+      auto const phi   = 2.f*glm::pi<float>()*x/slices;
+      vertices.emplace_back(glm::sin(theta)*glm::cos(phi),glm::cos(theta),-glm::sin(theta)*glm::sin(phi));
+    }
+  for(uint32_t y=0;y<stacks;++y)
+    for(uint32_t x=0;x<slices;++x){
+      auto const v = y*(slices+1)+x;
+      indices.insert(indices.end(),{v,v+slices+1,v+1,v+1,v+slices+1,v+slices+2});
+    }
+
+  Model model;
+  model.buffers.push_back({vertices.data(),vertices.size()*sizeof(glm::vec3)});
+  model.buffers.push_back({indices .data(),indices .size()*sizeof(uint32_t )});
+  Mesh mesh;
+  mesh.position      = {0,sizeof(glm::vec3),0,AttributeType::VEC3};
+  mesh.indexBufferID = 1;
+  mesh.indexType     = IndexType::UINT32;
+  mesh.nofIndices    = (uint32_t)indices.size();
+  model.meshes.push_back(mesh);
+  model.roots.push_back(Node());
+  model.roots.back().mesh = 0;
+
+  MeshLods lods(model);
+  lods.attach(model);
+  auto const&levels = lods.lods.at(0);
+
+  MEMCB();
+  std::vector<MeshInstance>instances;
+  prepareModel(mem,cb,model,instances);
+  auto const proj   = glm::perspective(glm::radians(90.f),1.f,.1f,1000.f);
+  auto const height = 500u;
+  auto const&draw   = cb.commands[instances.at(0).drawCommand].data.drawCommand;
+
+  // level that select should pick for camera at distance from the center of the sphere
+  auto const expectedLevel = [&](float distance){
+    auto const depth = distance-glm::sqrt(3.f);
+    uint32_t level = 0;
+    while(level+1 < levels.size() && levels[level+1].error*proj[1][1]*height*.5f/depth <= 1.f)++level;
+    return level;
+  };
+  // level used by draw command, all its indices have to point into vertex buffer
+  size_t wrongIndices = 0;
+  auto const usedLevel = [&](){
+    auto const*ptr = (uint8_t const*)model.buffers.at(draw.vao.indexBufferID).data+draw.vao.indexOffset;
+    for(uint32_t i=0;i<draw.nofVertices;++i)
+      wrongIndices += ((uint32_t const*)ptr)[i] >= vertices.size();
+    for(uint32_t l=0;l<levels.size();++l)
+      if(draw.nofVertices == levels[l].nofIndices && draw.vao.indexOffset == levels[l].indexOffset)return l;
+    return (uint32_t)levels.size();
+  };
+
+  bool wrongErrors = levels.size() < 3;
+  for(size_t l=1;l<levels.size();++l)
+    wrongErrors |= levels[l].error <= levels[l-1].error;
+
+  std::vector<float>const distances = {2.f,50.f,900.f};
+  std::vector<uint32_t>used,expected;
+  for(auto const distance:distances){
+    auto const view = glm::lookAt(glm::vec3(0.f,0.f,distance),glm::vec3(0.f),glm::vec3(0.f,1.f,0.f));
+    lods.select(cb,model,instances,view,proj,height,1.f);
+    used    .push_back(usedLevel()             );
+    expected.push_back(expectedLevel(distance));
+  }
+
+  bool const nearExact = expected.front() == 0;
+  bool const farCoarse = expected.back () == levels.size()-1;
+
+  if(!wrongErrors && wrongIndices == 0 && used == expected && nearExact && farCoarse)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vytvoří úrovně detailu (MeshLods) koule s 4096 trojúhelníky.
+  Musí vzniknout aspoň 2 hrubší úrovně s rostoucí nenulovou chybou.
+  Instance kreslená ze vzdálenosti 2 musí použít přesný mesh, ze vzdálenosti 900 nejhrubší úroveň
+  a ze vzdálenosti 50 nejhrubší úroveň, jejíž chyba promítnutá na obrazovku je nejvýše 1 pixel.
+  Všechny indexy vybrané úrovně musí ukazovat do bufferu vrcholů.
+
+  Počet úrovní: )." << levels.size() << R".(
+  Chyba nejhrubší úrovně: )." << levels.back().error << R".(
+  Chyby úrovní nerostou: )." << wrongErrors << R".(
+  Vybrané úrovně: )." << used[0] << " " << used[1] << " " << used[2] << R".(
+  Očekávané úrovně: )." << expected[0] << " " << expected[1] << " " << expected[2] << R".(
+  Počet indexů mimo buffer vrcholů: )." << wrongIndices << std::endl;
+  REQUIRE(false);
+}
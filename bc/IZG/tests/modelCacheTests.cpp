@@ -0,0 +1,282 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iostream>
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include <framework/model.hpp>
+#include <framework/modelCache.hpp>
+
+#include <tests/testCommon.hpp>
+
+using namespace tests;
+
+namespace modelCacheTests{
+
+/**
+ * @brief This function reads vertex attribute component as float.
+ *
+ * @param model model
+ * @param att vertex attribute
+ * @param v vertex
+ * @param c component
+ *
+ * @return component value
+ */
+float readAttrib(Model const&model,VertexAttrib const&att,uint32_t v,uint32_t c){
+  float res;
+  memcpy(&res,(uint8_t const*)model.buffers.at(att.bufferID).data+att.offset+att.stride*v+c*sizeof(float),sizeof(float));
+  return res;
+}
+
+/**
+ * @brief This function reads index of indexed mesh.
+ *
+ * @param model model
+ * @param mesh mesh
+ * @param i index
+ *
+ * @return vertex id
+ */
+uint32_t readIndex(Model const&model,Mesh const&mesh,uint32_t i){
+  auto const*ptr = (uint8_t const*)model.buffers.at(mesh.indexBufferID).data+mesh.indexOffset;
+  if(mesh.indexType == IndexType::UINT8 )return ptr[i];
+  if(mesh.indexType == IndexType::UINT16)return ((uint16_t const*)ptr)[i];
+  return ((uint32_t const*)ptr)[i];
+}
+
+/**
+ * @brief This function compares vertices of two meshes.
+ *
+ * @return number of different components
+ */
+size_t compareMeshes(Model const&a,Mesh const&ma,Model const&b,Mesh const&mb){
+  size_t res = (ma.nofIndices != mb.nofIndices) + (ma.diffuseColor != mb.diffuseColor) + (ma.diffuseTexture != mb.diffuseTexture) + (ma.doubleSided != mb.doubleSided);
+  if(res)return res;
+  VertexAttrib const Mesh::*attribs[] = {&Mesh::position,&Mesh::normal,&Mesh::texCoord};
+  for(uint32_t i=0;i<ma.nofIndices;++i){
+    auto const va = ma.indexBufferID < 0 ? i : readIndex(a,ma,i);
+    auto const vb = mb.indexBufferID < 0 ? i : readIndex(b,mb,i);
+    for(auto const att:attribs){
+      res += (ma.*att).type != (mb.*att).type;
+      for(uint32_t c=0;c<((uint32_t)(ma.*att).type&7);++c)
+        res += readAttrib(a,ma.*att,va,c) != readAttrib(b,mb.*att,vb,c);
+    }
+  }
+  return res;
+}
+
+/**
+ * @brief This function compares node trees.
+ *
+ * @return number of different nodes
+ */
+size_t compareNodes(std::vector<Node>const&a,std::vector<Node>const&b){
+  if(a.size() != b.size())return 1;
+  size_t res = 0;
+  for(size_t i=0;i<a.size();++i){
+    res += a[i].mesh != b[i].mesh || a[i].modelMatrix != b[i].modelMatrix;
+    res += compareNodes(a[i].children,b[i].children);
+  }
+  return res;
+}
+
+/**
+ * @brief This function counts references of model that point outside of its buffers, meshes or textures.
+ *
+ * @return number of invalid references
+ */
+size_t countInvalidReferences(Model const&model){
+  size_t res = 0;
+  for(auto const&mesh:model.meshes){
+    uint8_t doubleSided;
+    memcpy(&doubleSided,&mesh.doubleSided,sizeof(doubleSided));
+    res += mesh.diffuseTexture < -1 || mesh.diffuseTexture >= (int)model.textures.size() || doubleSided > 1;
+    uint64_t nofVertices = mesh.nofIndices;
+    if(mesh.indexBufferID >= 0){
+      if(mesh.indexBufferID >= (int32_t)model.buffers.size() || mesh.indexOffset+(uint64_t)mesh.nofIndices*(uint32_t)mesh.indexType > model.buffers[mesh.indexBufferID].size){
+        res++;
+        continue;
+      }
+      nofVertices = 0;
+      for(uint32_t i=0;i<mesh.nofIndices;++i)
+        nofVertices = std::max<uint64_t>(nofVertices,readIndex(model,mesh,i)+1ull);
+    }
+    for(auto const*att:{&mesh.position,&mesh.normal,&mesh.texCoord}){
+      if(att->bufferID < 0 || nofVertices == 0)continue;
+      res += att->bufferID >= (int32_t)model.buffers.size() || att->offset+att->stride*(nofVertices-1)+4*((uint32_t)att->type&7) > model.buffers[att->bufferID].size;
+    }
+  }
+  std::vector<Node const*>stack;
+  for(auto const&root:model.roots)stack.push_back(&root);
+  while(!stack.empty()){
+    auto const node = stack.back();
+    stack.pop_back();
+    res += node->mesh >= (int32_t)model.meshes.size();
+    for(auto const&child:node->children)stack.push_back(&child);
+  }
+  return res;
+}
+
+}
+
+using namespace modelCacheTests;
+
+SCENARIO("51"){
+  std::cerr << "51 - binary model cache" << std::endl;
+
+  // separate arrays of positions and normals, texture coordinates in other buffer
+  std::vector<float>vertices = {
+    0.f,0.f,0.f, 1.f,0.f,0.f, 0.f,1.f,0.f, 1.f,1.f,.5f,
+    0.f,0.f,1.f, 0.f,1.f,0.f, 1.f,0.f,0.f, .5f,.5f,.5f,
+  };
+  std::vector<float>coords = {0.f,0.f, 1.f,0.f, 0.f,1.f, 1.f,1.f};
+  std::vector<uint16_t>indices = {7,7,0,1,2,2,1,3};
+
+  Model model;
+  model.buffers.push_back({vertices.data(),vertices.size()*sizeof(float)});
+  model.buffers.push_back({coords  .data(),coords  .size()*sizeof(float)});
+  model.buffers.push_back({indices .data(),indices .size()*sizeof(uint16_t)});
+
+  Mesh indexed;
+  indexed.position      = {0,sizeof(float)*3,0                  ,AttributeType::VEC3};
+  indexed.normal        = {0,sizeof(float)*3,sizeof(float)*3*4  ,AttributeType::VEC3};
+  indexed.texCoord      = {1,sizeof(float)*2,0                  ,AttributeType::VEC2};
+  indexed.indexBufferID = 2;
+  indexed.indexOffset   = 2*sizeof(uint16_t);
+  indexed.indexType     = IndexType::UINT16;
+  indexed.nofIndices    = 6;
+  indexed.diffuseTexture= 0;
+  Mesh plain;
+  plain.position     = {0,sizeof(float)*3,0,AttributeType::VEC3};
+  plain.nofIndices   = 3;
+  plain.diffuseColor = glm::vec4(1.f,0.f,.5f,1.f);
+  plain.doubleSided  = true;
+  model.meshes = {indexed,plain};
+
+  std::vector<uint8_t>texels(3*2*3);
+  for(size_t i=0;i<texels.size();++i)texels[i] = (uint8_t)(i*37);
+  Texture texture;
+  texture.data     = texels.data();
+  texture.width    = 3;
+  texture.height   = 2;
+  texture.channels = 3;
+  model.textures = {texture,Texture()};
+
+  Node leaf;
+  leaf.mesh = 1;
+  leaf.modelMatrix = glm::mat4(2.f);
+  Node root;
+  root.mesh = 0;
+  root.children = {leaf,leaf};
+  root.children[1].children = {leaf};
+  model.roots = {root,leaf};
+
+  auto const fileName = (std::filesystem::temp_directory_path()/"izgModelCacheTest.izgcache").string();
+  uint64_t const stamp = 0x1234;
+
+  bool const saved = saveModelCache(fileName,model,stamp);
+
+  ModelCache staleCache;
+  bool const staleLoaded = staleCache.load(fileName,stamp+1);
+
+  ModelCache cache;
+  bool const loaded = cache.load(fileName,stamp);
+  auto const cached = cache.getModel();
+
+  size_t differentMeshes = cached.meshes.size() != model.meshes.size();
+  for(size_t i=0;!differentMeshes && i<model.meshes.size();++i)
+    differentMeshes += compareMeshes(model,model.meshes[i],cached,cached.meshes[i]) != 0;
+
+  size_t const differentNodes = compareNodes(model.roots,cached.roots);
+
+  size_t differentTexels = cached.textures.size() != model.textures.size();
+  if(!differentTexels){
+    auto const&t = cached.textures[0];
+    differentTexels += t.width != 3 || t.height != 2 || t.channels != 4 || !t.levels || t.nofLevels != 2;
+    for(uint32_t i=0;!differentTexels && i<6;++i)
+      for(uint32_t c=0;c<4;++c)
+        differentTexels += t.data[i*4+c] != (c<3 ? texels[i*3+c] : 255);
+    differentTexels += cached.textures[1].data != nullptr || cached.textures[1].levels != nullptr;
+  }
+
+  // every word of corrupted cache is overwritten, loaded cache must not point outside of the file
+  std::vector<char>bytes;
+  {
+    std::ifstream file(fileName,std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(file),std::istreambuf_iterator<char>());
+  }
+  size_t   invalidReferences = 0;
+  uint32_t corruptedLoaded   = 0;
+  for(size_t w=0;w+4<=bytes.size();w+=4)
+    for(uint32_t value:{0xffffffffu,0xfffffffeu,0x7fffffffu,0x10000u,2u,1u}){
+      auto corrupted = bytes;
+      memcpy(corrupted.data()+w,&value,sizeof(value));
+      {
+        std::ofstream file(fileName,std::ios::binary|std::ios::trunc);
+        file.write(corrupted.data(),corrupted.size());
+      }
+      ModelCache corruptedCache;
+      if(!corruptedCache.load(fileName,stamp))continue;
+      corruptedLoaded++;
+      invalidReferences += countInvalidReferences(corruptedCache.getModel());
+    }
+
+  // model loaded from cache must not be returned after load of other file without cache
+  auto const gltfName = (std::filesystem::temp_directory_path()/"izgModelCacheTest.gltf").string();
+  {
+    std::ofstream file(gltfName,std::ios::trunc);
+    file << R".({
+      "asset":{"version":"2.0"},
+      "scene":0,
+      "scenes":[{"nodes":[0]}],
+      "nodes":[{"mesh":0}],
+      "meshes":[{"primitives":[{"attributes":{"POSITION":0}}]}],
+      "accessors":[{"bufferView":0,"componentType":5126,"count":3,"type":"VEC3","min":[0,0,0],"max":[1,1,0]}],
+      "bufferViews":[{"buffer":0,"byteLength":36}],
+      "buffers":[{"byteLength":36,"uri":"data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAA"}]
+    }).";
+  }
+  size_t cachedGltfMeshes = 0;
+  size_t reloadedMeshes   = 0;
+  {
+    ModelData modelData;
+    modelData.load(gltfName,true);
+    modelData.load(gltfName,true);
+    cachedGltfMeshes = modelData.getModel().meshes.size();
+    modelData.load(gltfName+".missing",false);
+    reloadedMeshes = modelData.getModel().meshes.size();
+  }
+
+  std::error_code ec;
+  std::filesystem::remove(fileName,ec);
+  std::filesystem::remove(gltfName,ec);
+  std::filesystem::remove(gltfName+".izgcache",ec);
+
+  if(saved && !staleLoaded && loaded && differentMeshes == 0 && differentNodes == 0 && differentTexels == 0 && invalidReferences == 0 && cachedGltfMeshes == 1 && reloadedMeshes == 0)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test uloží malý model (indexovaný a neindexovaný mesh, 2 textury a strom uzlů) do binární cache
+  a načte ho zpět pomocí ModelCache.
+  Načtený model musí mít stejné vrcholy, meshe a strom uzlů, textury musí být v RGBA8
+  a cache s jiným razítkem zdrojového souboru se nesmí načíst.
+  Poškozená cache (přepsané slovo souboru) se buď nesmí načíst, nebo nesmí odkazovat mimo soubor
+  a nesmí obsahovat neplatnou texturu nebo neplatnou hodnotu doubleSided.
+  ModelData po načtení neexistujícího souboru nesmí vracet model načtený dříve z cache.
+
+  Cache zapsána: )." << saved << R".(
+  Načtena cache se starým razítkem: )." << staleLoaded << R".(
+  Cache načtena: )." << loaded << R".(
+  Počet rozdílných meshů: )." << differentMeshes << R".(
+  Počet rozdílných uzlů: )." << differentNodes << R".(
+  Počet rozdílných texelů: )." << differentTexels << R".(
+  Počet načtených poškozených cache: )." << corruptedLoaded << R".(
+  Počet neplatných odkazů v poškozených cache: )." << invalidReferences << R".(
+  Počet meshů glTF modelu načteného z cache: )." << cachedGltfMeshes << R".(
+  Počet meshů po načtení neexistujícího souboru: )." << reloadedMeshes << std::endl;
+  REQUIRE(false);
+}
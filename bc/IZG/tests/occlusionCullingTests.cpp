@@ -0,0 +1,198 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iostream>
+#include <string.h>
+
+#include <framework/occlusionCulling.hpp>
+#include <framework/framebuffer.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <tests/testCommon.hpp>
+
+using namespace tests;
+
+namespace occlusionCullingTests{
+
+/// uniforms[0] is view projection matrix, uniforms[1+gl_DrawID] is model matrix of the draw
+void vertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface const&si){
+  outVertex.gl_Position = si.uniforms[0].m4*si.uniforms[1+inVertex.gl_DrawID].m4*glm::vec4(inVertex.attributes[0].v3,1.f);
+  outVertex.attributes[0].u1 = inVertex.gl_DrawID;
+}
+
+void fragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&){
+  auto const d = (float)inFragment.attributes[0].u1;
+  outFragment.gl_FragColor = glm::vec4(glm::fract(d*.37f),glm::fract(d*.71f),glm::fract(d*.13f),1.f);
+}
+
+}
+
+SCENARIO("59"){
+  std::cerr << "59 - occlusion culling" << std::endl;
+
+  // mesh 0 is wall quad, mesh 1 is small quad
+  std::vector<glm::vec3>wall = {glm::vec3(-1.f,-1.f,0.f),glm::vec3(1.f,-1.f,0.f),glm::vec3(-1.f,1.f,0.f),glm::vec3(-1.f,1.f,0.f),glm::vec3(1.f,-1.f,0.f),glm::vec3(1.f,1.f,0.f)};
+  std::vector<glm::vec3>box;
+  for(auto const&v:wall)box.push_back(v*.1f);
+
+  Model model;
+  model.buffers.push_back({wall.data(),wall.size()*sizeof(glm::vec3)});
+  model.buffers.push_back({box .data(),box .size()*sizeof(glm::vec3)});
+  for(int32_t b=0;b<2;++b){
+    Mesh mesh;
+    mesh.position   = {b,sizeof(glm::vec3),0,AttributeType::VEC3};
+    mesh.nofIndices = 6;
+    model.meshes.push_back(mesh);
+  }
+
+  // wall in front of the camera, small quad behind the wall, next to the wall and in front of the wall
+  glm::vec3 const positions[] = {glm::vec3(0.f,0.f,-5.f),glm::vec3(0.f,0.f,-10.f),glm::vec3(8.f,0.f,-10.f),glm::vec3(.5f,0.f,-3.f)};
+  for(uint32_t i=0;i<4;++i){
+    Node node;
+    node.mesh        = i == 0 ? 0 : 1;
+    node.modelMatrix = glm::translate(glm::mat4(1.f),positions[i]);
+    model.roots.push_back(node);
+  }
+
+  MEMCB();
+  std::vector<MeshInstance>instances;
+  prepareModel(mem,cb,model,instances);
+
+  auto const viewProjection = glm::perspective(glm::radians(90.f),2.f,.1f,100.f);
+  auto const drawn = [&](uint32_t i){return cb.commands[instances.at(i).drawCommand].data.drawCommand.nofVertices;};
+  auto const reset = [&](){for(auto const&instance:instances)cb.commands[instance.drawCommand].data.drawCommand.nofVertices = 6;};
+
+  OcclusionCulling occlusion(model);
+  reset();
+  auto const occluded = occlusion.cull(cb,instances,viewProjection);
+  bool const occludedOk = instances.size() == 4 && occluded == 1 && drawn(0) == 6 && drawn(1) == 0 && drawn(2) == 6 && drawn(3) == 6 && occlusion.nofOccluders == 1;
+
+  // wall seen from behind is culled by back face culling, so it does not occlude
+  reset();
+  auto const behind = viewProjection*glm::lookAt(glm::vec3(0.f,0.f,-15.f),glm::vec3(0.f,0.f,0.f),glm::vec3(0.f,1.f,0.f));
+  auto const backFaceOccluded = occlusion.cull(cb,instances,behind);
+
+  // buffer of the previous frame is empty in the first frame, the second frame uses the first one
+  OcclusionCulling previous(model);
+  reset();
+  auto const firstFrame  = previous.cull(cb,instances,viewProjection,true);
+  reset();
+  auto const secondFrame = previous.cull(cb,instances,viewProjection,true);
+  bool const previousOk = firstFrame == 0 && secondFrame == 1 && drawn(1) == 0;
+
+  if(occludedOk && backFaceOccluded == 0 && previousOk)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vytvoří model se čtvercovou stěnou a třemi malými čtverci: za stěnou, vedle stěny a před stěnou.
+  OcclusionCulling::cull musí vypnout kreslící příkaz jen malého čtverce za stěnou,
+  stěna viděná zezadu se neukládá (back face culling) a nic nezakrývá.
+  S hloubkovým bufferem předchozího snímku se v prvním snímku nic nezakryje a ve druhém se zakryje čtverec za stěnou.
+
+  Počet instancí: )." << instances.size() << R".(
+  Počet zakrytých instancí: )." << occluded << R".(
+  Počet zakrývajících instancí: )." << occlusion.nofOccluders << R".(
+  Kreslené vrcholy instancí: )." << drawn(0) << " " << drawn(1) << " " << drawn(2) << " " << drawn(3) << R".(
+  Počet zakrytých instancí při pohledu zezadu: )." << backFaceOccluded << R".(
+  Počet zakrytých instancí v prvním a druhém snímku s předchozím bufferem: )." << firstFrame << " " << secondFrame << std::endl;
+  REQUIRE(false);
+}
+
+SCENARIO("60"){
+  std::cerr << "60 - occlusion culling does not change image" << std::endl;
+
+  // indexed cube, grid of cubes of different sizes and walls made of scaled cubes
+  std::vector<glm::vec3>vertices;
+  for(int i=0;i<8;++i)vertices.emplace_back(i&1?1.f:-1.f,i&2?1.f:-1.f,i&4?1.f:-1.f);
+  std::vector<uint32_t>indices = {0,2,1,1,2,3, 4,5,6,5,7,6, 0,1,4,1,5,4, 2,6,3,3,6,7, 0,4,2,2,4,6, 1,3,5,3,7,5};
+
+  Model model;
+  model.buffers.push_back({vertices.data(),vertices.size()*sizeof(glm::vec3)});
+  model.buffers.push_back({indices .data(),indices .size()*sizeof(uint32_t )});
+  Mesh mesh;
+  mesh.position      = {0,sizeof(glm::vec3),0,AttributeType::VEC3};
+  mesh.indexBufferID = 1;
+  mesh.indexType     = IndexType::UINT32;
+  mesh.nofIndices    = (uint32_t)indices.size();
+  model.meshes.push_back(mesh);
+
+  for(int x=0;x<8;++x)
+    for(int z=0;z<8;++z){
+      Node node;
+      node.mesh        = 0;
+      node.modelMatrix = glm::scale(glm::translate(glm::mat4(1.f),glm::vec3(x*4-14,1,z*4-14)),glm::vec3(.5f+.3f*((x*7+z*3)%4)));
+      model.roots.push_back(node);
+    }
+  for(int w=0;w<4;++w){
+    Node node;
+    node.mesh        = 0;
+    node.modelMatrix = glm::scale(glm::translate(glm::mat4(1.f),glm::vec3(w*8-12,3,(w%2)*10-5)),w%2?glm::vec3(.3f,3.f,8.f):glm::vec3(8.f,3.f,.3f));
+    model.roots.push_back(node);
+  }
+
+  MEMCB();
+  std::vector<MeshInstance>instances;
+  prepareModel(mem,cb,model,instances);
+
+  // draws are opaque and use test shaders
+  uint32_t drawID = 0;
+  for(auto&command:cb.commands){
+    if(command.type != CommandType::DRAW)continue;
+    command.data.drawCommand.blendMode = BlendMode::NONE;
+    for(auto const&instance:instances)
+      if(&cb.commands[instance.drawCommand] == &command)
+        mem.uniforms[1+drawID].m4 = instance.modelMatrix;
+    ++drawID;
+  }
+  mem.programs[0].vertexShader   = occlusionCullingTests::vertexShader;
+  mem.programs[0].fragmentShader = occlusionCullingTests::fragmentShader;
+
+  uint32_t const width  = 160;
+  uint32_t const height = 80;
+  auto const proj = glm::perspective(glm::radians(60.f),2.f,.1f,200.f);
+
+  OcclusionCulling occlusion(model);
+  size_t   differentPixels = 0;
+  uint32_t occluded        = 0;
+  uint32_t visible         = 0;
+  for(uint32_t i=0;i<24;++i){
+    float const t = i*.26f;
+    auto const eye    = glm::vec3(16.f*glm::cos(t),1.5f+glm::sin(3.f*t),16.f*glm::sin(t));
+    auto const target = glm::vec3(4.f*glm::sin(2.f*t),0.f,4.f*glm::cos(t));
+    auto const viewProjection = proj*glm::lookAt(eye,target,glm::vec3(0.f,1.f,0.f));
+    mem.uniforms[0].m4 = viewProjection;
+
+    Framebuffer expected(width,height);
+    visible += (uint32_t)instances.size()-cullModel(cb,model,instances,viewProjection);
+    mem.framebuffer = expected.getFrame();
+    gpu_execute(mem,cb);
+
+    Framebuffer culled(width,height);
+    occluded += occlusion.cull(cb,instances,viewProjection);
+    mem.framebuffer = culled.getFrame();
+    gpu_execute(mem,cb);
+
+    auto const expectedFrame = expected.getFrame();
+    auto const culledFrame   = culled  .getFrame();
+    for(uint32_t y=0;y<height;++y)
+      for(uint32_t x=0;x<width;++x){
+        auto const pix = glm::uvec2(x,y);
+        differentPixels += getColor(expectedFrame,pix) != getColor(culledFrame,pix) || readDepth(expectedFrame,pix) != readDepth(culledFrame,pix);
+      }
+  }
+
+  if(differentPixels == 0 && occluded > 0 && occluded < visible)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test kreslí mřížku krychlí a několik stěn z různých pohledů s neprůhlednými shadery
+  nejdříve jen s ořezem pohledovým tělesem (cullModel) a pak i s OcclusionCulling::cull.
+  Vypnuté kreslící příkazy zakrytých instancí nesmí změnit výsledný obraz ani hloubku
+  a alespoň některé instance se musí zakrýt.
+
+  Počet rozdílných pixelů: )." << differentPixels << R".(
+  Počet instancí v pohledovém tělese: )." << visible << R".(
+  Počet zakrytých instancí: )." << occluded << std::endl;
+  REQUIRE(false);
+}
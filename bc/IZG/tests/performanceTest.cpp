@@ -7,19 +7,53 @@
 
 #include <BasicCamera/OrbitCamera.h>
 #include <BasicCamera/PerspectiveCamera.h>
+#include <glm/gtc/matrix_transform.hpp>
 #include <examples/modelMethod.hpp>
+#include <framework/bunny.hpp>
 #include <framework/timer.hpp>
 #include <framework/framebuffer.hpp>
+#include <framework/programContext.hpp>
 #include <tests/performanceTest.hpp>
 
 #define ___ std::cerr << __FILE__ << "/" << __LINE__ << std::endl
 
+namespace{
+
+uint32_t const nofPrepassBunnies = 8;///< overlapping bunnies of depth prepass measurement
+
+/**
+ * @brief This vertex shader moves every bunny closer to camera, so later draws cover earlier ones.
+ */
+void prepassVertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface const&si){
+  auto const d   = (float)inVertex.gl_DrawID;
+  auto const pos = inVertex.attributes[0].v3+glm::vec3(.04f*d-.14f,0.f,.1f*d);
+  outVertex.gl_Position = si.uniforms[0].m4*glm::vec4(pos,1.f);
+  outVertex.attributes[0].v3 = pos;
+  outVertex.attributes[1].v3 = inVertex.attributes[1].v3;
+}
+
+/**
+ * @brief This fragment shader computes phong lighting of the bunny.
+ */
+void prepassFragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&si){
+  auto const pos = inFragment.attributes[0].v3;
+  auto const nor = glm::normalize(inFragment.attributes[1].v3);
+  auto const l   = glm::normalize(si.uniforms[1].v3-pos);
+  auto const v   = glm::normalize(si.uniforms[2].v3-pos);
+  auto const diffuse  = glm::max(glm::dot(l,nor),0.f);
+  auto const specular = glm::pow(glm::max(glm::dot(-glm::reflect(v,nor),l),0.f),40.f);
+  outFragment.gl_FragColor = glm::vec4(glm::min(glm::vec3(0.f,.8f,.2f)*diffuse+specular,glm::vec3(1.f)),1.f);
+}
+
+}
+
 void runPerformanceTest(size_t framesPerMeasurement) {
   uint32_t width = 500;
   uint32_t height = 500;
   auto method = std::make_shared<modelMethod::Method>();
 
-  auto framebuffer = std::make_shared<Framebuffer>(width,height);
+  auto const tiled = ProgramContext::get().args.tiledFramebuffer;
+  auto framebuffer = std::make_shared<Framebuffer>(width,height,tiled);
   auto frame = framebuffer->getFrame();
 
   auto perspectiveCamera = basicCamera::PerspectiveCamera();
@@ -37,6 +71,7 @@ void runPerformanceTest(size_t framesPerMeasurement) {
   auto const camera = glm::vec3(glm::inverse(view)*glm::vec4(0.f,0.f,0.f,1.f));
 
 
+  gpu_resetCounters();
   Timer<float>timer;
   timer.reset();
   SceneParam sceneParam;
@@ -50,7 +85,101 @@ void runPerformanceTest(size_t framesPerMeasurement) {
   }
   auto const time = timer.elapsedFromStart() / static_cast<float>(framesPerMeasurement);
 
+  std::cout << "Threads: " << gpu_getSettings().nofThreads << std::endl;
+  std::cout << "Tiled framebuffer: " << (tiled ? "yes" : "no") << std::endl;
   std::cout << "Seconds per frame: " << std::scientific << std::setprecision(10)
             << time << std::endl;
 
+  auto const&counters = gpu_getCounters();
+  std::cout << "Covered fragments: "                  << counters.coveredFragments        << std::endl;
+  std::cout << "Shaded fragments: "                   << counters.shadedFragments         << std::endl;
+  std::cout << "Fragments killed by early depth: "    << counters.earlyDepthKilled        << std::endl;
+  std::cout << "Tiles killed by hierarchical depth: " << counters.hierarchicalDepthKilled << std::endl;
+  std::cout << "Vertex shader invocations: "          << counters.vertexShaderInvocations << std::endl;
+  std::cout << "Triangles rejected by clipping: "     << counters.clipRejectedTriangles   << std::endl;
+  std::cout << "Clipped triangles: "                  << counters.clippedTriangles        << std::endl;
+  std::cout << "Vertex cache hit rate: "              << std::fixed << std::setprecision(3)
+            << (counters.vertexCacheLookups ? (float)counters.vertexCacheHits/counters.vertexCacheLookups : 0.f) << std::endl;
+
+}
+
+void runClearPerformanceTest(size_t framesPerMeasurement) {
+  uint32_t width  = 3840;
+  uint32_t height = 2160;
+
+  auto const tiled = ProgramContext::get().args.tiledFramebuffer;
+  auto framebuffer = std::make_shared<Framebuffer>(width,height,tiled);
+  GPUMemory mem;
+  mem.framebuffer = framebuffer->getFrame();
+
+  auto commandBuffer = std::make_unique<CommandBuffer>();
+  pushClearCommand(*commandBuffer,glm::vec4(.1f,.2f,.3f,1.f),1e10f);
+
+  gpu_execute(mem,*commandBuffer);
+
+  Timer<float>timer;
+  timer.reset();
+  for (size_t i = 0; i < framesPerMeasurement; ++i)
+    gpu_execute(mem,*commandBuffer);
+  auto const time = timer.elapsedFromStart() / static_cast<float>(framesPerMeasurement);
+
+  std::cout << "Clear " << width << "x" << height << " seconds per frame: "
+            << std::scientific << std::setprecision(10) << time << std::endl;
+}
+
+void runDepthPrepassPerformanceTest(size_t framesPerMeasurement) {
+  uint32_t width  = 1024;
+  uint32_t height = 768;
+
+  auto const tiled = ProgramContext::get().args.tiledFramebuffer;
+  auto framebuffer = std::make_shared<Framebuffer>(width,height,tiled);
+  auto mem = std::make_unique<GPUMemory>();
+  mem->framebuffer = framebuffer->getFrame();
+  mem->buffers[0].data = (void const*)bunnyVertices;
+  mem->buffers[0].size = sizeof(bunnyVertices);
+  mem->buffers[1].data = (void const*)bunnyIndices;
+  mem->buffers[1].size = sizeof(bunnyIndices);
+  mem->programs[0].vertexShader   = prepassVertexShader;
+  mem->programs[0].fragmentShader = prepassFragmentShader;
+  mem->programs[0].vs2fs[0]       = AttributeType::VEC3;
+  mem->programs[0].vs2fs[1]       = AttributeType::VEC3;
+
+  auto const camera = glm::vec3(0.f,.1f,3.f);
+  auto const proj   = glm::perspective(glm::radians(45.f),static_cast<float>(width)/static_cast<float>(height),.1f,10.f);
+  auto const view   = glm::lookAt(camera,glm::vec3(0.f,.1f,0.f),glm::vec3(0.f,1.f,0.f));
+  mem->uniforms[0].m4 = proj*view;
+  mem->uniforms[1].v3 = glm::vec3(10.f,10.f,10.f);
+  mem->uniforms[2].v3 = camera;
+
+  VertexArray vao;
+  vao.vertexAttrib[0] = {0,sizeof(BunnyVertex),0                ,AttributeType::VEC3};
+  vao.vertexAttrib[1] = {0,sizeof(BunnyVertex),sizeof(glm::vec3),AttributeType::VEC3};
+  vao.indexBufferID   = 1;
+  vao.indexType       = IndexType::UINT32;
+
+  // bunnies are drawn from back to front, which is the worst case for shading without prepass
+  auto commandBuffer = std::make_unique<CommandBuffer>();
+  pushClearCommand(*commandBuffer,glm::vec4(.5f,.5f,.5f,1.f));
+  for (uint32_t i = 0; i < nofPrepassBunnies; ++i)
+    pushDrawCommand(*commandBuffer,sizeof(bunnyIndices)/sizeof(VertexIndex),0,vao,true,BlendMode::NONE);
+
+  auto const pixels = static_cast<float>(width*height*std::max(framesPerMeasurement,(size_t)1));
+  for (bool depthPrepass : {false,true}){
+    commandBuffer->depthPrepass = depthPrepass;
+    gpu_execute(*mem,*commandBuffer);
+
+    gpu_resetCounters();
+    Timer<float>timer;
+    timer.reset();
+    for (size_t i = 0; i < framesPerMeasurement; ++i)
+      gpu_execute(*mem,*commandBuffer);
+    auto const time = timer.elapsedFromStart() / static_cast<float>(framesPerMeasurement);
+    auto const&counters = gpu_getCounters();
+
+    std::cout << nofPrepassBunnies << " bunnies " << width << "x" << height << (depthPrepass ? " with" : " without") << " depth prepass seconds per frame: "
+              << std::scientific << std::setprecision(10) << time << std::endl;
+    std::cout << "  Covered fragments per pixel: " << std::fixed << std::setprecision(3) << counters.coveredFragments/pixels << std::endl;
+    std::cout << "  Shaded fragments per pixel: "  << counters.shadedFragments /pixels << std::endl;
+    std::cout << "  Depth prepass fragments per pixel: " << counters.prepassFragments/pixels << std::endl;
+  }
 }
@@ -3,4 +3,6 @@
 #include <iostream>
 
 void runPerformanceTest(size_t framesPerMeasurement = 100);
+void runClearPerformanceTest(size_t framesPerMeasurement = 100);
+void runDepthPrepassPerformanceTest(size_t framesPerMeasurement = 100);
 
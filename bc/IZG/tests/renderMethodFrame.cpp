@@ -15,7 +15,7 @@
 std::vector<uint8_t>renderMethodFrame(uint32_t width,uint32_t height){
   auto method = std::make_shared<modelMethod::Method>();
 
-  auto framebuffer = std::make_shared<Framebuffer>(width,height);
+  auto framebuffer = std::make_shared<Framebuffer>(width,height,ProgramContext::get().args.tiledFramebuffer);
 
   auto orbitCamera       = basicCamera::OrbitCamera();
   auto perspectiveCamera = basicCamera::PerspectiveCamera();
@@ -43,8 +43,11 @@ std::vector<uint8_t>renderMethodFrame(uint32_t width,uint32_t height){
   if(f == nullptr)
     return std::vector<uint8_t>(4*width*height);
 
-  for(uint32_t i=0;i<w*h*4;++i)
-    res.push_back(f[i]);
+  // tiled frame is resolved to linear layout
+  for(uint32_t y=0;y<h;++y)
+    for(uint32_t x=0;x<w;++x)
+      for(uint32_t c=0;c<4;++c)
+        res.push_back(f[getPixelIndex(frame,x,y)*4+c]);
 
   return res;
 }
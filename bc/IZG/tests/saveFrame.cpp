@@ -3,9 +3,9 @@
 #include <SDL.h>
 
 void saveFrame(std::string const&file,Frame const&frame){
-  auto surface = SDL_CreateRGBSurface(0, frame.width, frame.height, 24,0,0,0,0);
+  auto surface = SDL_CreateRGBSurfaceWithFormat(0, frame.width, frame.height, 32, SDL_PIXELFORMAT_XBGR8888);
 
-  copyToSDLSurface(surface,frame.color,frame.width,frame.height);
+  copyToSDLSurface(surface,frame);
 
   SDL_Surface* rgb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
   SDL_SaveBMP(rgb, file.c_str());
@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iostream>
+#include <string.h>
+
+#include <framework/framebuffer.hpp>
+#include <framework/application.hpp>
+
+#include <tests/testCommon.hpp>
+
+using namespace tests;
+
+namespace surfaceTests{
+
+/**
+ * @brief This function reads pixel of SDL surface.
+ *
+ * @param surface surface
+ * @param x x coordinate
+ * @param y y coordinate
+ *
+ * @return pixel value
+ */
+uint32_t readPixel(SDL_Surface const*surface,uint32_t x,uint32_t y){
+  uint32_t res = 0;
+  memcpy(&res,(uint8_t const*)surface->pixels+(size_t)y*surface->pitch+(size_t)x*surface->format->BytesPerPixel,surface->format->BytesPerPixel);
+  return res;
+}
+
+/**
+ * @brief This function copies frame to surface and compares every pixel with frame.
+ *
+ * @param framebuffer framebuffer
+ * @param format SDL pixel format of surface
+ *
+ * @return number of different pixels
+ */
+size_t compareSurface(Framebuffer&framebuffer,uint32_t format){
+  auto const frame = framebuffer.getFrame();
+  auto surface = SDL_CreateRGBSurfaceWithFormat(0,frame.width,frame.height,32,format);
+  if(!surface)return (size_t)frame.width*frame.height;
+
+  copyToSDLSurface(surface,frame);
+
+  size_t res = 0;
+  for(uint32_t y=0;y<frame.height;++y)
+    for(uint32_t x=0;x<frame.width;++x){
+      uint8_t r,g,b,a;
+      SDL_GetRGBA(readPixel(surface,x,frame.height-1-y),surface->format,&r,&g,&b,&a);
+      auto const c = frame.color+getPixelIndex(frame,x,y)*4;
+      auto const expectedAlpha = surface->format->Amask ? c[3] : 255;
+      res += r != c[0] || g != c[1] || b != c[2] || a != expectedAlpha;
+    }
+
+  SDL_FreeSurface(surface);
+  return res;
+}
+
+}
+
+using namespace surfaceTests;
+
+SCENARIO("55"){
+  std::cerr << "55 - copy of frame to SDL surface" << std::endl;
+
+  uint32_t const formats[] = {
+    SDL_PIXELFORMAT_ABGR8888,
+    SDL_PIXELFORMAT_XBGR8888,
+    SDL_PIXELFORMAT_ARGB8888,
+    SDL_PIXELFORMAT_XRGB8888,
+    SDL_PIXELFORMAT_RGBA8888,
+    SDL_PIXELFORMAT_RGB24   ,
+    SDL_PIXELFORMAT_BGR24   ,
+  };
+
+  for(auto const tiled:{false,true}){
+    // odd size that is not multiple of tile size or simd width
+    Framebuffer framebuffer(21,11,tiled);
+    for(size_t i=0;i<framebuffer.color.size();++i)
+      framebuffer.color[i] = (uint8_t)((i*7919u+(i/5)*104729u)%251u);
+
+    for(auto const format:formats){
+      auto const different = compareSurface(framebuffer,format);
+      if(different == 0)continue;
+
+      std::cerr << R".(
+      TEST SELHAL!
+
+      Tento test kopíruje snímek o velikosti 21x11 pomocí funkce copyToSDLSurface do SDL surface v různých formátech.
+      Řádky musí být převrácené (snímek má počátek vlevo dole), kanály R, G, B musí odpovídat formátu surface
+      a surface s alfa kanálem musí obsahovat alfu snímku.
+
+      Dlaždicový snímek: )." << tiled << R".(
+      Formát surface: )." << SDL_GetPixelFormatName(format) << R".(
+      Počet rozdílných pixelů: )." << different << std::endl;
+      REQUIRE(false);
+    }
+  }
+}
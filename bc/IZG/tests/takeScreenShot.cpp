@@ -12,30 +12,21 @@ void takeScreenShot(std::string const&groundTruthFile){
   uint32_t height = 500;
 
 
-  auto frame = renderMethodFrame(width,height);
+  auto pixels = renderMethodFrame(width,height);
 
-  for(uint32_t y=0;y<height/2;++y)
-    for(uint32_t x=0;x<width;++x){
-      for(uint32_t c=0;c<3;++c){
-        auto z=frame.at((y*width+x)*4+c);
-        frame.at((y*width+x)*4+c) = frame.at(((height-1-y)*width+x)*4+c);
-        frame.at(((height-1-y)*width+x)*4+c) = z;
-      }
-      frame.at(((         y)*width+x)*4+3)=255;
-      frame.at(((height-1-y)*width+x)*4+3)=255;
-    }
+  Frame frame;
+  frame.color  = pixels.data();
+  frame.width  = width;
+  frame.height = height;
 
-  stbi_write_png(groundTruthFile.c_str(),width,height,4,frame.data(),0);
+  // rows are flipped and alpha is set to 255 by the surface without alpha channel
+  auto surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_XBGR8888);
 
-  //auto surface = SDL_CreateRGBSurface(0, width, height, 24,0,0,0,0);
+  copyToSDLSurface(surface,frame);
 
-  //copyToSDLSurface(surface,frame.data(),width,height);
+  stbi_write_png(groundTruthFile.c_str(),width,height,4,surface->pixels,surface->pitch);
 
-  std::cerr << "storing screenshot to: \"" << groundTruthFile << "\"" << std::endl;
-
-  //SDL_Surface* rgb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
-  //SDL_SaveBMP(rgb, groundTruthFile.c_str());
-  //SDL_FreeSurface(rgb);
-  //SDL_FreeSurface(surface);
+  SDL_FreeSurface(surface);
 
+  std::cerr << "storing screenshot to: \"" << groundTruthFile << "\"" << std::endl;
 }
@@ -148,10 +148,19 @@ template<>std::string str(AttributeType const&a){
     default: return "unknown";
   }
 }
+template<>std::string str(BlendMode const&a){
+  switch(a){
+    case BlendMode::FRAGMENT_ALPHA:return "BlendMode::FRAGMENT_ALPHA";
+    case BlendMode::NONE          :return "BlendMode::NONE"          ;
+    case BlendMode::ALPHA         :return "BlendMode::ALPHA"         ;
+    default: return "unknown";
+  }
+}
 template<> std::string str(CommandType const&a){
   switch(a){
-    case CommandType::CLEAR:return "clear";
-    case CommandType::DRAW :return "draw" ;
+    case CommandType::CLEAR   :return "clear"   ;
+    case CommandType::DRAW    :return "draw"    ;
+    case CommandType::LIGHTING:return "lighting";
     default:return "unknown";
   }
 }
@@ -181,7 +190,7 @@ uint8_t floatColorToByte(float c){
 }
 
 glm::uvec4 getColor(Frame const&frame,glm::uvec2 const&pix){
-  auto const colorStart = (pix.y*frame.width+pix.x)*frame.channels;
+  auto const colorStart = getPixelIndex(frame,pix.x,pix.y)*frame.channels;
   auto res = glm::uvec4(0);
   for(uint32_t i=0;i<frame.channels;++i)
     res[i] = frame.color[colorStart+i];
@@ -189,17 +198,17 @@ glm::uvec4 getColor(Frame const&frame,glm::uvec2 const&pix){
 }
 
 void writeColor(Frame&frame,glm::uvec2 const&pix,glm::uvec4 const&c){
-  auto const colorStart = (pix.y*frame.width+pix.x)*frame.channels;
+  auto const colorStart = getPixelIndex(frame,pix.x,pix.y)*frame.channels;
   for(uint32_t i=0;i<frame.channels;++i)
     frame.color[colorStart+i] = c[i];
 }
 
 float getDepth(Frame const&frame,glm::uvec2 const&pix){
-  return frame.depth[pix.y*frame.width+pix.x];
+  return frame.depth[getPixelIndex(frame,pix.x,pix.y)];
 }
 
 void  writeDepth(Frame&frame,glm::uvec2 const&pix,float d){
-  frame.depth[pix.y*frame.width+pix.x] = d;
+  frame.depth[getPixelIndex(frame,pix.x,pix.y)] = d;
 }
 
 glm::uvec4 floatColorToBytes(glm::vec4 const&col){
@@ -748,7 +757,7 @@ void fragmentShaderEmpty(OutFragment&,InFragment const&,ShaderInterface const&){
 void clearFrame(Frame&frame,glm::uvec3 const&color,float d){
   for(uint32_t y=0;y<frame.height;++y)
     for(uint32_t x=0;x<frame.width;++x){
-      auto pix = y*frame.width+x;
+      auto pix = getPixelIndex(frame,x,y);
       for(uint32_t c=0;c<3;++c)
         frame.color[pix*4+c] = color[c];
       frame.color[pix*4+3] = 0;
@@ -761,12 +770,12 @@ void clearFrame(Frame&frame,glm:: vec3 const&c,float d){
 }
 
 glm::uvec3 readColor(Frame const&frame,glm::uvec2 const&coord){
-  auto pix = coord.y*frame.width + coord.x;
+  auto pix = getPixelIndex(frame,coord.x,coord.y);
   return glm::uvec3(frame.color[pix*4+0],frame.color[pix*4+1],frame.color[pix*4+2]);
 }
 
 float      readDepth(Frame const&frame,glm::uvec2 const&coord){
-  auto pix = coord.y*frame.width + coord.x;
+  auto pix = getPixelIndex(frame,coord.x,coord.y);
   return frame.depth[pix];
 }
 
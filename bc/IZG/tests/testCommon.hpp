@@ -57,6 +57,7 @@ template<> std::string str(glm::ivec4 const&a);
 template<> std::string str(glm::mat4 const&m);
 template<> std::string str(IndexType const&i);
 template<> std::string str(AttributeType const&a);
+template<> std::string str(BlendMode const&a);
 template<> std::string str(CommandType const&a);
 std::string padding(size_t n=2);
 
@@ -0,0 +1,169 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iostream>
+#include <string.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include <student/gpu.hpp>
+#include <framework/framebuffer.hpp>
+#include <framework/textureData.hpp>
+
+#include <tests/testCommon.hpp>
+
+using namespace tests;
+
+namespace textureTests{
+
+/**
+ * @brief This function fills texture with pseudo random texels.
+ *
+ * @param d texture
+ */
+void generateTexture(TextureData&d){
+  for(size_t i=0;i<d.data.size();++i)
+    d.data[i] = (uint8_t)((i*7919u+(i/3)*104729u)%251u);
+}
+
+/**
+ * @brief This vertex shader generates fullscreen quad with uv coordinates repeated 4 times.
+ */
+void vertexShader(OutVertex&outVertex,InVertex const&inVertex,ShaderInterface const&){
+  glm::vec2 const verts[]={
+    glm::vec2(-1.f,-1.f),
+    glm::vec2(+1.f,-1.f),
+    glm::vec2(-1.f,+1.f),
+    glm::vec2(-1.f,+1.f),
+    glm::vec2(+1.f,-1.f),
+    glm::vec2(+1.f,+1.f),
+  };
+  outVertex.gl_Position = glm::vec4(verts[inVertex.gl_VertexID],0.f,1.f);
+  outVertex.attributes[0].v2 = (glm::vec2(outVertex.gl_Position)+1.f)*2.f;
+}
+
+/**
+ * @brief This fragment shader stores derivatives of uv coordinates into color.
+ */
+void fragmentShader(OutFragment&outFragment,InFragment const&inFragment,ShaderInterface const&){
+  outFragment.gl_FragColor = glm::vec4(inFragment.dFdx[0].x*16.f,inFragment.dFdy[0].y*16.f,inFragment.dFdx[0].y+inFragment.dFdy[0].x+.5f,1.f);
+}
+
+/**
+ * @brief This function renders quad that stores derivatives of uv coordinates.
+ *
+ * @param framebuffer output framebuffer
+ */
+void renderDerivatives(Framebuffer&framebuffer){
+  MEMCB();
+  mem.framebuffer = framebuffer.getFrame();
+  mem.programs[0].vertexShader   = vertexShader;
+  mem.programs[0].fragmentShader = fragmentShader;
+  mem.programs[0].vs2fs[0]       = AttributeType::VEC2;
+  mem.programs[0].derivatives    = true;
+
+  pushClearCommand(cb,glm::vec4(0.f));
+  pushDrawCommand (cb,6,0);
+  gpu_execute(mem,cb);
+}
+
+}
+
+using namespace textureTests;
+
+SCENARIO("49"){
+  std::cerr << "49 - texture mipmaps" << std::endl;
+
+  auto raw      = TextureData(100,60,3);
+  auto prepared = TextureData(100,60,3);
+  generateTexture(raw);
+  prepared.data = raw.data;
+  prepared.prepare();
+
+  auto const rawTexture      = raw     .getTexture();
+  auto const preparedTexture = prepared.getTexture();
+
+  size_t differentTexels = 0;
+  for(uint32_t i=0;i<1000;++i){
+    auto const uv = glm::vec2((float)(i%37)/17.f-.5f,(float)(i%41)/19.f-.7f);
+    differentTexels += read_texture        (rawTexture,uv) != read_texture        (preparedTexture,uv);
+    differentTexels += read_textureBilinear(rawTexture,uv) != read_textureBilinear(preparedTexture,uv);
+    differentTexels += read_textureLod(preparedTexture,uv,0.f) != read_textureBilinear(preparedTexture,uv);
+  }
+
+  // 100x60, 50x30, 25x15, 12x7, 6x3, 3x1, 1x1
+  bool levelsOk = preparedTexture.nofLevels == 7;
+  for(uint32_t l=0;l<preparedTexture.nofLevels;++l)
+    levelsOk &= preparedTexture.levels[l].width == std::max(100u>>l,1u) && preparedTexture.levels[l].height == std::max(60u>>l,1u);
+
+  // texel of level 1 is rounded average of 2x2 texels of level 0
+  size_t differentAverages = 0;
+  for(uint32_t y=0;levelsOk && y<30;++y)
+    for(uint32_t x=0;x<50;++x)
+      for(uint32_t c=0;c<3;++c){
+        uint32_t sum = 2;
+        for(uint32_t j=0;j<4;++j)
+          sum += raw.data[((2*y+j/2)*100+2*x+j%2)*3+c];
+        auto const&level = preparedTexture.levels[1];
+        differentAverages += level.data[getTexelIndex(level,x,y)*4+c] != sum/4;
+      }
+
+  if(differentTexels == 0 && levelsOk && differentAverages == 0)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test připraví texturu 100x60 (3 kanály) do mip pyramidy v RGBA8 uložené po dlaždicích.
+  Vzorkování úrovně 0 musí dát stejné barvy jako vzorkování původní textury,
+  úrovně musí mít poloviční velikost a jejich texely průměr 2x2 texelů předchozí úrovně.
+
+  Počet rozdílných vzorků: )." << differentTexels << R".(
+  Počet úrovní: )." << preparedTexture.nofLevels << R".(
+  Počet rozdílných průměrů: )." << differentAverages << std::endl;
+  REQUIRE(false);
+}
+
+SCENARIO("50"){
+  std::cerr << "50 - derivatives and level of detail" << std::endl;
+
+  auto const settings = gpu_getSettings();
+
+  Framebuffer scalar(64,64);
+  Framebuffer quads (64,64);
+
+  gpu_getSettings().simdQuads = false;
+  renderDerivatives(scalar);
+  gpu_getSettings().simdQuads = true;
+  renderDerivatives(quads);
+
+  gpu_getSettings() = settings;
+
+  auto const frame = quads.getFrame();
+  size_t wrongPixels = 0;
+  for(uint32_t y=0;y<frame.height;++y)
+    for(uint32_t x=0;x<frame.width;++x){
+      auto const pix = glm::uvec2(x,y);
+      auto const c = getColor(frame,pix);
+      wrongPixels += c.x < 254 || c.y < 254 || c.z < 126 || c.z > 128;
+      wrongPixels += getColor(frame,pix) != getColor(scalar.getFrame(),pix);
+    }
+
+  auto tex = TextureData(256,256,4);
+  tex.prepare();
+  auto const lod = texture_lod(tex.getTexture(),glm::vec2(1.f/16.f,0.f),glm::vec2(0.f,1.f/16.f));
+  bool const lodOk = std::abs(lod-4.f) < 1e-5f;
+
+  if(wrongPixels == 0 && lodOk)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test vykreslí do framebufferu 64x64 čtverec, jehož uv souřadnice se opakují 4x.
+  Derivace uv (InFragment::dFdx, dFdy) musí být 1/16 ve směru osy a 0 napříč,
+  po pixelech i po čtveřicích 2x2 bitově stejné.
+  Textura 256x256 má pro tyto derivace úroveň detailu 4.
+
+  Počet špatných pixelů: )." << wrongPixels << R".(
+  Úroveň detailu: )." << lod << std::endl;
+  REQUIRE(false);
+}
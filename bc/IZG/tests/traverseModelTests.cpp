@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include <catch2/catch_test_macros.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include <tests/testCommon.hpp>
 #include <tests/modelTestUtils.hpp>
@@ -227,3 +228,45 @@ SCENARIO("31"){
   #undef MESHES
 }
 
+
+SCENARIO("53"){
+  std::cerr << "53 - prepareModel - flattened model and frustum culling" << std::endl;
+
+  // triangle in square [-1,1]x[-1,1], instances are moved along x axis
+  std::vector<float>positions = {-1.f,-1.f,0.f, 1.f,-1.f,0.f, -1.f,1.f,0.f};
+  auto model = createModel({3},{NodeI(0,{NodeI(0,{},glm::translate(glm::mat4(1.f),glm::vec3(100.f,0.f,0.f)))}),NodeI(0,{},glm::scale(glm::mat4(1.f),glm::vec3(2.f)))});
+  model.buffers.push_back({positions.data(),positions.size()*sizeof(float)});
+  model.meshes[0].position = {0,sizeof(float)*3,0,AttributeType::VEC3};
+
+  MEMCB();
+  std::vector<MeshInstance>instances;
+  prepareModel(mem,cb,model,instances);
+
+  bool const flattened = instances.size() == 3
+    && instances[0].boundsMin == glm::vec3(-1.f,-1.f,0.f) && instances[0].boundsMax == glm::vec3(  1.f,1.f,0.f)
+    && instances[1].boundsMin == glm::vec3(99.f,-1.f,0.f) && instances[1].boundsMax == glm::vec3(101.f,1.f,0.f)
+    && instances[2].boundsMin == glm::vec3(-2.f,-2.f,0.f) && instances[2].boundsMax == glm::vec3(  2.f,2.f,0.f)
+    && instances[0].drawCommand == 1 && instances[1].drawCommand == 2 && instances[2].drawCommand == 3;
+
+  auto const viewProjection = glm::perspective(glm::radians(90.f),1.f,.1f,100.f)*glm::translate(glm::mat4(1.f),glm::vec3(0.f,0.f,-10.f));
+  auto const culled = flattened ? cullModel(cb,model,instances,viewProjection) : 0;
+
+  auto const drawn = [&](uint32_t c){return cb.commands[c].data.drawCommand.nofVertices;};
+  bool const culledOk = culled == 1 && drawn(1) == 3 && drawn(2) == 0 && drawn(3) == 3;
+
+  if(flattened && culledOk)return;
+
+  std::cerr << R".(
+  TEST SELHAL!
+
+  Tento test připraví model se třemi instancemi trojúhelníku funkcí prepareModel a zploštěným stromem (MeshInstance).
+  Instance musí být v pořadí pre order, s obalovými kvádry ve světových souřadnicích
+  a s indexy svých kreslících příkazů.
+  Funkce cullModel musí vypnout kreslící příkaz instance posunuté o 100 mimo pohledový jehlan
+  (nastaví počet vrcholů na 0) a ostatním instancím ponechat počet vrcholů.
+
+  Počet instancí: )." << instances.size() << R".(
+  Zploštěný model je správně: )." << flattened << R".(
+  Počet odstraněných instancí: )." << culled << std::endl;
+  REQUIRE(false);
+}
@@ -29,6 +29,7 @@ SCENARIO("04"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderDump0;
   mem.programs[0].fragmentShader = fragmentShaderEmpty;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,9);
 
@@ -86,6 +87,7 @@ void indexTest(){
 
   mem.programs[0].vertexShader   = vertexShaderDump0;
   mem.programs[0].fragmentShader = fragmentShaderEmpty;
+  mem.programs[0].sideEffects    = true;
   mem.buffers[0] = vectorToBuffer(indices);
 
   VertexArray vao;
@@ -194,6 +196,7 @@ SCENARIO("06"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderDump0  ;
   mem.programs[0].fragmentShader = fragmentShaderEmpty;
+  mem.programs[0].sideEffects    = true;
 
   pushDrawCommand(cb,3);
   dumpInject.init(&mem);
@@ -227,6 +230,7 @@ void attributeTest(uint32_t offset = 0,uint32_t stride = sizeof(float)){
   mem.buffers [0] =  vectorToBuffer(vert);
   mem.programs[0].vertexShader   = vertexShaderDump0 ;
   mem.programs[0].fragmentShader = fragmentShaderEmpty;
+  mem.programs[0].sideEffects    = true;
 
   VertexArray vao;
   vao.vertexAttrib[0].bufferID   = 0;
@@ -317,6 +321,7 @@ SCENARIO("08"){
   mem.framebuffer = framebuffer->getFrame();
   mem.programs[0].vertexShader   = vertexShaderDump0  ;
   mem.programs[0].fragmentShader = fragmentShaderEmpty;
+  mem.programs[0].sideEffects    = true;
   mem.buffers[0].data = b0;
   mem.buffers[0].size = 400;
   mem.buffers[1].data = b1;
@@ -380,6 +385,7 @@ SCENARIO("09"){
   mem.buffers[1] = vectorToBuffer(indices);
   mem.programs[0].vertexShader   = vertexShaderDump0  ;
   mem.programs[0].fragmentShader = fragmentShaderEmpty;
+  mem.programs[0].sideEffects    = true;
 
   VertexArray vao;
   vao.vertexAttrib[0].bufferID   = 0;